@@ -49,9 +49,12 @@ typedef struct _fty_common_unit_tests_t fty_common_unit_tests_t;
 #define FTY_COMMON_UNIT_TESTS_T_DEFINED
 
 #include "fty_common_agents.h"
+#include "fty_common_asset_registry.h"
+#include "fty_common_asset_topology.h"
 #include "fty_common_asset_types.h"
 #include "fty_common_base.h"
 #include "fty_common_client.h"
+#include "fty_common_enum_codec.h"
 #include "fty_common_filesystem.h"
 #include "fty_common_json.h"
 #include "fty_common_macros.h"
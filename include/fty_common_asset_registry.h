@@ -0,0 +1,123 @@
+/*  =========================================================================
+    fty_common_asset_registry - Asset types and subtypes added at runtime
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "fty_common_asset_types.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace persist {
+
+/**
+ * \brief Types and subtypes known to the running process: the built-in ones of fty_common_asset_types.h plus the
+ * ones added at runtime (new database rows), so that agents don't need a rebuild for a new subtype.
+ *
+ * Additions publish a new immutable snapshot through an atomic pointer; readers never lock. Superseded snapshots are
+ * kept until the registry is destroyed (additions happen a few times in the life of a process), so a reader may keep
+ * using the snapshot it loaded. Built-in names and ids are looked up first and never reach the snapshot.
+ *
+ * persist::type_to_typeid, subtype_to_subtypeid, typeid_to_type, subtypeid_to_subtype and is_ok_element_type read
+ * through AssetRegistry::instance(); the constexpr *_view and *_properties functions only know the built-in ones.
+ */
+class AssetRegistry
+{
+public:
+    struct Entry
+    {
+        uint16_t    id;
+        std::string name;
+        uint32_t    properties = PROP_NONE; // asset_property flags
+    };
+
+    AssetRegistry();
+    ~AssetRegistry();
+
+    AssetRegistry(const AssetRegistry&) = delete;
+    AssetRegistry& operator=(const AssetRegistry&) = delete;
+
+    /// registry used by the persist:: lookup functions
+    static AssetRegistry& instance();
+
+    /**
+     * \brief add types and subtypes, all or none
+     * An entry already known with the same id and name (case-insensitively) is ignored.
+     * \return false if an id or a name is already used by another entry or built-in, or an id is 0 or 0xFFFF; ids
+     * below NB_ASSET_TYPES/NB_ASSET_SUBTYPES without built-in name (the gaps of the lists) may be added
+     */
+    bool add(const std::vector<Entry>& types, const std::vector<Entry>& subtypes);
+
+    /**
+     * \brief add the entries of a JSON file:
+     *     {"types": [{"id": 21, "name": "zone", "properties": ["container"]}], "subtypes": [...]}
+     * "properties" is optional, its values are the asset_property names (container, power, virtualization...)
+     */
+    bool loadJson(const std::string& path);
+
+    /**
+     * \brief add the entries of a mysqldump of the tables t_bios_asset_element_type and t_bios_asset_device_type
+     * (the "INSERT INTO `t_bios_asset_...` VALUES (id,'name'),...;" statements, other statements are ignored)
+     */
+    bool loadDbDump(const std::string& path);
+
+    /// id of name (case-insensitive), TUNKNOWN/SUNKNOWN if unknown
+    uint16_t typeId(std::string_view name) const;
+    uint16_t subtypeId(std::string_view name) const;
+
+    /// name of id, "unknown" if unknown
+    std::string_view typeName(uint16_t id) const;
+    std::string_view subtypeName(uint16_t id) const;
+
+    /// asset_property flags of id, PROP_NONE if unknown
+    uint32_t typeProperties(uint16_t id) const;
+    uint32_t subtypeProperties(uint16_t id) const;
+
+    /// number of entries added at runtime
+    size_t addedTypes() const;
+    size_t addedSubtypes() const;
+
+private:
+    struct Table
+    {
+        std::vector<Entry>  entries; // lowercase names
+        std::vector<size_t> byId;    // index in entries + 1 by id, 0 if none
+        std::vector<size_t> byName;  // indexes in entries sorted by name
+    };
+
+    struct Snapshot
+    {
+        Table types;
+        Table subtypes;
+    };
+
+    static const Entry* find(const Table& table, uint16_t id);
+    static const Entry* find(const Table& table, std::string_view name);
+
+    std::atomic<const Snapshot*>                 m_current {nullptr};
+    std::mutex                                   m_mutex; // serializes writers
+    std::vector<std::unique_ptr<const Snapshot>> m_snapshots;
+};
+
+} // namespace persist
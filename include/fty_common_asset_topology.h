@@ -0,0 +1,150 @@
+/*  =========================================================================
+    fty_common_asset_topology - Containment tree of the assets
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "fty_common_asset_types.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace persist {
+
+/**
+ * \brief Containment tree of the assets (datacenter > room > row > rack > device), fed by asset_operation events.
+ *
+ * Nodes live in one array and are addressed by their index, which stays valid until the asset is removed (indexes of
+ * removed assets are reused). reindex() numbers the nodes in depth-first order: a node then owns the interval
+ * [enter, exit) of the numbers of its subtree, so isAncestor() is two comparisons and the descendants of a node are
+ * one contiguous range. Changes keep the tree valid but stale the numbering; until the next reindex() the queries walk
+ * the parent and child links instead (same results, O(depth) and O(k)).
+ *
+ * Not thread-safe: concurrent const queries are fine, changes need exclusive access.
+ */
+class AssetTopology
+{
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+
+    /**
+     * \brief apply an asset event
+     * INSERT and UPDATE add the asset or move it under parent (name, "" for none) and set its type and subtype,
+     * DELETE and RETIRE remove it (its children lose their parent), GET and INVENTORY are ignored.
+     * A parent not known yet is added with type TUNKNOWN, until its own event comes.
+     * \return false if the event would make an asset its own ancestor or removes an unknown asset
+     */
+    bool apply(asset_operation operation, const std::string& name, const std::string& parent = "",
+        uint16_t type = TUNKNOWN, uint16_t subtype = SUNKNOWN);
+
+    /// add or update asset name, see apply(); returns its index or npos
+    uint32_t insert(const std::string& name, const std::string& parent, uint16_t type, uint16_t subtype);
+    /// move asset node under parent (npos for none), false if parent is in its subtree
+    bool move(uint32_t node, uint32_t parent);
+    /// remove asset node, its children lose their parent
+    void remove(uint32_t node);
+
+    /// number the nodes again, O(number of assets)
+    void reindex();
+    /// whether the numbering is up to date
+    bool indexed() const
+    {
+        return m_indexed;
+    }
+
+    /// index of asset name, npos if unknown
+    uint32_t find(const std::string& name) const;
+    /// number of assets
+    size_t size() const
+    {
+        return m_index.size();
+    }
+
+    const std::string& name(uint32_t node) const
+    {
+        return m_names[node];
+    }
+    uint16_t type(uint32_t node) const
+    {
+        return m_nodes[node].type;
+    }
+    uint16_t subtype(uint32_t node) const
+    {
+        return m_nodes[node].subtype;
+    }
+    /// parent of node, npos for a root
+    uint32_t parent(uint32_t node) const
+    {
+        return m_nodes[node].parent;
+    }
+
+    /// whether ancestor contains node, directly or not (a node is not its own ancestor)
+    bool isAncestor(uint32_t ancestor, uint32_t node) const;
+
+    /// closest ancestor of node with type, npos if none ("which datacenter owns rack Y")
+    uint32_t ancestorOfType(uint32_t node, uint16_t type) const;
+
+    /// calls f(index) for each descendant of node, in depth-first order
+    template <typename F>
+    void forEachDescendant(uint32_t node, F&& f) const
+    {
+        if (m_indexed) {
+            for (uint32_t i = m_nodes[node].enter + 1; i < m_nodes[node].exit; i++)
+                f(m_order[i]);
+            return;
+        }
+        for (uint32_t child = m_nodes[node].firstChild; child != npos;) {
+            f(child);
+            child = next(child, node);
+        }
+    }
+
+    /// descendants of node, of subtype unless it is SUNKNOWN ("all UPSes in room X")
+    std::vector<uint32_t> descendants(uint32_t node, uint16_t subtype = SUNKNOWN) const;
+
+private:
+    struct Node
+    {
+        uint32_t parent      = npos;
+        uint32_t firstChild  = npos;
+        uint32_t nextSibling = npos;
+        uint32_t prevSibling = npos;
+        uint32_t enter       = 0; // depth-first numbers of the subtree: [enter, exit)
+        uint32_t exit        = 0;
+        uint16_t type        = TUNKNOWN;
+        uint16_t subtype     = SUNKNOWN;
+    };
+
+    uint32_t add(const std::string& name);
+    void     link(uint32_t node, uint32_t parent);
+    void     unlink(uint32_t node);
+    /// next node after node in depth-first order within the subtree of root, npos at the end
+    uint32_t next(uint32_t node, uint32_t root) const;
+
+    std::vector<Node>                         m_nodes;
+    std::vector<std::string>                  m_names; // by node, empty for a removed one
+    std::vector<uint32_t>                     m_free;  // indexes of removed nodes
+    std::vector<uint32_t>                     m_order; // nodes by depth-first number
+    std::unordered_map<std::string, uint32_t> m_index;
+    bool                                      m_indexed = true;
+};
+
+} // namespace persist
@@ -21,234 +21,212 @@
 
 #pragma once
 
+#include "fty_common_enum_codec.h"
 #include <algorithm>
+#include <array>
 #include <inttypes.h>
 #include <string>
+#include <string_view>
+#include <vector>
+
+// clang-format off
+// CAUTION: THESE LISTS REFLECT (PARTS OF) THE DATABASE, keep them consistent with
+// select * from t_bios_asset_element_type order by id_asset_element_type asc;
+// select * from t_bios_asset_device_type order by id_asset_device_type asc;
+//
+// They are the single source of the persist::asset_type/asset_subtype enums, of the fty::TYPE_*/SUB_* name constants
+// and of the lookup tables below. Each row is X(enumerator, id, name constant, name, properties); except for "N_A",
+// names *must* be lowercase (checked at compile time in fty_common_asset_types.cc).
+
+#define FTY_ASSET_TYPE_LIST(X)                                                                                         \
+    X(TUNKNOWN,         0,  TYPE_UNKNOWN,          "unknown",          PROP_NONE)                                      \
+    X(GROUP,            1,  TYPE_GROUP,            "group",            PROP_NONE)                                      \
+    X(DATACENTER,       2,  TYPE_DATACENTER,       "datacenter",       PROP_CONTAINER)                                 \
+    X(ROOM,             3,  TYPE_ROOM,             "room",             PROP_CONTAINER)                                 \
+    X(ROW,              4,  TYPE_ROW,              "row",              PROP_CONTAINER)                                 \
+    X(RACK,             5,  TYPE_RACK,             "rack",             PROP_CONTAINER)                                 \
+    X(DEVICE,           6,  TYPE_DEVICE,           "device",           PROP_NONE)                                      \
+    X(INFRA_SERVICE,    7,  TYPE_INFRA_SERVICE,    "infra-service",    PROP_NONE)                                      \
+    X(CLUSTER,          8,  TYPE_CLUSTER,          "cluster",          PROP_VIRTUALIZATION)                            \
+    X(HYPERVISOR,       9,  TYPE_HYPERVISOR,       "hypervisor",       PROP_VIRTUALIZATION)                            \
+    X(VIRTUAL_MACHINE,  10, TYPE_VIRTUAL_MACHINE,  "virtual-machine",  PROP_VIRTUALIZATION)                            \
+    X(STORAGE_SERVICE,  11, TYPE_STORAGE_SERVICE,  "storage-service",  PROP_STORAGE)                                   \
+    X(VAPP,             12, TYPE_VAPP,             "vapp",             PROP_VIRTUALIZATION)                            \
+    X(CONNECTOR,        13, TYPE_CONNECTOR,        "connector",        PROP_CONNECTOR)                                 \
+    X(TSERVER,          15, TYPE_SERVER,           "server",           PROP_NONE)                                      \
+    X(PLANNER,          16, TYPE_PLANNER,          "planner",          PROP_NONE)                                      \
+    X(PLAN,             17, TYPE_PLAN,             "plan",             PROP_NONE)                                      \
+    /* Composite Power System */                                                                                       \
+    X(COPS,             18, TYPE_COPS,             "cops",             PROP_POWER)                                     \
+    X(OPERATING_SYSTEM, 19, TYPE_OPERATING_SYSTEM, "operating-system", PROP_NONE)                                      \
+    X(HOST_GROUP,       20, TYPE_HOST_GROUP,       "host-group",       PROP_NONE)
+
+#define FTY_ASSET_SUBTYPE_LIST(X)                                                                                      \
+    X(SUNKNOWN,                 0,  SUB_UNKNOWN,                  "unknown",                    PROP_NONE)             \
+    X(UPS,                      1,  SUB_UPS,                      "ups",                        PROP_POWER)            \
+    X(GENSET,                   2,  SUB_GENSET,                   "genset",                     PROP_POWER)            \
+    X(EPDU,                     3,  SUB_EPDU,                     "epdu",                       PROP_POWER)            \
+    X(PDU,                      4,  SUB_PDU,                      "pdu",                        PROP_POWER)            \
+    X(SERVER,                   5,  SUB_SERVER,                   "server",                     PROP_NONE)             \
+    X(FEED,                     6,  SUB_FEED,                     "feed",                       PROP_POWER)            \
+    X(STS,                      7,  SUB_STS,                      "sts",                        PROP_POWER)            \
+    X(SWITCH,                   8,  SUB_SWITCH,                   "switch",                     PROP_NETWORK)          \
+    X(STORAGE,                  9,  SUB_STORAGE,                  "storage",                    PROP_STORAGE)          \
+    X(VM,                       10, SUB_VM,                       "vm",                         PROP_VIRTUALIZATION)   \
+    /* ATTENTION: don't change N_A id, it is the default value in initdb.sql */                                        \
+    X(N_A,                      11, SUB_N_A,                      "N_A",                        PROP_NONE)             \
+    X(ROUTER,                   12, SUB_ROUTER,                   "router",                     PROP_NETWORK)          \
+    X(RACKCONTROLLER,           13, SUB_RACK_CONTROLLER,          "rackcontroller",             PROP_NONE)             \
+    X(SENSOR,                   14, SUB_SENSOR,                   "sensor",                     PROP_SENSOR)           \
+    X(APPLIANCE,                15, SUB_APPLIANCE,                "appliance",                  PROP_NONE)             \
+    X(CHASSIS,                  16, SUB_CHASSIS,                  "chassis",                    PROP_NONE)             \
+    X(PATCHPANEL,               17, SUB_PATCH_PANEL,              "patchpanel",                 PROP_NONE)             \
+    X(OTHER,                    18, SUB_OTHER,                    "other",                      PROP_NONE)             \
+    X(SENSORGPIO,               19, SUB_SENSORGPIO,               "sensorgpio",                 PROP_SENSOR)           \
+    X(GPO,                      20, SUB_GPO,                      "gpo",                        PROP_ACTUATOR)         \
+    X(NETAPP_ONTAP_NODE,        21, SUB_NETAPP_ONTAP_NODE,        "netapp.ontap.node",          PROP_STORAGE)          \
+    X(IPMINFRA_SERVER,          22, SUB_IPMINFRA_SERVER,          "ipminfra.server",            PROP_NONE)             \
+    X(IPMINFRA_SERVICE,         23, SUB_IPMINFRA_SERVICE,         "ipminfra.service",           PROP_NONE)             \
+    X(VMWARE_VCENTER,           24, SUB_VMWARE_VCENTER,           "vmware.vcenter",             PROP_VIRTUALIZATION)   \
+    X(CITRIX_POOL,              25, SUB_CITRIX_POOL,              "citrix.pool",                PROP_VIRTUALIZATION)   \
+    X(VMWARE_CLUSTER,           26, SUB_VMWARE_CLUSTER,           "vmware.cluster",             PROP_VIRTUALIZATION)   \
+    X(VMWARE_ESXI,              27, SUB_VMWARE_ESXI,              "vmware.esxi",                PROP_VIRTUALIZATION)   \
+    X(MICROSOFT_HYPERV_SERVER,  28, SUB_MICROSOFT_HYPERV_SERVER,  "microsoft.hyperv.server",    PROP_VIRTUALIZATION)   \
+    X(VMWARE_VM,                29, SUB_VMWARE_VM,                "vmware.vm",                  PROP_VIRTUALIZATION)   \
+    X(CITRIX_VM,                31, SUB_CITRIX_VM,                "citrix.vm",                  PROP_VIRTUALIZATION)   \
+    X(NETAPP_NODE,              32, SUB_NETAPP_NODE,              "netapp.node",                PROP_STORAGE)          \
+    X(VMWARE_STANDALONE_ESXI,   33, SUB_VMWARE_STANDALONE_ESXI,   "vmware.standalone.esxi",     PROP_VIRTUALIZATION)   \
+    X(VMWARE_TASK,              34, SUB_VMWARE_TASK,              "vmware.task",                PROP_VIRTUALIZATION)   \
+    X(VMWARE_VAPP,              35, SUB_VMWARE_VAPP,              "vmware.vapp",                PROP_VIRTUALIZATION)   \
+    X(CITRIX_XENSERVER,         36, SUB_CITRIX_XENSERVER,         "citrix.xenserver",           PROP_VIRTUALIZATION)   \
+    X(CITRIX_VAPP,              37, SUB_CITRIX_VAPP,              "citrix.vapp",                PROP_VIRTUALIZATION)   \
+    X(CITRIX_TASK,              38, SUB_CITRIX_TASK,              "citrix.task",                PROP_VIRTUALIZATION)   \
+    X(MICROSOFT_VM,             39, SUB_MICROSOFT_VM,             "microsoft.vm",               PROP_VIRTUALIZATION)   \
+    X(MICROSOFT_TASK,           40, SUB_MICROSOFT_TASK,           "microsoft.task",             PROP_VIRTUALIZATION)   \
+    X(MICROSOFT_SERVER_CONNECTOR, 41, SUB_MICROSOFT_SERVER_CONNECTOR, "microsoft.server.connector", PROP_CONNECTOR)    \
+    X(MICROSOFT_SERVER,         42, SUB_MICROSOFT_SERVER,         "microsoft.server",           PROP_VIRTUALIZATION)   \
+    X(MICROSOFT_CLUSTER,        43, SUB_MICROSOFT_CLUSTER,        "microsoft.cluster",          PROP_VIRTUALIZATION)   \
+    X(HP_ONEVIEW_CONNECTOR,     44, SUB_HP_ONEVIEW_CONNECTOR,     "hp.oneview.connector",       PROP_CONNECTOR)        \
+    X(HP_ONEVIEW,               45, SUB_HP_ONEVIEW,               "hp.oneview",                 PROP_NONE)             \
+    X(HP_IT_SERVER,             46, SUB_HP_IT_SERVER,             "hp.it.server",               PROP_NONE)             \
+    X(HP_IT_RACK,               47, SUB_HP_IT_RACK,               "hp.it.rack",                 PROP_NONE)             \
+    X(NETAPP_SERVER,            48, SUB_NETAPP_SERVER,            "netapp.server",              PROP_STORAGE)          \
+    X(NETAPP_ONTAP_CONNECTOR,   49, SUB_NETAPP_ONTAP_CONNECTOR,   "netapp.ontap.connector",     PROP_CONNECTOR)        \
+    X(NETAPP_ONTAP_CLUSTER,     50, SUB_NETAPP_ONTAP_CLUSTER,     "netapp.ontap.cluster",       PROP_STORAGE)          \
+    X(NUTANIX_VM,               51, SUB_NUTANIX_VM,               "nutanix.vm",                 PROP_VIRTUALIZATION)   \
+    X(NUTANIX_PRISM_GATEWAY,    52, SUB_NUTANIX_PRISM_GATEWAY,    "nutanix.prism.gateway",      PROP_VIRTUALIZATION)   \
+    X(NUTANIX_NODE,             53, SUB_NUTANIX_NODE,             "nutanix.node",               PROP_VIRTUALIZATION)   \
+    X(NUTANIX_CLUSTER,          54, SUB_NUTANIX_CLUSTER,          "nutanix.cluster",            PROP_VIRTUALIZATION)   \
+    X(NUTANIX_PRISM_CONNECTOR,  55, SUB_NUTANIX_PRISM_CONNECTOR,  "nutanix.prism.connector",    PROP_CONNECTOR)        \
+    X(VMWARE_VCENTER_CONNECTOR, 60, SUB_VMWARE_VCENTER_CONNECTOR, "vmware.vcenter.connector",   PROP_CONNECTOR)        \
+    X(VMWARE_STANDALONE_ESXI_CONNECTOR, 61, SUB_VMWARE_STANDALONE_ESXI_CONNECTOR,                                      \
+        "vmware.standalone.esxi.connector", PROP_CONNECTOR)                                                            \
+    X(NETAPP_ONTAP,             62, SUB_NETAPP_ONTAP,             "netapp.ontap",               PROP_STORAGE)          \
+    X(VMWARE_SRM,               65, SUB_VMWARE_SRM,               "vmware.srm",                 PROP_VIRTUALIZATION)   \
+    X(VMWARE_SRM_PLAN,          66, SUB_VMWARE_SRM_PLAN,          "vmware.srm.plan",            PROP_VIRTUALIZATION)   \
+    /* Parallel Control Unit */                                                                                        \
+    X(PCU,                      67, SUB_PCU,                      "pcu",                        PROP_POWER)            \
+    X(DELL_VXRAIL_CONNECTOR,    68, SUB_DELL_VXRAIL_CONNECTOR,    "dell.vxrail.connector",      PROP_CONNECTOR)        \
+    X(DELL_VXRAIL_MANAGER,      69, SUB_DELL_VXRAIL_MANAGER,      "dell.vxrail.manager",        PROP_VIRTUALIZATION)   \
+    X(DELL_VXRAIL_CLUSTER,      70, SUB_DELL_VXRAIL_CLUSTER,      "dell.vxrail.cluster",        PROP_VIRTUALIZATION)   \
+    X(MICROSOFT_HYPERV_SERVICE, 72, SUB_MICROSOFT_HYPERV_SERVICE, "microsoft.hyperv.service",   PROP_VIRTUALIZATION)   \
+    X(VMWARE_CLUSTER_FAULT_DOMAIN, 73, SUB_VMWARE_CLUSTER_FAULT_DOMAIN,                                                \
+        "vmware.cluster.fault.domain", PROP_VIRTUALIZATION)                                                            \
+    X(MICROSOFT_SCVMM_CONNECTOR, 74, SUB_MICROSOFT_SCVMM_CONNECTOR, "microsoft.scvmm.connector",  PROP_CONNECTOR)      \
+    X(MICROSOFT_SCVMM,          75, SUB_MICROSOFT_SCVMM,          "microsoft.scvmm",            PROP_VIRTUALIZATION)   \
+    X(DELL_VXRAIL_EXSI,         76, SUB_DELL_VXRAIL_EXSI,         "dell.vxrail.exsi",           PROP_VIRTUALIZATION)   \
+    X(MICROSOFT_STANDALONE_HYPERV_SERVER, 77, SUB_MICROSOFT_STANDALONE_HYPERV_SERVER,                                  \
+        "microsoft.standalone.hyperv.server", PROP_VIRTUALIZATION)                                                     \
+    X(ACTUATOR,                 78, SUB_ACTUATOR,                 "actuator",                   PROP_ACTUATOR)
+// clang-format on
 
 namespace persist {
 
-// CAUTION: THESE ENUMS REFLECT (PARTS OF) THE DATABASE
+// classification flags of types and subtypes, see type_properties()/subtype_properties()
+enum asset_property : uint32_t
+{
+    PROP_NONE           = 0,
+    PROP_CONTAINER      = 1u << 0, // datacenter, room, row, rack
+    PROP_POWER          = 1u << 1, // power chain devices (ups, epdu, feed...)
+    PROP_VIRTUALIZATION = 1u << 2, // hypervisors, virtual machines, their clusters and managers
+    PROP_CONNECTOR      = 1u << 3, // connectors to external infrastructure managers
+    PROP_SENSOR         = 1u << 4,
+    PROP_ACTUATOR       = 1u << 5,
+    PROP_NETWORK        = 1u << 6,
+    PROP_STORAGE        = 1u << 7,
+};
+
+#define FTY_ASSET_ENUMERATOR(enumerator, id, constant, name, properties) enumerator = id,
 
 enum asset_type
 {
-    TUNKNOWN = 0,
-
-    GROUP = 1,
-    DATACENTER,
-    ROOM,
-    ROW,
-    RACK,
-    DEVICE,
-    INFRA_SERVICE,
-    CLUSTER,
-    HYPERVISOR,
-
-    VIRTUAL_MACHINE,
-    STORAGE_SERVICE,
-    VAPP,
-    CONNECTOR,
-    TSERVER = 15,
-    PLANNER,
-    PLAN,
-    COPS, // Composite Power System
-    OPERATING_SYSTEM,
-    HOST_GROUP, // Composite Power System
+    FTY_ASSET_TYPE_LIST(FTY_ASSET_ENUMERATOR)
 
     NB_ASSET_TYPES
 };
 
+enum asset_subtype
+{
+    FTY_ASSET_SUBTYPE_LIST(FTY_ASSET_ENUMERATOR)
+
+    NB_ASSET_SUBTYPES,
+
+    VIRTUAL = VM
+};
+
+#undef FTY_ASSET_ENUMERATOR
+
 } // namespace persist
 
 namespace fty {
+
+#define FTY_ASSET_NAME_CONSTANT(enumerator, id, constant, name, properties)                                            \
+    static constexpr const char* constant = name;
+
 // WARNING keep consistent with DB table t_bios_asset_element_type
-static constexpr const char* TYPE_UNKNOWN          = "unknown";          // 0
-static constexpr const char* TYPE_GROUP            = "group";            // 1
-static constexpr const char* TYPE_DATACENTER       = "datacenter";       // 2
-static constexpr const char* TYPE_ROOM             = "room";             // 3
-static constexpr const char* TYPE_ROW              = "row";              // 4
-static constexpr const char* TYPE_RACK             = "rack";             // 5
-static constexpr const char* TYPE_DEVICE           = "device";           // 6
-static constexpr const char* TYPE_INFRA_SERVICE    = "infra-service";    // 7
-static constexpr const char* TYPE_CLUSTER          = "cluster";          // 8
-static constexpr const char* TYPE_HYPERVISOR       = "hypervisor";       // 9
-static constexpr const char* TYPE_VIRTUAL_MACHINE  = "virtual-machine";  // 10
-static constexpr const char* TYPE_STORAGE_SERVICE  = "storage-service";  // 11
-static constexpr const char* TYPE_VAPP             = "vapp";             // 12
-static constexpr const char* TYPE_CONNECTOR        = "connector";        // 13
-static constexpr const char* TYPE_SERVER           = "server";           // 15
-static constexpr const char* TYPE_PLANNER          = "planner";          // 16
-static constexpr const char* TYPE_PLAN             = "plan";             // 17
-static constexpr const char* TYPE_COPS             = "cops";             // 18
-static constexpr const char* TYPE_OPERATING_SYSTEM = "operating-system"; // 19
-static constexpr const char* TYPE_HOST_GROUP       = "host-group";       // 20
+FTY_ASSET_TYPE_LIST(FTY_ASSET_NAME_CONSTANT)
+
+// WARNING keep consistent with DB table t_bios_asset_device_type
+FTY_ASSET_SUBTYPE_LIST(FTY_ASSET_NAME_CONSTANT)
+
+#undef FTY_ASSET_NAME_CONSTANT
 
 } // namespace fty
 
 namespace persist {
-    enum asset_subtype {
-        SUNKNOWN                        = 0,
-
-        UPS                             = 1,
-        GENSET,
-        EPDU,
-        PDU,
-        SERVER,
-        FEED,
-        STS,
-        SWITCH,
-        STORAGE,
-        VM,
-        VIRTUAL = VM,
-
-        N_A             = 11, /* ATTENTION: don't change N_A id. It is used as default value in initdb.sql for types, that don't have N_A */
-        ROUTER,
-        RACKCONTROLLER,
-        SENSOR,
-        APPLIANCE,
-        CHASSIS,
-        PATCHPANEL,
-        OTHER,
-        SENSORGPIO,
-
-        GPO,
-        NETAPP_ONTAP_NODE,
-        IPMINFRA_SERVER,
-        IPMINFRA_SERVICE,
-        VMWARE_VCENTER,
-        CITRIX_POOL,
-        VMWARE_CLUSTER,
-        VMWARE_ESXI,
-        MICROSOFT_HYPERV_SERVER,
-        VMWARE_VM,
-
-        CITRIX_VM = 31,
-        NETAPP_NODE,
-        VMWARE_STANDALONE_ESXI,
-        VMWARE_TASK,
-        VMWARE_VAPP,
-        CITRIX_XENSERVER,
-        CITRIX_VAPP,
-        CITRIX_TASK,
-        MICROSOFT_VM,
-        MICROSOFT_TASK,
-        MICROSOFT_SERVER_CONNECTOR,
-        MICROSOFT_SERVER,
-        MICROSOFT_CLUSTER,
-
-        HP_ONEVIEW_CONNECTOR,
-        HP_ONEVIEW,
-        HP_IT_SERVER,
-        HP_IT_RACK,
-        NETAPP_SERVER,
-        NETAPP_ONTAP_CONNECTOR,
-        NETAPP_ONTAP_CLUSTER,
-
-        NUTANIX_VM,
-        NUTANIX_PRISM_GATEWAY,
-        NUTANIX_NODE,
-        NUTANIX_CLUSTER,
-        NUTANIX_PRISM_CONNECTOR,
-
-        VMWARE_VCENTER_CONNECTOR            = 60,
-        VMWARE_STANDALONE_ESXI_CONNECTOR,
-        NETAPP_ONTAP,
-        VMWARE_SRM                          = 65,
-        VMWARE_SRM_PLAN,
-        PCU,      // Parallel Control Unit
-
-        DELL_VXRAIL_CONNECTOR,
-        DELL_VXRAIL_MANAGER,
-        DELL_VXRAIL_CLUSTER,
-
-        MICROSOFT_HYPERV_SERVICE            = 72,
-        VMWARE_CLUSTER_FAULT_DOMAIN,
-        MICROSOFT_SCVMM_CONNECTOR,
-        MICROSOFT_SCVMM,
-        DELL_VXRAIL_EXSI,
-        MICROSOFT_STANDALONE_HYPERV_SERVER,
-
-        ACTUATOR,
-
-        NB_ASSET_SUBTYPES
-    };
+
+namespace detail {
+
+struct NameEntry
+{
+    uint16_t         id;
+    std::string_view name;
+    uint32_t         properties = PROP_NONE;
+};
+
+#define FTY_ASSET_NAME_ENTRY(enumerator, id, constant, name, properties) {enumerator, name, properties},
+
+constexpr NameEntry type_entries[] = {FTY_ASSET_TYPE_LIST(FTY_ASSET_NAME_ENTRY)};
+
+constexpr NameEntry subtype_entries[] = {FTY_ASSET_SUBTYPE_LIST(FTY_ASSET_NAME_ENTRY)};
+
+#undef FTY_ASSET_NAME_ENTRY
+
+template <size_t Size, size_t Count>
+constexpr std::array<uint32_t, Size> make_properties_by_id(const NameEntry (&entries)[Count])
+{
+    std::array<uint32_t, Size> properties = {};
+    for (const auto& entry : entries)
+        properties[entry.id] = entry.properties;
+    return properties;
 }
 
-namespace fty {
- // WARNING keep consistent with DB table t_bios_asset_device_type
-    static constexpr const char* SUB_UNKNOWN                            = "unknown";
-    static constexpr const char* SUB_UPS                                = "ups";
-    static constexpr const char* SUB_GENSET                             = "genset";
-    static constexpr const char* SUB_EPDU                               = "epdu";
-    static constexpr const char* SUB_PDU                                = "pdu";
-    static constexpr const char* SUB_SERVER                             = "server";
-    static constexpr const char* SUB_FEED                               = "feed";
-    static constexpr const char* SUB_STS                                = "sts";
-    static constexpr const char* SUB_SWITCH                             = "switch";
-    static constexpr const char* SUB_STORAGE                            = "storage";
-    static constexpr const char* SUB_VM                                 = "vm";
-    static constexpr const char* SUB_N_A                                = "N_A";
-    static constexpr const char* SUB_ROUTER                             = "router";
-    static constexpr const char* SUB_RACK_CONTROLLER                    = "rackcontroller";
-    static constexpr const char* SUB_SENSOR                             = "sensor";
-    static constexpr const char* SUB_APPLIANCE                          = "appliance";
-    static constexpr const char* SUB_CHASSIS                            = "chassis";
-    static constexpr const char* SUB_PATCH_PANEL                        = "patchpanel";
-    static constexpr const char* SUB_OTHER                              = "other";
-    static constexpr const char* SUB_SENSORGPIO                         = "sensorgpio";
-    static constexpr const char* SUB_GPO                                = "gpo";
-    static constexpr const char* SUB_NETAPP_ONTAP_NODE                  = "netapp.ontap.node";
-    static constexpr const char* SUB_IPMINFRA_SERVER                    = "ipminfra.server";
-    static constexpr const char* SUB_IPMINFRA_SERVICE                   = "ipminfra.service";
-    static constexpr const char* SUB_VMWARE_VCENTER                     = "vmware.vcenter";
-    static constexpr const char* SUB_CITRIX_POOL                        = "citrix.pool";
-    static constexpr const char* SUB_VMWARE_CLUSTER                     = "vmware.cluster";
-    static constexpr const char* SUB_VMWARE_ESXI                        = "vmware.esxi";
-    static constexpr const char* SUB_MICROSOFT_HYPERV_SERVER            = "microsoft.hyperv.server";
-    static constexpr const char* SUB_VMWARE_VM                          = "vmware.vm";
-    static constexpr const char* SUB_CITRIX_VM                          = "citrix.vm";
-    static constexpr const char* SUB_NETAPP_NODE                        = "netapp.node";
-    static constexpr const char* SUB_VMWARE_STANDALONE_ESXI             = "vmware.standalone.esxi";
-    static constexpr const char* SUB_VMWARE_TASK                        = "vmware.task";
-    static constexpr const char* SUB_VMWARE_VAPP                        = "vmware.vapp";
-    static constexpr const char* SUB_CITRIX_XENSERVER                   = "citrix.xenserver";
-    static constexpr const char* SUB_CITRIX_VAPP                        = "citrix.vapp";
-    static constexpr const char* SUB_CITRIX_TASK                        = "citrix.task";
-    static constexpr const char* SUB_MICROSOFT_VM                       = "microsoft.vm";
-    static constexpr const char* SUB_MICROSOFT_TASK                     = "microsoft.task";
-    static constexpr const char* SUB_MICROSOFT_SERVER_CONNECTOR         = "microsoft.server.connector";
-    static constexpr const char* SUB_MICROSOFT_SERVER                   = "microsoft.server";
-    static constexpr const char* SUB_MICROSOFT_CLUSTER                  = "microsoft.cluster";
-    static constexpr const char* SUB_HP_ONEVIEW_CONNECTOR               = "hp.oneview.connector";
-    static constexpr const char* SUB_HP_ONEVIEW                         = "hp.oneview";
-    static constexpr const char* SUB_HP_IT_SERVER                       = "hp.it.server";
-    static constexpr const char* SUB_HP_IT_RACK                         = "hp.it.rack";
-    static constexpr const char* SUB_NETAPP_SERVER                      = "netapp.server";
-    static constexpr const char* SUB_NETAPP_ONTAP_CONNECTOR             = "netapp.ontap.connector";
-    static constexpr const char* SUB_NETAPP_ONTAP_CLUSTER               = "netapp.ontap.cluster";
-    static constexpr const char* SUB_NUTANIX_VM                         = "nutanix.vm";
-    static constexpr const char* SUB_NUTANIX_PRISM_GATEWAY              = "nutanix.prism.gateway";
-    static constexpr const char* SUB_NUTANIX_NODE                       = "nutanix.node";
-    static constexpr const char* SUB_NUTANIX_CLUSTER                    = "nutanix.cluster";
-    static constexpr const char* SUB_NUTANIX_PRISM_CONNECTOR            = "nutanix.prism.connector";
-    static constexpr const char* SUB_VMWARE_VCENTER_CONNECTOR           = "vmware.vcenter.connector";
-    static constexpr const char* SUB_VMWARE_STANDALONE_ESXI_CONNECTOR   = "vmware.standalone.esxi.connector";
-    static constexpr const char* SUB_NETAPP_ONTAP                       = "netapp.ontap";
-    static constexpr const char* SUB_VMWARE_SRM                         = "vmware.srm";
-    static constexpr const char* SUB_VMWARE_SRM_PLAN                    = "vmware.srm.plan";
-    static constexpr const char* SUB_PCU                                = "pcu";
-    static constexpr const char* SUB_DELL_VXRAIL_CONNECTOR              = "dell.vxrail.connector";
-    static constexpr const char* SUB_DELL_VXRAIL_MANAGER                = "dell.vxrail.manager";
-    static constexpr const char* SUB_DELL_VXRAIL_CLUSTER                = "dell.vxrail.cluster";
-    static constexpr const char* SUB_MICROSOFT_HYPERV_SERVICE           = "microsoft.hyperv.service";
-    static constexpr const char* SUB_VMWARE_CLUSTER_FAULT_DOMAIN        = "vmware.cluster.fault.domain";
-    static constexpr const char* SUB_MICROSOFT_SCVMM_CONNECTOR          = "microsoft.scvmm.connector";
-    static constexpr const char* SUB_MICROSOFT_SCVMM                    = "microsoft.scvmm";
-    static constexpr const char* SUB_DELL_VXRAIL_EXSI                   = "dell.vxrail.exsi";
-    static constexpr const char* SUB_MICROSOFT_STANDALONE_HYPERV_SERVER = "microsoft.standalone.hyperv.server";
-    static constexpr const char* SUB_ACTUATOR                           = "actuator";
-} //namespace fty
+// properties indexed by id, ids without name have none
+constexpr auto type_properties_by_id    = make_properties_by_id<asset_type::NB_ASSET_TYPES>(type_entries);
+constexpr auto subtype_properties_by_id =
+    make_properties_by_id<asset_subtype::NB_ASSET_SUBTYPES>(subtype_entries);
 
-namespace persist {
+} // namespace detail
 
 enum asset_operation
 {
@@ -260,18 +238,158 @@ enum asset_operation
     INVENTORY
 };
 
+} // namespace persist
+
+namespace fty {
+
+#define FTY_ASSET_ENUM_NAME(enumerator, id, constant, name, properties) {persist::enumerator, name},
+#define FTY_ASSET_COUNT(enumerator, id, constant, name, properties) +1
+
+template <>
+struct EnumTraits<persist::asset_type>
+{
+    static constexpr EnumName<persist::asset_type> names[] = {FTY_ASSET_TYPE_LIST(FTY_ASSET_ENUM_NAME)};
+
+    static constexpr persist::asset_type unknown      = persist::TUNKNOWN;
+    static constexpr std::string_view    unknown_name = TYPE_UNKNOWN;
+    static constexpr size_t              count        = 0 FTY_ASSET_TYPE_LIST(FTY_ASSET_COUNT);
+};
+
+// "N_A" is matched case-sensitively, "" is its equivalent (string for assets with undefined subtype)
+template <>
+struct EnumTraits<persist::asset_subtype>
+{
+    static constexpr EnumName<persist::asset_subtype> names[] = {FTY_ASSET_SUBTYPE_LIST(FTY_ASSET_ENUM_NAME)
+        // aliases, mind the spaces!
+        {persist::RACKCONTROLLER, "rack controller"},
+        {persist::PATCHPANEL, "patch panel"},
+        {persist::N_A, ""}};
+
+    static constexpr persist::asset_subtype unknown      = persist::SUNKNOWN;
+    static constexpr std::string_view       unknown_name = SUB_UNKNOWN;
+    static constexpr size_t                 count        = 0 FTY_ASSET_SUBTYPE_LIST(FTY_ASSET_COUNT);
+};
+
+#undef FTY_ASSET_COUNT
+#undef FTY_ASSET_ENUM_NAME
+
+// "create" is INSERT, unknown names are INVENTORY
+template <>
+struct EnumTraits<persist::asset_operation>
+{
+    static constexpr EnumName<persist::asset_operation> names[] = {
+        {persist::INSERT, "create"},
+        {persist::DELETE, "delete"},
+        {persist::UPDATE, "update"},
+        {persist::GET, "get"},
+        {persist::RETIRE, "retire"},
+        {persist::INVENTORY, "inventory"},
+    };
+
+    static constexpr persist::asset_operation unknown      = persist::INVENTORY;
+    static constexpr std::string_view         unknown_name = "unknown";
+    static constexpr size_t                   count        = 6;
+};
+
+// names of the flags, as in the files read by persist::AssetRegistry::loadJson
+template <>
+struct EnumTraits<persist::asset_property>
+{
+    static constexpr EnumName<persist::asset_property> names[] = {
+        {persist::PROP_NONE, ""},
+        {persist::PROP_CONTAINER, "container"},
+        {persist::PROP_POWER, "power"},
+        {persist::PROP_VIRTUALIZATION, "virtualization"},
+        {persist::PROP_CONNECTOR, "connector"},
+        {persist::PROP_SENSOR, "sensor"},
+        {persist::PROP_ACTUATOR, "actuator"},
+        {persist::PROP_NETWORK, "network"},
+        {persist::PROP_STORAGE, "storage"},
+    };
+
+    static constexpr persist::asset_property unknown      = persist::PROP_NONE;
+    static constexpr std::string_view        unknown_name = "";
+    static constexpr size_t                  count        = 9;
+};
+
+} // namespace fty
+
+namespace persist {
+
 std::string operation2str(asset_operation operation);
 
 asset_operation str2operation(const std::string& operation);
 
+// name to id lookups are case-insensitive (but for "N_A") and don't allocate, unknown names give TUNKNOWN/SUNKNOWN
 uint16_t type_to_typeid(const std::string& type);
+uint16_t type_to_typeid(const char* type);
+uint16_t type_to_typeid(std::string_view type);
 
 std::string typeid_to_type(uint16_t type_id);
 
+// name of type_id, "unknown" (fty::TYPE_UNKNOWN) for an unknown id; doesn't allocate nor throw
+constexpr std::string_view typeid_to_type_view(uint16_t type_id)
+{
+    return type_id < NB_ASSET_TYPES ? fty::EnumCodec<asset_type>::format(asset_type(type_id)) : ::fty::TYPE_UNKNOWN;
+}
+
 uint16_t subtype_to_subtypeid(const std::string& subtype);
+uint16_t subtype_to_subtypeid(const char* subtype);
+uint16_t subtype_to_subtypeid(std::string_view subtype);
 
 std::string subtypeid_to_subtype(uint16_t subtype_id);
 
+// name of subtype_id, "unknown" (fty::SUB_UNKNOWN) for an unknown id; doesn't allocate nor throw
+constexpr std::string_view subtypeid_to_subtype_view(uint16_t subtype_id)
+{
+    return subtype_id < NB_ASSET_SUBTYPES ? fty::EnumCodec<asset_subtype>::format(asset_subtype(subtype_id))
+                                          : ::fty::SUB_UNKNOWN;
+}
+
+// asset_property flags of type_id/subtype_id, PROP_NONE for an unknown id
+constexpr uint32_t type_properties(uint16_t type_id)
+{
+    return type_id < detail::type_properties_by_id.size() ? detail::type_properties_by_id[type_id] : PROP_NONE;
+}
+
+constexpr uint32_t subtype_properties(uint16_t subtype_id)
+{
+    return subtype_id < detail::subtype_properties_by_id.size() ? detail::subtype_properties_by_id[subtype_id]
+                                                                : PROP_NONE;
+}
+
+// O(1) classification of ids, unknown ids have no property
+
+constexpr bool is_container(uint16_t type_id)
+{
+    return type_properties(type_id) & PROP_CONTAINER;
+}
+
+constexpr bool is_power_device(uint16_t subtype_id)
+{
+    return subtype_properties(subtype_id) & PROP_POWER;
+}
+
+constexpr bool is_virtualization(uint16_t subtype_id)
+{
+    return subtype_properties(subtype_id) & PROP_VIRTUALIZATION;
+}
+
+constexpr bool is_connector(uint16_t subtype_id)
+{
+    return subtype_properties(subtype_id) & PROP_CONNECTOR;
+}
+
+constexpr bool is_sensor(uint16_t subtype_id)
+{
+    return subtype_properties(subtype_id) & PROP_SENSOR;
+}
+
+constexpr bool is_actuator(uint16_t subtype_id)
+{
+    return subtype_properties(subtype_id) & PROP_ACTUATOR;
+}
+
 bool is_epdu(int x);
 
 bool is_pdu(int x);
@@ -288,9 +406,40 @@ bool is_ok_element_type(uint16_t element_type_id);
 
 bool is_ok_name(const char* name);
 
+// is_ok_name with normalization: name must also be valid UTF-8, and if it isn't in NFC, *normalized receives its NFC
+// form (names typed on different clients may come composed or decomposed). *normalized is cleared otherwise, which
+// doesn't allocate for the usual names already in NFC.
+bool is_ok_name(const char* name, std::string* normalized);
+
 bool is_ok_keytag(const char* keytag);
 
 bool is_ok_value(const char* value);
 
 bool is_ok_link_type(uint8_t link_type_id);
+
+// errors of a row checked by validate_columns
+enum asset_row_error : uint8_t
+{
+    ROW_OK         = 0,
+    ROW_BAD_NAME   = 1u << 0, // is_ok_name fails
+    ROW_BAD_KEYTAG = 1u << 1, // is_ok_keytag fails
+    ROW_BAD_VALUE  = 1u << 2, // is_ok_value fails
+    ROW_BAD_UTF8   = 1u << 3, // a cell isn't valid UTF-8
+};
+
+// columns of an import, a column which is nullptr isn't checked
+struct AssetColumns
+{
+    const std::string_view* names   = nullptr;
+    const std::string_view* keytags = nullptr;
+    const std::string_view* values  = nullptr;
+    size_t                  rows    = 0;
+};
+
+/// \brief Batch version of is_ok_name, is_ok_keytag and is_ok_value for imports
+///
+/// Each cell is scanned once (16 bytes at a time with SSE2) for the characters forbidden in names, its length and
+/// UTF-8 validity. Batches of more than 16k rows are split across threads (0: one per core).
+/// \return asset_row_error bits of each row
+std::vector<uint8_t> validate_columns(const AssetColumns& columns, unsigned threads = 0);
 } // namespace persist
@@ -0,0 +1,206 @@
+/*  =========================================================================
+    fty_common_enum_codec - Conversions between enums and their names
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <type_traits>
+
+namespace fty {
+
+template <typename E>
+struct EnumName
+{
+    E                value;
+    std::string_view name;
+};
+
+/// \brief Names of the values of enum E, specialized next to E:
+///
+/// template <>
+/// struct EnumTraits<Color>
+/// {
+///     static constexpr EnumName<Color> names[] = {{Color::Red, "red"}, {Color::Blue, "blue"}, {Color::Blue, "navy"}};
+///     static constexpr Color            unknown      = Color::Red; // parse() of an unknown name
+///     static constexpr std::string_view unknown_name = "unknown";  // format() of a value without name
+///     static constexpr size_t           count        = 2;          // number of values, each must have a name
+/// };
+///
+/// The first name of a value is the one format() gives, the next ones are aliases only accepted by parse().
+/// Names are parsed case-insensitively (ASCII), but for their uppercase letters, which must match exactly ("N_A").
+template <typename E>
+struct EnumTraits;
+
+namespace detail {
+
+    constexpr char enum_fold(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+    }
+
+    // FNV-1a of the folded string
+    constexpr uint32_t enum_hash(std::string_view str, uint32_t seed)
+    {
+        uint32_t hash = 2166136261u ^ seed;
+        for (char c : str) {
+            hash ^= static_cast<unsigned char>(enum_fold(c));
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    constexpr bool enum_name_matches(std::string_view name, std::string_view str)
+    {
+        if (name.size() != str.size())
+            return false;
+        for (size_t i = 0; i < str.size(); i++)
+            if (name[i] != str[i] && name[i] != enum_fold(str[i]))
+                return false;
+        return true;
+    }
+
+    constexpr size_t enum_hash_size(size_t count)
+    {
+        size_t size = 16;
+        while (size < count * 8)
+            size *= 2;
+        return size;
+    }
+
+    // Perfect hash of the names, the seed is searched until no two names share a slot; a lookup is then one hash, one
+    // slot and one comparison
+    template <typename E, size_t Count>
+    struct EnumHash
+    {
+        static_assert(Count < 255, "slots are 8 bits");
+        static constexpr size_t Size = enum_hash_size(Count);
+
+        uint8_t  slots[Size] = {}; // index in names + 1, 0 if empty
+        uint32_t seed        = 0;
+        bool     valid       = false;
+
+        template <typename Names>
+        constexpr EnumHash(const Names& names)
+        {
+            for (uint32_t candidate = 0; candidate < 10000 && !valid; candidate++) {
+                for (auto& slot : slots)
+                    slot = 0;
+                seed  = candidate;
+                valid = true;
+                for (size_t i = 0; i < Count && valid; i++) {
+                    uint8_t& slot = slots[enum_hash(names[i].name, seed) & (Size - 1)];
+                    if (slot != 0)
+                        valid = false;
+                    slot = uint8_t(i + 1);
+                }
+            }
+        }
+    };
+
+} // namespace detail
+
+/// \brief Formats and parses the values of enum E from EnumTraits<E>, without allocation nor static initialization
+template <typename E>
+class EnumCodec
+{
+    using Traits = EnumTraits<E>;
+
+    static constexpr size_t NameCount = std::size(Traits::names);
+
+    // values index the format table
+    static constexpr size_t s_table_size()
+    {
+        size_t size = 0;
+        for (const auto& entry : Traits::names) {
+            if (static_cast<std::make_unsigned_t<std::underlying_type_t<E>>>(entry.value) >= 4096)
+                return 0;
+            size = std::max(size, static_cast<size_t>(entry.value) + 1);
+        }
+        return size;
+    }
+
+    static constexpr size_t TableSize = s_table_size();
+    static_assert(TableSize != 0, "enum values must be in [0, 4096)");
+
+    static constexpr std::array<std::string_view, TableSize> s_make_table()
+    {
+        std::array<std::string_view, TableSize> table = {};
+        for (auto& name : table)
+            name = Traits::unknown_name;
+        // first name of each value
+        for (size_t i = NameCount; i-- > 0;)
+            table[static_cast<size_t>(Traits::names[i].value)] = Traits::names[i].name;
+        return table;
+    }
+
+    static constexpr size_t s_value_count()
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < NameCount; i++) {
+            bool seen = false;
+            for (size_t j = 0; j < i; j++)
+                seen |= Traits::names[j].value == Traits::names[i].value;
+            count += !seen;
+        }
+        return count;
+    }
+
+    static_assert(s_value_count() == Traits::count, "each value of the enum must have a name");
+
+    static constexpr std::array<std::string_view, TableSize> s_table = s_make_table();
+
+    static constexpr detail::EnumHash<E, NameCount> s_hash {Traits::names};
+
+public:
+    /// \brief number of values of E
+    static constexpr size_t count = Traits::count;
+
+    /// \brief name of value, Traits::unknown_name if it has none
+    static constexpr std::string_view format(E value)
+    {
+        auto index = static_cast<size_t>(value);
+        return index < TableSize ? s_table[index] : Traits::unknown_name;
+    }
+
+    /// \brief value named name, false if there is none
+    static constexpr bool parse(std::string_view name, E& value)
+    {
+        static_assert(s_hash.valid, "no perfect hash found, names must be unique (case-insensitively)");
+        uint8_t slot = s_hash.slots[detail::enum_hash(name, s_hash.seed) & (s_hash.Size - 1)];
+        if (slot == 0 || !detail::enum_name_matches(Traits::names[slot - 1].name, name))
+            return false;
+        value = Traits::names[slot - 1].value;
+        return true;
+    }
+
+    /// \brief value named name, Traits::unknown if there is none
+    static constexpr E parse(std::string_view name)
+    {
+        E value = Traits::unknown;
+        return parse(name, value) ? value : Traits::unknown;
+    }
+};
+
+} // namespace fty
@@ -25,9 +25,21 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #ifdef __cplusplus
 
-// #include <dirent.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <dirent.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <unordered_map>
+#include <string_view>
 #include <sys/stat.h>
+#include <thread>
 #include <vector>
 
 namespace shared {
@@ -40,6 +52,8 @@ const char* path_separator();
 /**
  * \brief get the file mode
  * \param path to the file
+ *
+ * Goes through the StatCache given to set_stat_cache(), if any (as do is_file() and is_dir()).
  */
 mode_t file_mode(const char* path);
 
@@ -79,15 +93,549 @@ std::vector<std::string> files_in_directory(const char* path);
  */
 bool is_file_in_directory(const std::string& path, std::vector<std::string>& files);
 
+/**
+ * \brief type of a directory entry
+ */
+enum class FileType : uint8_t
+{
+    Unknown, // can't be determined, e.g. a dangling symbolic link
+    Regular,
+    Directory,
+    Symlink,
+    Other // device, fifo, socket
+};
+
+struct DirEntry
+{
+    std::string name;
+    FileType    type;
+};
+
+/**
+ * \brief list the entries of a directory but "." and "..", with their type, in one pass
+ * \param path to the directory
+ * \param entries the entries are appended to
+ * \param follow_symlinks give the type of the target of symbolic links, as stat() does (Unknown if dangling)
+ * \return false if the directory can't be read
+ *
+ * The type comes from dirent::d_type; fstatat() on the directory is only called for the entries of a file system
+ * which doesn't fill it (DT_UNKNOWN) and, when following them, for symbolic links.
+ */
+bool list_directory(const char* path, std::vector<DirEntry>& entries, bool follow_symlinks = true);
+
+/**
+ * \brief entry of a DirRange, valid until the iteration moves on
+ */
+struct DirView
+{
+    std::string_view name; // points in the buffer of the directory stream
+    FileType         type;
+    ino_t            inode;
+};
+
+/**
+ * \brief lazy listing of a directory, for range-for loops:
+ *
+ *     for (const auto& entry : shared::DirRange(path).ofType(shared::FileType::Regular).suffix(".rule"))
+ *         load(entry.name);
+ *
+ * Entries are read one at a time from the directory stream, so a loop may stop at its first match. "." and ".." are
+ * skipped unless dots(true). Filters compose: an entry must pass each kind of filter used, a kind of filter used more
+ * than once accepts any of its values. Name filters are applied before the type is resolved, so fstatat() only runs
+ * for the remaining DT_UNKNOWN entries and symbolic links (see list_directory()).
+ *
+ * A DirRange is read once: begin() continues where the previous iteration stopped.
+ */
+class DirRange
+{
+public:
+    class Iterator;
+    struct End
+    {
+    };
+
+    explicit DirRange(const char* path, bool follow_symlinks = true);
+    ~DirRange();
+
+    DirRange(DirRange&& other) noexcept;
+    DirRange& operator=(DirRange&& other) = delete;
+    DirRange(const DirRange&)             = delete;
+    DirRange& operator=(const DirRange&) = delete;
+
+    /// whether the directory could be opened
+    explicit operator bool() const
+    {
+        return m_dir != nullptr;
+    }
+
+    // filters of a temporary return it by value, so that it outlives a range-for on it
+
+    /// keep the entries of type
+    DirRange& ofType(FileType type) &;
+    DirRange  ofType(FileType type) &&
+    {
+        return std::move(ofType(type));
+    }
+    /// keep the entries whose name ends with suffix
+    DirRange& suffix(std::string suffix) &;
+    DirRange  suffix(std::string suffix) &&
+    {
+        return std::move(this->suffix(std::move(suffix)));
+    }
+    /// keep the entries whose name matches a shell wildcard pattern (fnmatch(3), a leading '.' must match a '.')
+    DirRange& glob(std::string pattern) &;
+    DirRange  glob(std::string pattern) &&
+    {
+        return std::move(glob(std::move(pattern)));
+    }
+    /// yield "." and ".." too
+    DirRange& dots(bool dots) &;
+    DirRange  dots(bool dots) &&
+    {
+        return std::move(this->dots(dots));
+    }
+
+    Iterator begin();
+    End      end() const
+    {
+        return {};
+    }
+
+private:
+    bool next();
+    bool matches(std::string_view name) const;
+
+    DIR*                     m_dir;
+    bool                     m_follow_symlinks;
+    bool                     m_dots  = false;
+    uint8_t                  m_types = 0; // 1 << FileType, 0 for any
+    std::vector<std::string> m_suffixes;
+    std::vector<std::string> m_patterns;
+    DirView                  m_current = {};
+};
+
+class DirRange::Iterator
+{
+public:
+    const DirView& operator*() const
+    {
+        return m_range->m_current;
+    }
+    const DirView* operator->() const
+    {
+        return &m_range->m_current;
+    }
+    Iterator& operator++()
+    {
+        m_end = !m_range->next();
+        return *this;
+    }
+    bool operator!=(End) const
+    {
+        return !m_end;
+    }
+    bool operator==(End) const
+    {
+        return m_end;
+    }
+
+private:
+    friend class DirRange;
+    Iterator(DirRange* range, bool end)
+        : m_range(range)
+        , m_end(end)
+    {
+    }
+
+    DirRange* m_range;
+    bool      m_end;
+};
+
+inline DirRange::Iterator DirRange::begin()
+{
+    return Iterator(this, !next());
+}
+
+/**
+ * \brief entry given to the visitor of walk(), valid during the call
+ */
+struct WalkEntry
+{
+    std::string_view name;
+    std::string_view directory; // path of the directory of the entry relative to the root, "" for the root
+    FileType         type;
+    ino_t            inode;
+    unsigned         depth;       // 0 for the entries of the root
+    int              directoryFd; // for the *at() functions on name
+
+    /// path of the entry relative to the root
+    std::string path() const;
+};
+
+enum class WalkAction : uint8_t
+{
+    Continue,
+    Skip, // don't descend into this directory
+    Stop  // end the walk
+};
+
+enum class SymlinkPolicy : uint8_t
+{
+    Report, // give symbolic links as such, don't follow them
+    Follow, // give the type of their target and descend into linked directories (each directory is visited once)
+    Ignore  // don't give them
+};
+
+struct WalkOptions
+{
+    unsigned                 maxDepth = UINT32_MAX; // 0 only gives the entries of the root
+    SymlinkPolicy            symlinks = SymlinkPolicy::Report;
+    unsigned                 threads  = 0; // 0 for one per core, the calling thread is one of them
+    const std::atomic<bool>* cancel   = nullptr; // the walk ends when it becomes true
+};
+
+/**
+ * \brief visit the entries below a directory, recursively
+ * \param path of the root directory
+ * \param visitor called for each entry, but "." and "..", concurrently from several threads if options.threads != 1;
+ *                its WalkAction for a directory decides whether the walk descends into it
+ * \return false if the root can't be opened or the walk was stopped or cancelled
+ *
+ * Directories are opened with openat() relative to their parent, so no path is built nor resolved per entry; the
+ * types come from dirent::d_type (see list_directory()). The subdirectories found are queued on the thread which
+ * found them and idle threads steal the oldest ones (the biggest subtrees), so sibling subtrees are scanned in
+ * parallel. Subdirectories which can't be opened are skipped.
+ */
+bool walk(const char* path, const std::function<WalkAction(const WalkEntry&)>& visitor,
+    const WalkOptions& options = WalkOptions());
+
+/**
+ * \brief change of a directory seen by a DirectoryWatcher
+ */
+struct DirChange
+{
+    enum class Kind : uint8_t
+    {
+        Added,   // created or moved in
+        Removed, // deleted or moved out
+        Modified // written and closed (inotify), new modification time or size (polling)
+    };
+
+    Kind        kind;
+    std::string name;
+};
+
+struct WatcherOptions
+{
+    /// called for each change from the thread of the watcher; without it the changes are queued for takeChanges()
+    std::function<void(const DirChange&)> callback;
+    /// period of the polling, when inotify can't be used
+    std::chrono::milliseconds pollInterval {1000};
+    /// poll even if inotify is available
+    bool forcePolling = false;
+};
+
+/**
+ * \brief cached listing of a directory, kept up to date by a thread
+ *
+ * The thread follows inotify events (create, delete, moves, close after write); if inotify is unavailable or the
+ * watch limit is reached, it polls the directory and compares the modification times and sizes of its entries.
+ * A directory which is missing, at start or after it was moved or deleted, is polled until it can be watched again.
+ * Reading the listing is then O(1) and doesn't touch the file system. Types follow symbolic links, as in
+ * list_directory(); "." and ".." are not listed.
+ */
+class DirectoryWatcher
+{
+public:
+    explicit DirectoryWatcher(const std::string& path, WatcherOptions options = WatcherOptions());
+    ~DirectoryWatcher();
+
+    DirectoryWatcher(const DirectoryWatcher&) = delete;
+    DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+    /// whether the directory could be listed at start
+    explicit operator bool() const
+    {
+        return m_valid;
+    }
+
+    /// whether changes currently come from inotify rather than from polling
+    bool usesInotify() const
+    {
+        return !m_polling;
+    }
+
+    /// entries of the directory, sorted by name; the listing isn't modified, later changes make a new one
+    std::shared_ptr<const std::vector<DirEntry>> snapshot() const;
+
+    /// changes queued since the last call (without callback)
+    std::vector<DirChange> takeChanges();
+
+    /// wait until a change is queued, false on timeout
+    bool waitForChanges(std::chrono::milliseconds timeout);
+
+private:
+    struct Cached
+    {
+        FileType        type;
+        struct timespec mtime;
+        off_t           size;
+    };
+
+    bool addWatch();
+    void run();
+    void readEvents(std::vector<DirChange>& changes);
+    void rescan(std::vector<DirChange>& changes);
+    bool cached(const char* name, Cached& entry);
+    void publish(std::vector<DirChange>& changes);
+
+    std::string       m_path;
+    std::string       m_entryPath; // buffer of cached(), used by the thread of the watcher
+    WatcherOptions    m_options;
+    bool              m_valid   = false;
+    int               m_inotify = -1;
+    int               m_wakeup  = -1; // eventfd which stops the thread
+    int               m_watch   = -1; // inotify watch of m_path, -1 while polling
+    std::atomic<bool> m_polling {true};
+
+    mutable std::mutex                                   m_mutex;
+    std::condition_variable                              m_changed;
+    std::map<std::string, Cached>                        m_entries;
+    mutable std::shared_ptr<const std::vector<DirEntry>> m_snapshot; // null when m_entries changed
+    std::vector<DirChange>                               m_changes;
+    bool                                                 m_stopping = false;
+    std::thread                                          m_thread;
+};
+
+/**
+ * \brief cache of the modes of paths, opt-in through set_stat_cache()
+ *
+ * A mode (0 for a missing path) is kept until ttl expires or inotify reports a change of the entry in its parent
+ * directory, which is watched from the first lookup of a path in it; inotify is asynchronous, so a change may be
+ * seen a little late, and renames of the ancestors above the parent or changes of the target of a symbolic link only
+ * at expiry. Paths in a missing directory are not cached. Paths are keys as given: "a/b" and "./a/b" are two
+ * entries. Without inotify (or past the watch limit) only the ttl applies.
+ *
+ * At most max_entries paths are kept: a full shard drops its expired entries, then its oldest ones. A directory is
+ * watched as long as paths in it are cached, so the number of watches is bounded as well.
+ *
+ * Lookups from several threads are safe; a hit takes a shared lock and no syscall.
+ */
+class StatCache
+{
+public:
+    struct Stats
+    {
+        uint64_t hits;          // stat() calls saved
+        uint64_t misses;        // stat() calls done
+        uint64_t invalidations; // entries dropped on inotify events
+        uint64_t evictions;     // entries dropped to stay under max_entries
+        uint64_t watches;       // directories watched
+    };
+
+    explicit StatCache(std::chrono::milliseconds ttl = std::chrono::milliseconds(5000), bool use_inotify = true,
+        size_t max_entries = 65536);
+    ~StatCache();
+
+    StatCache(const StatCache&) = delete;
+    StatCache& operator=(const StatCache&) = delete;
+
+    /// mode of path as stat() gives it, 0 if it doesn't exist
+    mode_t mode(const char* path);
+
+    /// forget path, e.g. after changing it
+    void invalidate(const std::string& path);
+    /// forget everything
+    void clear();
+
+    Stats stats() const;
+
+    /// number of cached paths, expired ones included
+    size_t size() const;
+
+    /// whether inotify invalidates the entries
+    bool usesInotify() const
+    {
+        return m_inotify != -1;
+    }
+
+private:
+    static constexpr size_t SHARDS = 16;
+
+    struct Entry
+    {
+        mode_t                                mode;
+        std::chrono::steady_clock::time_point expiry;
+        uint64_t                              watch; // id of the watch counting the entry, 0 if none
+    };
+
+    struct Watch
+    {
+        int      wd;
+        uint64_t id;
+        size_t   users; // entries and lookups in progress under the prefix
+    };
+
+    // entries removed from a shard, to release from their watch once the shard is unlocked
+    using Released = std::vector<std::pair<std::string, uint64_t>>;
+
+    struct alignas(64) Shard
+    {
+        mutable std::shared_mutex              mutex;
+        std::unordered_map<std::string, Entry> entries;
+        uint64_t                               generation = 0; // bumped by each invalidation
+        std::atomic<uint64_t>                  hits {0};
+        std::atomic<uint64_t>                  misses {0};
+    };
+
+    Shard& shard(const std::string& path);
+    void   evict(Shard& s, std::chrono::steady_clock::time_point now, Released& released);
+    bool   drop(const std::string& path);
+    void   dropPrefix(const std::string& prefix);
+    bool   watch(const std::string& path, uint64_t& id);
+    void   unwatch(const std::string& path, uint64_t id);
+    void   unwatch(const Released& released);
+    void   run();
+
+    std::chrono::milliseconds m_ttl;
+    size_t                    m_shardCapacity;
+    Shard                     m_shards[SHARDS];
+    std::atomic<uint64_t>     m_invalidations {0};
+    std::atomic<uint64_t>     m_evictions {0};
+
+    int                                               m_inotify = -1;
+    int                                               m_wakeup  = -1; // eventfd which stops the thread
+    mutable std::mutex                                m_watchMutex;
+    std::unordered_map<int, std::vector<std::string>> m_watches;     // path prefixes by watch descriptor
+    std::unordered_map<std::string, Watch>            m_watchedDirs; // watches by path prefix
+    uint64_t                                          m_lastWatch = 0;
+    std::thread                                       m_thread;
+};
+
+/**
+ * \brief make file_mode(), is_file() and is_dir() use cache, nullptr to stop
+ * make_directories(), make_subdirectories() and mkdir_if_needed() don't read it, they invalidate the directories they
+ * create. The cache must outlive its use; a StatCache stops being used when destroyed.
+ */
+void set_stat_cache(StatCache* cache);
+
+/// forget path in the cache given to set_stat_cache(), if any, after changing it
+void invalidate_stat_cache(const char* path);
+
 /**
  * \brief create directory (if not exists
  * \param path to the newly created directory
  * \param mode (rights)
  * \param create_parent directories if needed
+ * \return true if path is a directory, created or not
  *
  * In case of failure also errno is set, see "man 3 mkdir" for details.
  */
-bool mkdir_if_needed(const char* path, mode_t mode = 0x755, bool create_parent = true);
+bool mkdir_if_needed(const char* path, mode_t mode = 0755, bool create_parent = true);
+
+/**
+ * \brief create directory path and its missing parents, like mkdir -p
+ * \param created gets the directories created, outermost first
+ * \return true if path is a directory, created or not; errno is set otherwise
+ *
+ * The path is walked once: mkdirat() starts from the deepest existing ancestor, held open, and a directory created
+ * meanwhile by another process (EEXIST) is fine.
+ */
+bool make_directories(const char* path, std::vector<std::string>& created, mode_t mode = 0755);
+
+/**
+ * \brief create directories names (relative paths) in parent, created if needed, through one descriptor of parent
+ * \param created gets the directories created, parent ones included, outermost first
+ * \return true if all are directories; errno of the last failure otherwise, the other names are still created
+ */
+bool make_subdirectories(const char* parent, const std::vector<std::string>& names, std::vector<std::string>& created,
+    mode_t mode = 0755);
+
+/**
+ * \brief read the whole file path into content
+ * \return false if it can't be opened or read, errno is set
+ *
+ * A regular file is read into a buffer of its size, usually in one read(); files which don't know their size (procfs,
+ * sysfs, pipes) are read by chunks until the end.
+ */
+bool read_file(const char* path, std::string& content);
+
+/**
+ * \brief read-only memory mapping of a whole regular file
+ *
+ * The content is paged in on access, without copy: better than read_file() for big files read once or in parts.
+ * A file truncated by another process while mapped gives SIGBUS, so map files which are replaced (renamed over),
+ * not rewritten in place. Files which don't know their size (procfs, sysfs) are seen empty, use read_file().
+ */
+class MappedFile
+{
+public:
+    /// madvise() hint about how the content will be read
+    enum class Advice
+    {
+        Normal,
+        Sequential,
+        Random,
+        WillNeed, // read ahead now
+    };
+
+    MappedFile() = default;
+    explicit MappedFile(const char* path, Advice advice = Advice::Sequential);
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// false if the file couldn't be opened or mapped, errno is set then
+    explicit operator bool() const
+    {
+        return m_valid;
+    }
+
+    std::string_view view() const
+    {
+        return {static_cast<const char*>(m_data), m_size};
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+private:
+    void*  m_data  = nullptr;
+    size_t m_size  = 0;
+    bool   m_valid = false;
+};
+
+/**
+ * \brief content of a file read by read_files()
+ */
+struct FileRead
+{
+    std::string content;
+    int         error = 0; // errno of the failure, 0 if read
+};
+
+struct ReadFilesOptions
+{
+    bool     ioUring = true; // false for the thread pool
+    unsigned threads = 0;    // of the thread pool, 0 for max(4, cores): the reads mostly wait on the disk
+};
+
+/**
+ * \brief read whole files at once, e.g. the rules listed by files_in_directory()
+ * \return the contents, in the order of paths
+ *
+ * With io_uring (Linux 5.6+), the openat(), read() and close() of the files are queued on one ring as they become
+ * possible, so cold reads reach the disk together and a few io_uring_enter() calls replace most syscalls (an fstat()
+ * per file sizes its buffer). Where io_uring is unavailable (older kernel or kernel headers, seccomp), read_file() is
+ * called from a pool of threads.
+ */
+std::vector<FileRead> read_files(
+    const std::vector<std::string>& paths, const ReadFilesOptions& options = ReadFilesOptions());
 
 /**
  * \brief return basename from given string
@@ -98,6 +646,41 @@ bool mkdir_if_needed(const char* path, mode_t mode = 0x755, bool create_parent =
  */
 std::string basename(const std::string& path);
 
+/**
+ * \brief lexical operations on paths, as views of their argument (or of a buffer given by the caller) which never
+ * allocate nor touch the file system; path_separator() is the separator
+ */
+namespace path {
+
+    /// component after the last separator: "c" for "a/b/c", "" for "a/b/"
+    std::string_view basename(std::string_view path);
+
+    /// what precedes the last separator, without trailing separators: "a/b" for "a/b/c" and "a/b/", "/" for "/a",
+    /// "" without separator
+    std::string_view dirname(std::string_view path);
+
+    /// extension of the basename from its last dot: ".json" for "a/b.rule.json", "" for ".profile" or "a.d/b"
+    std::string_view extension(std::string_view path);
+
+    /**
+     * \brief directory and name, with one separator between them unless directory is empty or ends with one
+     * \param buffer receives the result, reused from call to call it allocates only to grow
+     * \return view of buffer
+     */
+    std::string_view join(std::string& buffer, std::string_view directory, std::string_view name);
+
+    /**
+     * \brief lexically normal form of path: no duplicate or trailing separator, no "." and no ".." but leading ones
+     * ("a//./b/../c/" gives "a/c", "/../a" gives "/a", "a/../.." gives "..", "" gives ".")
+     * \param buffer receives the result, as for join()
+     * \return view of buffer
+     *
+     * Symbolic links are not resolved: "a/.." is "." even if a is a link to another directory.
+     */
+    std::string_view normalize(std::string& buffer, std::string_view path);
+
+} // namespace path
+
 } // namespace shared
 
 #endif //__cplusplus
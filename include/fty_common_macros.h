@@ -28,6 +28,10 @@
 
 #define TRANSLATE_ME(...) UTF8::jsonify_translation_string(__VA_ARGS__)
 
+// same as TRANSLATE_ME with arguments checked against the key at compile time, key must be a string literal
+// (xgettext needs --keyword=TRANSLATE_ME_CHECKED)
+#define TRANSLATE_ME_CHECKED(key, ...) UTF8::jsonify(UTF8_FORMAT(key), ##__VA_ARGS__)
+
 #else
 
 #define TRANSLATE_ME(...) utf8_jsonify_translation_string(__VA_ARGS__)
@@ -27,6 +27,65 @@
 
 #ifdef __cplusplus
 
+#include "fty_common_enum_codec.h"
+
+namespace fty {
+
+// averaging steps and types, AVG_STEPS and AVG_TYPES hold their names in this order
+enum class AvgStep
+{
+    Min15,
+    Min30,
+    Hour1,
+    Hour8,
+    Hour24,
+    Day7,
+    Day30
+};
+
+enum class AvgType
+{
+    ArithmeticMean,
+    Min,
+    Max,
+    Consumption
+};
+
+template <>
+struct EnumTraits<AvgStep>
+{
+    static constexpr EnumName<AvgStep> names[] = {
+        {AvgStep::Min15, "15m"},
+        {AvgStep::Min30, "30m"},
+        {AvgStep::Hour1, "1h"},
+        {AvgStep::Hour8, "8h"},
+        {AvgStep::Hour24, "24h"},
+        {AvgStep::Day7, "7d"},
+        {AvgStep::Day30, "30d"},
+    };
+
+    static constexpr AvgStep          unknown      = AvgStep::Min15;
+    static constexpr std::string_view unknown_name = "";
+    static constexpr size_t           count        = 7;
+};
+
+template <>
+struct EnumTraits<AvgType>
+{
+    static constexpr EnumName<AvgType> names[] = {
+        {AvgType::ArithmeticMean, "arithmetic_mean"},
+        {AvgType::Min, "min"},
+        {AvgType::Max, "max"},
+        {AvgType::Consumption, "consumption"},
+    };
+
+    static constexpr AvgType          unknown      = AvgType::ArithmeticMean;
+    static constexpr std::string_view unknown_name = "";
+    static constexpr size_t           count        = 4;
+};
+
+} // namespace fty
+
 #define AVG_STEPS_SIZE 7
 extern const char* AVG_STEPS[AVG_STEPS_SIZE];
 #define AVG_TYPES_SIZE 4
@@ -25,6 +25,9 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 
 #else
 
@@ -33,6 +36,10 @@
 #endif
 
 #include <stdarg.h>
+#include <stddef.h>
+
+typedef struct _zframe_t zframe_t;
+typedef struct _zmsg_t   zmsg_t;
 
 //  Self test of this class
 void fty_common_utf8_test(bool verbose);
@@ -50,6 +57,25 @@ char* utf8_bash_escape(const char* string);
 // C wrapper for UTF8::jsonify_translation_string
 char* utf8_jsonify_translation_string(const char* key, ...);
 
+// Length-aware variants of the wrappers above, writing into the caller's buffer
+// The output is written to out like snprintf does: truncated to size - 1 characters and NUL terminated unless size
+// is 0. The complete length (without the terminator) is stored to *needed when needed isn't NULL.
+// Return 0 when the complete output was written, -1 when it was truncated.
+int utf8_escape_n(const char* string, size_t length, char* out, size_t size, size_t* needed);
+int utf8_bash_escape_n(const char* string, size_t length, char* out, size_t size, size_t* needed);
+int utf8_jsonify_translation_string_n(char* out, size_t size, size_t* needed, const char* key, ...);
+int utf8_vajsonify_translation_string_n(char* out, size_t size, size_t* needed, const char* key, va_list args);
+
+// Variants creating a czmq frame with the output (without NUL terminator), NULL on failure
+zframe_t* utf8_escape_frame(const char* string, size_t length);
+zframe_t* utf8_bash_escape_frame(const char* string, size_t length);
+zframe_t* utf8_jsonify_translation_frame(const char* key, ...);
+
+// Variants appending a frame with the output to msg, return 0 on success, -1 on failure
+int utf8_escape_zmsg(zmsg_t* msg, const char* string, size_t length);
+int utf8_bash_escape_zmsg(zmsg_t* msg, const char* string, size_t length);
+int utf8_jsonify_translation_zmsg(zmsg_t* msg, const char* key, ...);
+
 #ifdef __cplusplus
 }
 #endif
@@ -77,9 +103,440 @@ std::string jsonify_translation_string(const char* key, ...);
 // Convert translation string + va_list into JSON
 std::string vajsonify_translation_string(const char* key, va_list args);
 
+/**
+ * \brief escape string like escape () does into out, without requiring NUL termination
+ * Output is written like snprintf does (see escape_to for contexts below).
+ * \return length of the complete escaped string
+ */
+size_t escape_to(const char* string, size_t length, char* out, size_t size);
+
+/**
+ * \brief decode JSON escape sequences (\" \\ \/ \b \f \n \r \t and \uXXXX, including surrogate pairs) in str
+ * The output is never longer than str, so out must have room for str.size () bytes; it is not NUL terminated.
+ * out may be str.data () itself to decode in place.
+ * \return length of the output, std::string::npos if str contains an invalid or truncated escape sequence
+ */
+size_t unescape_to(std::string_view str, char* out);
+
+// decode JSON escape sequences in str into out, false on invalid escape sequences
+bool unescape(std::string_view str, std::string& out);
+
+// decode JSON escape sequences in str, str is left unspecified on failure
+bool unescape_in_place(std::string& str);
+
 // escape string for use as a bash command parameter
 std::string bash_escape(std::string& param);
 
+// Output contexts of the escaping engine
+enum class EscapeContext
+{
+    Shell,        // backslash before shell special characters (same as bash_escape)
+    Json,         // content of a JSON string (RFC 8259), UTF-8 is kept as is
+    Csv,          // CSV field (RFC 4180), quoted only when needed
+    Xml,          // XML/HTML text or attribute value
+    SqlIdentifier // MySQL/MariaDB identifier, back-quoted
+};
+
+/**
+ * \brief escape str for the given context
+ * Output is written to out like snprintf does: truncated to size - 1 characters and always NUL terminated (unless
+ * size is 0), so escape_to(context, str, nullptr, 0) gives the needed size.
+ * \return length of the complete escaped string
+ */
+size_t escape_to(EscapeContext context, std::string_view str, char* out, size_t size);
+
+// escape str for the given context
+std::string escape_for(EscapeContext context, std::string_view str);
+
+// Result of the Unicode normalization quick check (UAX #15)
+enum class NfcQuickCheck
+{
+    Yes,  // str is in NFC
+    No,   // str is not in NFC (or isn't valid UTF-8)
+    Maybe // only a full normalization can tell
+};
+
+/**
+ * \brief NFC quick check of str, without any allocation
+ * Code points below U+0300 (ASCII, Latin-1, Latin Extended) can't change under normalization and take a fast path.
+ */
+NfcQuickCheck is_nfc_quick(std::string_view str);
+
+// whether str is valid UTF-8 in NFC, normalizes only when the quick check is not conclusive
+bool is_nfc(std::string_view str);
+
+// normalize str to NFC (canonical composition) into out, false if str isn't valid UTF-8
+bool to_nfc(std::string_view str, std::string& out);
+
+// Argument of UTF8::jsonify already serialized as JSON (e.g. a nested translation)
+// It is embedded as an object instead of a quoted string, without checking its content.
+struct RawJson
+{
+    std::string_view value;
+};
+
+namespace detail {
+
+// Argument categories of the formatting directives of a translation key
+enum class FormatArg : uint8_t
+{
+    Integer,
+    Floating,
+    String,
+    Char,
+    Pointer,
+    Star // '*' width or precision
+};
+
+struct FormatSpec
+{
+    static constexpr size_t MAX_ARGS = 32;
+
+    FormatArg args[MAX_ARGS] = {};
+    size_t    count          = 0;
+    bool      valid          = true;
+};
+
+constexpr bool is_format_flag(char c)
+{
+    return c == '-' || c == '+' || c == ' ' || c == '#' || c == '0' || c == '\'' || c == 'I';
+}
+
+constexpr bool is_format_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+constexpr void add_format_arg(FormatSpec& spec, FormatArg arg)
+{
+    if (spec.count == FormatSpec::MAX_ARGS) {
+        spec.valid = false;
+        return;
+    }
+    spec.args[spec.count++] = arg;
+}
+
+// parse one printf directive as cut out of the key by jsonify_translation_string
+constexpr void parse_format_directive(std::string_view directive, FormatSpec& spec)
+{
+    size_t i = 0;
+    while (i < directive.size()) {
+        if (directive[i] != '%') {
+            i++;
+            continue;
+        }
+        if (i + 1 < directive.size() && directive[i + 1] == '%') {
+            i += 2;
+            continue;
+        }
+        i++;
+
+        // positional arguments are not supported
+        size_t digits = i;
+        while (digits < directive.size() && is_format_digit(directive[digits]))
+            digits++;
+        if (digits != i && digits < directive.size() && directive[digits] == '$') {
+            spec.valid = false;
+            return;
+        }
+
+        while (i < directive.size() && is_format_flag(directive[i]))
+            i++;
+        if (i < directive.size() && directive[i] == '*') {
+            add_format_arg(spec, FormatArg::Star);
+            i++;
+        }
+        while (i < directive.size() && is_format_digit(directive[i]))
+            i++;
+        if (i < directive.size() && directive[i] == '.') {
+            i++;
+            if (i < directive.size() && directive[i] == '*') {
+                add_format_arg(spec, FormatArg::Star);
+                i++;
+            }
+            while (i < directive.size() && is_format_digit(directive[i]))
+                i++;
+        }
+        // length modifier
+        bool modified = false;
+        if (i < directive.size()) {
+            char c = directive[i];
+            if ((c == 'h' || c == 'l') && i + 1 < directive.size() && directive[i + 1] == c) {
+                modified = true;
+                i += 2;
+            } else if (c == 'h' || c == 'l' || c == 'q' || c == 'L' || c == 'j' || c == 'z' || c == 'Z' || c == 't') {
+                modified = true;
+                i++;
+            }
+        }
+        if (i == directive.size()) {
+            spec.valid = false;
+            return;
+        }
+        switch (directive[i]) {
+            case 'd':
+            case 'i':
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                add_format_arg(spec, FormatArg::Integer);
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                add_format_arg(spec, FormatArg::Floating);
+                break;
+            case 'c':
+                add_format_arg(spec, FormatArg::Char);
+                break;
+            case 's':
+                add_format_arg(spec, modified ? FormatArg::Pointer : FormatArg::String);
+                break;
+            case 'p':
+                add_format_arg(spec, FormatArg::Pointer);
+                break;
+            case 'm':
+                break;
+            default:
+                spec.valid = false;
+                return;
+        }
+        i++;
+    }
+}
+
+// compile-time counterpart of the key parsing done by jsonify_translation_string
+constexpr FormatSpec parse_format(std::string_view key)
+{
+    FormatSpec spec;
+    size_t     length = key.size();
+    // already in JSON format, arguments are ignored
+    if (length >= 2 && key[0] == '{' && key[1] != '{' && key[length - 2] != '}' && key[length - 1] == '}')
+        return spec;
+
+    size_t i = 0;
+    while (i < length) {
+        if (key[i] != '%') {
+            i++;
+            continue;
+        }
+        size_t start = i;
+        while (i < length) {
+            char c = key[i];
+            if (c == ' ' || c == '"' || c == '(' || c == ')' || c == '[' || c == ']')
+                break;
+            if (c == '\'' && key[i - 1] != '%')
+                break;
+            i++;
+            if (i - start == 2 && key[start + 1] == 's')
+                break;
+        }
+        parse_format_directive(key.substr(start, i - start), spec);
+        if (!spec.valid)
+            return spec;
+    }
+    return spec;
+}
+
+template <typename T>
+constexpr bool accepts_format_arg(FormatArg arg)
+{
+    using U = std::decay_t<T>;
+    switch (arg) {
+        case FormatArg::Integer:
+        case FormatArg::Char:
+        case FormatArg::Star:
+            return std::is_integral_v<U>;
+        case FormatArg::Floating:
+            return std::is_floating_point_v<U>;
+        case FormatArg::String:
+            return std::is_convertible_v<const T&, std::string_view> || std::is_same_v<U, std::nullptr_t> ||
+                   std::is_same_v<U, RawJson>;
+        case FormatArg::Pointer:
+            return std::is_pointer_v<U> || std::is_same_v<U, std::nullptr_t>;
+    }
+    return false;
+}
+
+template <typename... Args, size_t... I>
+constexpr bool accepts_format_args(const FormatSpec& spec, std::index_sequence<I...>)
+{
+    return (accepts_format_arg<Args>(spec.args[I]) && ...);
+}
+
+// Type-erased argument of the typed translation interface
+struct TranslationArg
+{
+    enum class Type : uint8_t
+    {
+        Signed,
+        Unsigned,
+        Floating,
+        String,
+        Pointer
+    };
+
+    Type               type       = Type::Signed;
+    long long          i          = 0;
+    unsigned long long u          = 0;
+    long double        d          = 0;
+    const void*        p          = nullptr;
+    std::string_view   str;
+    bool               terminated = true;  // str is followed by a NUL character
+    bool               json       = false; // str is serialized JSON
+};
+
+template <typename T>
+TranslationArg make_translation_arg(const T& value)
+{
+    using U = std::decay_t<T>;
+    TranslationArg arg;
+    if constexpr (std::is_same_v<U, std::nullptr_t>) {
+        arg.type = TranslationArg::Type::String;
+    } else if constexpr (std::is_same_v<U, RawJson>) {
+        arg.type       = TranslationArg::Type::String;
+        arg.str        = value.value;
+        arg.p          = arg.str.data() ? arg.str.data() : "";
+        arg.terminated = false;
+        arg.json       = true;
+    } else if constexpr (std::is_same_v<U, std::string>) {
+        arg.type = TranslationArg::Type::String;
+        arg.p    = value.c_str();
+        arg.str  = value;
+    } else if constexpr (std::is_convertible_v<const T&, const char*>) {
+        const char* str = value;
+        arg.type        = TranslationArg::Type::String;
+        arg.p           = str;
+        if (str)
+            arg.str = str;
+    } else if constexpr (std::is_convertible_v<const T&, std::string_view>) {
+        arg.type       = TranslationArg::Type::String;
+        arg.str        = value;
+        arg.p          = arg.str.data() ? arg.str.data() : "";
+        arg.terminated = false;
+    } else if constexpr (std::is_floating_point_v<U>) {
+        arg.type = TranslationArg::Type::Floating;
+        arg.d    = value;
+    } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+        arg.type = TranslationArg::Type::Signed;
+        arg.i    = value;
+        arg.u    = static_cast<unsigned long long>(arg.i);
+    } else if constexpr (std::is_integral_v<U>) {
+        arg.type = TranslationArg::Type::Unsigned;
+        arg.u    = value;
+        arg.i    = static_cast<long long>(arg.u);
+    } else {
+        static_assert(std::is_pointer_v<U>, "unsupported translation argument type");
+        arg.type = TranslationArg::Type::Pointer;
+        arg.p    = value;
+    }
+    return arg;
+}
+
+// render a translation key from already type-checked arguments
+std::string jsonify_translation_args(const char* key, const TranslationArg* args, size_t count);
+
+} // namespace detail
+
+// Type-safe counterpart of jsonify_translation_string
+// The key is given by UTF8_FORMAT("...") so that its formatting directives are parsed at compile time and checked
+// against the argument types, e.g.
+//     UTF8::jsonify(UTF8_FORMAT("Value of %s is %.2f"), name, value);
+// std::string and std::string_view are accepted for %s. The output is the same as jsonify_translation_string.
+// Nested translations passed as UTF8::RawJson are embedded without being scanned.
+template <typename Format, typename... Args>
+std::string jsonify(Format, const Args&... args)
+{
+    constexpr detail::FormatSpec spec = detail::parse_format(Format::value());
+    static_assert(spec.valid, "unsupported formatting directive in translation key");
+    static_assert(spec.count == sizeof...(Args), "number of arguments does not match the translation key");
+    static_assert(detail::accepts_format_args<Args...>(spec, std::index_sequence_for<Args...>{}),
+        "argument type does not match its formatting directive");
+
+    if constexpr (sizeof...(Args) == 0) {
+        return detail::jsonify_translation_args(Format::value().data(), nullptr, 0);
+    } else {
+        const detail::TranslationArg converted[] = {detail::make_translation_arg(args)...};
+        return detail::jsonify_translation_args(Format::value().data(), converted, sizeof...(Args));
+    }
+}
+
+/**
+ * \brief Read-only gettext message catalog (compiled .mo file) mapped in memory
+ *
+ * Lookups go through the hash table of the catalog and don't allocate; the file is mapped shared, so processes using
+ * the same catalog share one physical copy of it. Keys are the "key" members produced by jsonify_translation_string,
+ * i.e. with {{varN}} placeholders.
+ */
+class MessageCatalog
+{
+public:
+    MessageCatalog() = default;
+    ~MessageCatalog();
+
+    MessageCatalog(const MessageCatalog&) = delete;
+    MessageCatalog& operator=(const MessageCatalog&) = delete;
+    MessageCatalog(MessageCatalog&& other) noexcept;
+    MessageCatalog& operator=(MessageCatalog&& other) noexcept;
+
+    /**
+     * \brief map the .mo file, closes the previously opened one
+     * \return false if the file can't be read or is not a valid catalog
+     */
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    /// number of messages in the catalog
+    size_t size() const;
+
+    /**
+     * \brief translation of msgid
+     * \return the translation (first plural form), empty if msgid is not in the catalog
+     */
+    std::string_view lookup(std::string_view msgid) const;
+
+    /**
+     * \brief translate key and replace its {{varN}} placeholders by vars[N - 1]
+     * Untranslated keys are rendered as they are. Output is written to out like snprintf does: truncated to size - 1
+     * characters and always NUL terminated (unless size is 0).
+     * \return length of the complete output
+     */
+    size_t render(std::string_view key, const std::string_view* vars, size_t count, char* out, size_t size) const;
+
+private:
+    uint32_t         word(size_t offset) const;
+    std::string_view entry(uint32_t table, uint32_t index) const;
+
+    const char* m_data         = nullptr;
+    size_t      m_size         = 0;
+    bool        m_swap         = false;
+    uint32_t    m_count        = 0;
+    uint32_t    m_originals    = 0;
+    uint32_t    m_translations = 0;
+    uint32_t    m_hashSize     = 0;
+    uint32_t    m_hashTable    = 0;
+};
+
 } // namespace UTF8
 
+// Compile-time translation key for UTF8::jsonify, str must be a string literal
+#define UTF8_FORMAT(str)                                                                                               \
+    [] {                                                                                                               \
+        struct Format                                                                                                  \
+        {                                                                                                              \
+            static constexpr std::string_view value()                                                                  \
+            {                                                                                                          \
+                return str;                                                                                            \
+            }                                                                                                          \
+        };                                                                                                             \
+        return Format{};                                                                                               \
+    }()
+
 #endif
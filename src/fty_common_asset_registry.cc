@@ -0,0 +1,402 @@
+/*  =========================================================================
+    fty_common_asset_registry - Asset types and subtypes added at runtime
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_common_asset_registry - Asset types and subtypes added at runtime
+@discuss
+@end
+*/
+
+#include "fty_common_asset_registry.h"
+#include "fty_common_filesystem.h"
+#include "fty_common_json.h"
+#include <algorithm>
+#include <cxxtools/serializationinfo.h>
+#include <fty_log.h>
+#include <string.h>
+
+namespace persist {
+
+static char s_fold(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+}
+
+static std::string s_lowercase(std::string_view str)
+{
+    std::string result(str);
+    std::transform(result.begin(), result.end(), result.begin(), s_fold);
+    return result;
+}
+
+// compares str, folded, with name which is lowercase
+static int s_compare_folded(std::string_view name, std::string_view str)
+{
+    size_t length = std::min(name.size(), str.size());
+    for (size_t i = 0; i < length; i++) {
+        char c = s_fold(str[i]);
+        if (name[i] != c)
+            return static_cast<unsigned char>(name[i]) < static_cast<unsigned char>(c) ? -1 : 1;
+    }
+    return name.size() == str.size() ? 0 : (name.size() < str.size() ? -1 : 1);
+}
+
+// whether name or id is one of the built-in ones (count is NB_ASSET_*); the ids without built-in name, the gaps of
+// the lists, are free but for 0 (unknown)
+template <typename E>
+static bool s_builtin(const AssetRegistry::Entry& entry, uint16_t count)
+{
+    if (entry.id == 0)
+        return true;
+    if (entry.id < count && fty::EnumCodec<E>::format(E(entry.id)) != fty::EnumTraits<E>::unknown_name)
+        return true;
+    for (const auto& builtin : fty::EnumTraits<E>::names)
+        if (s_compare_folded(entry.name, builtin.name) == 0)
+            return true;
+    return false;
+}
+
+AssetRegistry::AssetRegistry() = default;
+
+AssetRegistry::~AssetRegistry() = default;
+
+AssetRegistry& AssetRegistry::instance()
+{
+    static AssetRegistry registry;
+    return registry;
+}
+
+const AssetRegistry::Entry* AssetRegistry::find(const Table& table, uint16_t id)
+{
+    if (id >= table.byId.size() || table.byId[id] == 0)
+        return nullptr;
+    return &table.entries[table.byId[id] - 1];
+}
+
+const AssetRegistry::Entry* AssetRegistry::find(const Table& table, std::string_view name)
+{
+    auto it = std::lower_bound(table.byName.begin(), table.byName.end(), name, [&](size_t index, std::string_view str) {
+        return s_compare_folded(table.entries[index].name, str) < 0;
+    });
+    if (it == table.byName.end() || s_compare_folded(table.entries[*it].name, name) != 0)
+        return nullptr;
+    return &table.entries[*it];
+}
+
+// adds entries to table, false if one clashes with an entry of another id or name
+template <typename E>
+static bool s_add(
+    std::vector<AssetRegistry::Entry>& table, const std::vector<AssetRegistry::Entry>& entries, uint16_t count)
+{
+    for (const auto& entry : entries) {
+        AssetRegistry::Entry added = {entry.id, s_lowercase(entry.name), entry.properties};
+        if (added.id == 0xFFFF || added.name.empty() || s_builtin<E>(added, count)) {
+            log_error("Asset registry: invalid or built-in entry %u '%s'", unsigned(entry.id), entry.name.c_str());
+            return false;
+        }
+        auto same = std::find_if(table.begin(), table.end(), [&](const AssetRegistry::Entry& known) {
+            return known.id == added.id || known.name == added.name;
+        });
+        if (same == table.end()) {
+            table.push_back(std::move(added));
+        } else if (same->id != added.id || same->name != added.name) {
+            log_error("Asset registry: entry %u '%s' clashes with %u '%s'", unsigned(entry.id), entry.name.c_str(),
+                unsigned(same->id), same->name.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AssetRegistry::add(const std::vector<Entry>& types, const std::vector<Entry>& subtypes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const Snapshot*    current = m_current.load(std::memory_order_relaxed);
+    std::vector<Entry> type_entries;
+    std::vector<Entry> subtype_entries;
+    if (current) {
+        type_entries    = current->types.entries;
+        subtype_entries = current->subtypes.entries;
+    }
+    if (!s_add<asset_type>(type_entries, types, NB_ASSET_TYPES) ||
+        !s_add<asset_subtype>(subtype_entries, subtypes, NB_ASSET_SUBTYPES))
+        return false;
+
+    auto snapshot = std::make_unique<Snapshot>();
+    auto build    = [](Table& table, std::vector<Entry>&& entries) {
+        table.entries = std::move(entries);
+        for (size_t i = 0; i < table.entries.size(); i++) {
+            uint16_t id = table.entries[i].id;
+            if (id >= table.byId.size())
+                table.byId.resize(size_t(id) + 1, 0);
+            table.byId[id] = i + 1;
+            table.byName.push_back(i);
+        }
+        std::sort(table.byName.begin(), table.byName.end(), [&](size_t a, size_t b) {
+            return table.entries[a].name < table.entries[b].name;
+        });
+    };
+    build(snapshot->types, std::move(type_entries));
+    build(snapshot->subtypes, std::move(subtype_entries));
+
+    m_current.store(snapshot.get(), std::memory_order_release);
+    m_snapshots.push_back(std::move(snapshot));
+    return true;
+}
+
+uint16_t AssetRegistry::typeId(std::string_view name) const
+{
+    asset_type type;
+    if (fty::EnumCodec<asset_type>::parse(name, type))
+        return type;
+    const Snapshot* snapshot = m_current.load(std::memory_order_acquire);
+    const Entry*    entry    = snapshot ? find(snapshot->types, name) : nullptr;
+    return entry ? entry->id : uint16_t(TUNKNOWN);
+}
+
+uint16_t AssetRegistry::subtypeId(std::string_view name) const
+{
+    asset_subtype subtype;
+    if (fty::EnumCodec<asset_subtype>::parse(name, subtype))
+        return subtype;
+    const Snapshot* snapshot = m_current.load(std::memory_order_acquire);
+    const Entry*    entry    = snapshot ? find(snapshot->subtypes, name) : nullptr;
+    return entry ? entry->id : uint16_t(SUNKNOWN);
+}
+
+std::string_view AssetRegistry::typeName(uint16_t id) const
+{
+    std::string_view name = typeid_to_type_view(id);
+    if (name != ::fty::TYPE_UNKNOWN)
+        return name;
+    const Snapshot* snapshot = m_current.load(std::memory_order_acquire);
+    const Entry*    entry    = snapshot ? find(snapshot->types, id) : nullptr;
+    return entry ? std::string_view(entry->name) : name;
+}
+
+std::string_view AssetRegistry::subtypeName(uint16_t id) const
+{
+    std::string_view name = subtypeid_to_subtype_view(id);
+    if (name != ::fty::SUB_UNKNOWN)
+        return name;
+    const Snapshot* snapshot = m_current.load(std::memory_order_acquire);
+    const Entry*    entry    = snapshot ? find(snapshot->subtypes, id) : nullptr;
+    return entry ? std::string_view(entry->name) : name;
+}
+
+uint32_t AssetRegistry::typeProperties(uint16_t id) const
+{
+    if (typeid_to_type_view(id) != ::fty::TYPE_UNKNOWN)
+        return type_properties(id);
+    const Snapshot* snapshot = m_current.load(std::memory_order_acquire);
+    const Entry*    entry    = snapshot ? find(snapshot->types, id) : nullptr;
+    return entry ? entry->properties : uint32_t(PROP_NONE);
+}
+
+uint32_t AssetRegistry::subtypeProperties(uint16_t id) const
+{
+    if (subtypeid_to_subtype_view(id) != ::fty::SUB_UNKNOWN)
+        return subtype_properties(id);
+    const Snapshot* snapshot = m_current.load(std::memory_order_acquire);
+    const Entry*    entry    = snapshot ? find(snapshot->subtypes, id) : nullptr;
+    return entry ? entry->properties : uint32_t(PROP_NONE);
+}
+
+size_t AssetRegistry::addedTypes() const
+{
+    const Snapshot* snapshot = m_current.load(std::memory_order_acquire);
+    return snapshot ? snapshot->types.entries.size() : 0;
+}
+
+size_t AssetRegistry::addedSubtypes() const
+{
+    const Snapshot* snapshot = m_current.load(std::memory_order_acquire);
+    return snapshot ? snapshot->subtypes.entries.size() : 0;
+}
+
+// Loaders
+
+static bool s_read_entries(
+    const cxxtools::SerializationInfo& si, const char* member, std::vector<AssetRegistry::Entry>& entries)
+{
+    const cxxtools::SerializationInfo* list = si.findMember(member);
+    if (!list)
+        return true;
+    for (const auto& item : *list) {
+        AssetRegistry::Entry entry = {0, {}, PROP_NONE};
+        unsigned             id    = 0;
+        item.getMember("id") >>= id;
+        item.getMember("name") >>= entry.name;
+        if (id > 0xFFFF) {
+            log_error("Asset registry: id %u of '%s' is out of range", id, entry.name.c_str());
+            return false;
+        }
+        entry.id = uint16_t(id);
+        if (const cxxtools::SerializationInfo* properties = item.findMember("properties")) {
+            for (const auto& property : *properties) {
+                std::string   name;
+                asset_property flag;
+                property >>= name;
+                if (!fty::EnumCodec<asset_property>::parse(name, flag)) {
+                    log_error("Asset registry: unknown property '%s' of '%s'", name.c_str(), entry.name.c_str());
+                    return false;
+                }
+                entry.properties |= flag;
+            }
+        }
+        entries.push_back(std::move(entry));
+    }
+    return true;
+}
+
+bool AssetRegistry::loadJson(const std::string& path)
+{
+    std::vector<Entry> types;
+    std::vector<Entry> subtypes;
+    try {
+        cxxtools::SerializationInfo si;
+        JSON::readFromFile(path, si);
+        if (!s_read_entries(si, "types", types) || !s_read_entries(si, "subtypes", subtypes))
+            return false;
+    } catch (const std::exception& e) {
+        log_error("Asset registry: can't read %s: %s", path.c_str(), e.what());
+        return false;
+    }
+    return add(types, subtypes);
+}
+
+// parses the tuples (id,'name') of an INSERT statement, false on syntax error
+static bool s_parse_values(std::string_view values, std::vector<AssetRegistry::Entry>& entries)
+{
+    size_t pos  = 0;
+    auto   skip = [&] {
+        while (pos < values.size() && (values[pos] == ' ' || values[pos] == '\n' || values[pos] == '\t'))
+            pos++;
+    };
+    while (true) {
+        skip();
+        if (pos >= values.size() || values[pos] != '(')
+            return false;
+        pos++;
+        skip();
+        unsigned id     = 0;
+        size_t   digits = 0;
+        for (; pos < values.size() && values[pos] >= '0' && values[pos] <= '9'; pos++, digits++)
+            id = id * 10 + unsigned(values[pos] - '0');
+        if (digits == 0 || digits > 5 || id > 0xFFFF)
+            return false;
+        skip();
+        if (pos >= values.size() || values[pos] != ',')
+            return false;
+        pos++;
+        skip();
+        if (pos >= values.size() || values[pos] != '\'')
+            return false;
+        std::string name;
+        // quotes are escaped as \' or ''
+        for (pos++; pos < values.size(); pos++) {
+            if (values[pos] == '\'' && (pos + 1 == values.size() || values[pos + 1] != '\''))
+                break;
+            if ((values[pos] == '\\' || values[pos] == '\'') && pos + 1 < values.size())
+                pos++;
+            name += values[pos];
+        }
+        if (pos >= values.size())
+            return false;
+        pos++;
+        skip();
+        if (pos >= values.size() || values[pos] != ')')
+            return false;
+        pos++;
+        entries.push_back({uint16_t(id), std::move(name), PROP_NONE});
+        skip();
+        if (pos < values.size() && values[pos] == ',') {
+            pos++;
+            continue;
+        }
+        skip();
+        return pos < values.size() && values[pos] == ';';
+    }
+}
+
+bool AssetRegistry::loadDbDump(const std::string& path)
+{
+    std::string dump;
+    if (!shared::read_file(path.c_str(), dump)) {
+        log_error("Asset registry: can't read %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    std::vector<Entry> types;
+    std::vector<Entry> subtypes;
+    const std::pair<std::string_view, std::vector<Entry>*> tables[] = {
+        {"t_bios_asset_element_type", &types}, {"t_bios_asset_device_type", &subtypes}};
+    static constexpr std::string_view insert = "INSERT INTO ";
+    for (size_t pos = dump.find(insert); pos != std::string::npos; pos = dump.find(insert, pos)) {
+        pos += insert.size();
+        // first ';' out of quotes
+        size_t end    = pos;
+        bool   quoted = false;
+        for (; end < dump.size() && (quoted || dump[end] != ';'); end++) {
+            if (dump[end] == '\\' && quoted)
+                end++;
+            else if (dump[end] == '\'')
+                quoted = !quoted;
+        }
+        if (end >= dump.size())
+            break;
+        std::string_view statement(dump.data() + pos, end + 1 - pos);
+        pos = end + 1;
+
+        std::string_view table = statement.substr(0, statement.find_first_of(" ("));
+        if (table.size() >= 2 && table.front() == '`' && table.back() == '`')
+            table = table.substr(1, table.size() - 2);
+        auto target = std::find_if(std::begin(tables), std::end(tables), [&](const auto& known) {
+            return known.first == table;
+        });
+        if (target == std::end(tables))
+            continue;
+        size_t values = statement.find("VALUES");
+        if (values == std::string_view::npos || !s_parse_values(statement.substr(values + 6), *target->second)) {
+            log_error("Asset registry: can't parse the INSERT INTO %.*s of %s", int(table.size()), table.data(),
+                path.c_str());
+            return false;
+        }
+    }
+
+    // the dump holds the built-in rows too
+    auto builtin = [](std::vector<Entry>& entries, auto tag) {
+        using E = decltype(tag);
+        entries.erase(std::remove_if(entries.begin(), entries.end(),
+                          [](const Entry& entry) {
+                              E value;
+                              return fty::EnumCodec<E>::parse(entry.name, value) && value == entry.id;
+                          }),
+            entries.end());
+    };
+    builtin(types, asset_type());
+    builtin(subtypes, asset_subtype());
+    return add(types, subtypes);
+}
+
+} // namespace persist
@@ -0,0 +1,230 @@
+/*  =========================================================================
+    fty_common_asset_topology - Containment tree of the assets
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_common_asset_topology - Containment tree of the assets
+@discuss
+@end
+*/
+
+#include "fty_common_asset_topology.h"
+#include <fty_log.h>
+
+namespace persist {
+
+bool AssetTopology::apply(
+    asset_operation operation, const std::string& name, const std::string& parent, uint16_t type, uint16_t subtype)
+{
+    switch (operation) {
+        case asset_operation::INSERT:
+        case asset_operation::UPDATE:
+            return insert(name, parent, type, subtype) != npos;
+        case asset_operation::DELETE:
+        case asset_operation::RETIRE: {
+            uint32_t node = find(name);
+            if (node == npos) {
+                log_debug("Asset topology: %s of unknown asset %s", operation2str(operation).c_str(), name.c_str());
+                return false;
+            }
+            remove(node);
+            return true;
+        }
+        case asset_operation::GET:
+        case asset_operation::INVENTORY:
+            break;
+    }
+    return true;
+}
+
+uint32_t AssetTopology::insert(const std::string& name, const std::string& parent, uint16_t type, uint16_t subtype)
+{
+    if (name.empty() || name == parent) {
+        log_error("Asset topology: invalid asset '%s' in '%s'", name.c_str(), parent.c_str());
+        return npos;
+    }
+    uint32_t node = find(name);
+    if (node == npos)
+        node = add(name);
+    uint32_t parent_node = npos;
+    if (!parent.empty()) {
+        parent_node = find(parent);
+        // its own event will come later
+        if (parent_node == npos)
+            parent_node = add(parent);
+    }
+    if (!move(node, parent_node)) {
+        log_error("Asset topology: %s can't be moved in its own subtree %s", name.c_str(), parent.c_str());
+        return npos;
+    }
+    m_nodes[node].type    = type;
+    m_nodes[node].subtype = subtype;
+    return node;
+}
+
+bool AssetTopology::move(uint32_t node, uint32_t parent)
+{
+    if (m_nodes[node].parent == parent)
+        return true;
+    if (parent != npos && (parent == node || isAncestor(node, parent)))
+        return false;
+    unlink(node);
+    link(node, parent);
+    m_indexed = false;
+    return true;
+}
+
+void AssetTopology::remove(uint32_t node)
+{
+    while (m_nodes[node].firstChild != npos) {
+        uint32_t child = m_nodes[node].firstChild;
+        unlink(child);
+        link(child, npos);
+    }
+    unlink(node);
+    m_index.erase(m_names[node]);
+    m_names[node].clear();
+    m_nodes[node] = Node();
+    m_free.push_back(node);
+    m_indexed = false;
+}
+
+uint32_t AssetTopology::add(const std::string& name)
+{
+    uint32_t node;
+    if (!m_free.empty()) {
+        node = m_free.back();
+        m_free.pop_back();
+        m_names[node] = name;
+    } else {
+        node = uint32_t(m_nodes.size());
+        m_nodes.emplace_back();
+        m_names.push_back(name);
+    }
+    m_index.emplace(name, node);
+    m_indexed = false;
+    return node;
+}
+
+// node, without parent, becomes the first child of parent
+void AssetTopology::link(uint32_t node, uint32_t parent)
+{
+    m_nodes[node].parent = parent;
+    if (parent == npos)
+        return;
+    uint32_t first             = m_nodes[parent].firstChild;
+    m_nodes[node].nextSibling  = first;
+    m_nodes[node].prevSibling  = npos;
+    m_nodes[parent].firstChild = node;
+    if (first != npos)
+        m_nodes[first].prevSibling = node;
+}
+
+void AssetTopology::unlink(uint32_t node)
+{
+    Node& n = m_nodes[node];
+    if (n.parent == npos)
+        return;
+    if (n.prevSibling != npos)
+        m_nodes[n.prevSibling].nextSibling = n.nextSibling;
+    else
+        m_nodes[n.parent].firstChild = n.nextSibling;
+    if (n.nextSibling != npos)
+        m_nodes[n.nextSibling].prevSibling = n.prevSibling;
+    n.parent      = npos;
+    n.nextSibling = npos;
+    n.prevSibling = npos;
+}
+
+uint32_t AssetTopology::next(uint32_t node, uint32_t root) const
+{
+    if (m_nodes[node].firstChild != npos)
+        return m_nodes[node].firstChild;
+    for (; node != root; node = m_nodes[node].parent)
+        if (m_nodes[node].nextSibling != npos)
+            return m_nodes[node].nextSibling;
+    return npos;
+}
+
+void AssetTopology::reindex()
+{
+    m_order.clear();
+    m_order.reserve(m_index.size());
+    for (uint32_t root = 0; root < m_nodes.size(); root++) {
+        if (m_nodes[root].parent != npos || m_names[root].empty())
+            continue;
+        // iterative depth-first walk, exit is set when leaving a subtree
+        uint32_t node = root;
+        while (true) {
+            m_nodes[node].enter = uint32_t(m_order.size());
+            m_order.push_back(node);
+            if (m_nodes[node].firstChild != npos) {
+                node = m_nodes[node].firstChild;
+                continue;
+            }
+            for (;; node = m_nodes[node].parent) {
+                m_nodes[node].exit = uint32_t(m_order.size());
+                if (node == root || m_nodes[node].nextSibling != npos)
+                    break;
+            }
+            if (node == root)
+                break;
+            node = m_nodes[node].nextSibling;
+        }
+    }
+    m_indexed = true;
+}
+
+uint32_t AssetTopology::find(const std::string& name) const
+{
+    auto it = m_index.find(name);
+    return it == m_index.end() ? npos : it->second;
+}
+
+bool AssetTopology::isAncestor(uint32_t ancestor, uint32_t node) const
+{
+    if (m_indexed)
+        return m_nodes[ancestor].enter < m_nodes[node].enter && m_nodes[node].enter < m_nodes[ancestor].exit;
+    for (node = m_nodes[node].parent; node != npos; node = m_nodes[node].parent)
+        if (node == ancestor)
+            return true;
+    return false;
+}
+
+uint32_t AssetTopology::ancestorOfType(uint32_t node, uint16_t type) const
+{
+    for (node = m_nodes[node].parent; node != npos; node = m_nodes[node].parent)
+        if (m_nodes[node].type == type)
+            return node;
+    return npos;
+}
+
+std::vector<uint32_t> AssetTopology::descendants(uint32_t node, uint16_t subtype) const
+{
+    std::vector<uint32_t> result;
+    forEachDescendant(node, [&](uint32_t descendant) {
+        if (subtype == SUNKNOWN || m_nodes[descendant].subtype == subtype)
+            result.push_back(descendant);
+    });
+    return result;
+}
+
+} // namespace persist
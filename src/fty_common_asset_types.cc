@@ -27,10 +27,16 @@
 */
 
 #include "fty_common_asset_types.h"
+#include "fty_common_asset_registry.h"
+#include "fty_common_utf8.h"
 #include <array>
 #include <functional>
-#include <map>
+#include <string_view>
 #include <string.h>
+#include <thread>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 // t_bios_asset_ext_attributes.keytag
 #define MAX_KEYTAG_LENGTH 40
@@ -39,212 +45,117 @@
 
 namespace persist {
 
-// CAUTION: THESE MAPS MUST REFLECT (PARTS OF) THE DATABASE
-// select * from t_bios_asset_element_type order by id_asset_element_type asc;
-// select * from t_bios_asset_device_type order by id_asset_device_type asc;
-// Note: except for "N_A", all string tokens below *must* be lowercase
-
-// clang-format off
-const static std::map<uint16_t, std::string> type_names {
-    { asset_type::TUNKNOWN,         ::fty::TYPE_UNKNOWN }, // **must* be set
-    { asset_type::GROUP,            ::fty::TYPE_GROUP },
-    { asset_type::DATACENTER,       ::fty::TYPE_DATACENTER },
-    { asset_type::ROOM,             ::fty::TYPE_ROOM },
-    { asset_type::ROW,              ::fty::TYPE_ROW },
-    { asset_type::RACK,             ::fty::TYPE_RACK },
-    { asset_type::DEVICE,           ::fty::TYPE_DEVICE },
-    { asset_type::INFRA_SERVICE,    ::fty::TYPE_INFRA_SERVICE },
-    { asset_type::CLUSTER,          ::fty::TYPE_CLUSTER },
-    { asset_type::HYPERVISOR,       ::fty::TYPE_HYPERVISOR },
-    { asset_type::VIRTUAL_MACHINE,  ::fty::TYPE_VIRTUAL_MACHINE },
-    { asset_type::STORAGE_SERVICE,  ::fty::TYPE_STORAGE_SERVICE },
-    { asset_type::VAPP,             ::fty::TYPE_VAPP },
-    { asset_type::CONNECTOR,        ::fty::TYPE_CONNECTOR },
-    { asset_type::TSERVER,          ::fty::TYPE_SERVER },
-    { asset_type::PLANNER,          ::fty::TYPE_PLANNER },
-    { asset_type::PLAN,             ::fty::TYPE_PLAN },
-    { asset_type::COPS,             ::fty::TYPE_COPS }, // Composite Power System
-    { asset_type::OPERATING_SYSTEM, ::fty::TYPE_OPERATING_SYSTEM },
-    { asset_type::HOST_GROUP,       ::fty::TYPE_HOST_GROUP }
-};
-
-const static std::map<uint16_t, std::string> subtype_names {
-    { asset_subtype::SUNKNOWN, ::fty::SUB_UNKNOWN }, // **must* be set
-
-    { asset_subtype::UPS,     ::fty::SUB_UPS },
-    { asset_subtype::GENSET,  ::fty::SUB_GENSET },
-    { asset_subtype::EPDU,    ::fty::SUB_EPDU },
-    { asset_subtype::PDU,     ::fty::SUB_PDU },
-    { asset_subtype::SERVER,  ::fty::SUB_SERVER },
-    { asset_subtype::FEED,    ::fty::SUB_FEED },
-    { asset_subtype::STS,     ::fty::SUB_STS },
-    { asset_subtype::SWITCH,  ::fty::SUB_SWITCH },
-    { asset_subtype::STORAGE, ::fty::SUB_STORAGE },
-    { asset_subtype::VIRTUAL, ::fty::SUB_VM },
-    { asset_subtype::VM,      ::fty::SUB_VM },
-    { asset_subtype::N_A,     ::fty::SUB_N_A },
-
-    { asset_subtype::ROUTER,         ::fty::SUB_ROUTER },
-    { asset_subtype::RACKCONTROLLER, ::fty::SUB_RACK_CONTROLLER },
-    { asset_subtype::SENSOR,         ::fty::SUB_SENSOR },
-    { asset_subtype::APPLIANCE,      ::fty::SUB_APPLIANCE },
-    { asset_subtype::CHASSIS,        ::fty::SUB_CHASSIS },
-    { asset_subtype::PATCHPANEL,     ::fty::SUB_PATCH_PANEL },
-    { asset_subtype::OTHER,          ::fty::SUB_OTHER },
-    { asset_subtype::SENSORGPIO,     ::fty::SUB_SENSORGPIO },
-
-    { asset_subtype::GPO,                     ::fty::SUB_GPO },
-    { asset_subtype::NETAPP_ONTAP_NODE,       ::fty::SUB_NETAPP_ONTAP_NODE },
-    { asset_subtype::IPMINFRA_SERVER,         ::fty::SUB_IPMINFRA_SERVER },
-    { asset_subtype::IPMINFRA_SERVICE,        ::fty::SUB_IPMINFRA_SERVICE },
-    { asset_subtype::VMWARE_VCENTER,          ::fty::SUB_VMWARE_VCENTER },
-    { asset_subtype::CITRIX_POOL,             ::fty::SUB_CITRIX_POOL },
-    { asset_subtype::VMWARE_CLUSTER,          ::fty::SUB_VMWARE_CLUSTER },
-    { asset_subtype::VMWARE_ESXI,             ::fty::SUB_VMWARE_ESXI },
-    { asset_subtype::MICROSOFT_HYPERV_SERVER, ::fty::SUB_MICROSOFT_HYPERV_SERVER },
-    { asset_subtype::VMWARE_VM,               ::fty::SUB_VMWARE_VM },
-
-    { asset_subtype::CITRIX_VM,                         ::fty::SUB_CITRIX_VM },
-    { asset_subtype::NETAPP_NODE,                       ::fty::SUB_NETAPP_NODE },
-    { asset_subtype::VMWARE_STANDALONE_ESXI,            ::fty::SUB_VMWARE_STANDALONE_ESXI },
-    { asset_subtype::VMWARE_TASK,                       ::fty::SUB_VMWARE_TASK },
-    { asset_subtype::VMWARE_VAPP,                       ::fty::SUB_VMWARE_VAPP },
-    { asset_subtype::CITRIX_XENSERVER,                  ::fty::SUB_CITRIX_XENSERVER },
-    { asset_subtype::CITRIX_VAPP,                       ::fty::SUB_CITRIX_VAPP },
-    { asset_subtype::CITRIX_TASK,                       ::fty::SUB_CITRIX_TASK },
-
-    { asset_subtype::MICROSOFT_VM,                 ::fty::SUB_MICROSOFT_VM },
-    { asset_subtype::MICROSOFT_TASK,               ::fty::SUB_MICROSOFT_TASK },
-    { asset_subtype::MICROSOFT_SERVER_CONNECTOR,   ::fty::SUB_MICROSOFT_SERVER_CONNECTOR },
-    { asset_subtype::MICROSOFT_SERVER,             ::fty::SUB_MICROSOFT_SERVER },
-    { asset_subtype::MICROSOFT_CLUSTER,            ::fty::SUB_MICROSOFT_CLUSTER },
-    { asset_subtype::HP_ONEVIEW_CONNECTOR,         ::fty::SUB_HP_ONEVIEW_CONNECTOR },
-    { asset_subtype::HP_ONEVIEW,                   ::fty::SUB_HP_ONEVIEW },
-    { asset_subtype::HP_IT_SERVER,                 ::fty::SUB_HP_IT_SERVER },
-    { asset_subtype::HP_IT_RACK,                   ::fty::SUB_HP_IT_RACK },
-    { asset_subtype::NETAPP_SERVER,                ::fty::SUB_NETAPP_SERVER },
-    { asset_subtype::NETAPP_ONTAP_CONNECTOR,       ::fty::SUB_NETAPP_ONTAP_CONNECTOR },
-
-    { asset_subtype::NETAPP_ONTAP_CLUSTER,     ::fty::SUB_NETAPP_ONTAP_CLUSTER },
-    { asset_subtype::NUTANIX_VM,               ::fty::SUB_NUTANIX_VM },
-    { asset_subtype::NUTANIX_PRISM_GATEWAY,    ::fty::SUB_NUTANIX_PRISM_GATEWAY },
-    { asset_subtype::NUTANIX_NODE,             ::fty::SUB_NUTANIX_NODE },
-    { asset_subtype::NUTANIX_CLUSTER,          ::fty::SUB_NUTANIX_CLUSTER },
-    { asset_subtype::NUTANIX_PRISM_CONNECTOR,  ::fty::SUB_NUTANIX_PRISM_CONNECTOR },
-
-    { asset_subtype::VMWARE_VCENTER_CONNECTOR,         ::fty::SUB_VMWARE_VCENTER_CONNECTOR },
-    { asset_subtype::VMWARE_STANDALONE_ESXI_CONNECTOR, ::fty::SUB_VMWARE_STANDALONE_ESXI_CONNECTOR },
-    { asset_subtype::NETAPP_ONTAP,                     ::fty::SUB_NETAPP_ONTAP },
-
-    { asset_subtype::VMWARE_SRM,        ::fty::SUB_VMWARE_SRM },
-    { asset_subtype::VMWARE_SRM_PLAN,   ::fty::SUB_VMWARE_SRM_PLAN },
-
-    { asset_subtype::PCU,   ::fty::SUB_PCU }, // Parallel Control Unit
-    { asset_subtype::DELL_VXRAIL_CONNECTOR,                 ::fty::SUB_DELL_VXRAIL_CONNECTOR },
-    { asset_subtype::DELL_VXRAIL_MANAGER,                   ::fty::SUB_DELL_VXRAIL_MANAGER },
-    { asset_subtype::DELL_VXRAIL_CLUSTER,                   ::fty::SUB_DELL_VXRAIL_CLUSTER },
-    { asset_subtype::MICROSOFT_HYPERV_SERVICE,              ::fty::SUB_MICROSOFT_HYPERV_SERVICE },
-    { asset_subtype::VMWARE_CLUSTER_FAULT_DOMAIN,           ::fty::SUB_VMWARE_CLUSTER_FAULT_DOMAIN },
-    { asset_subtype::MICROSOFT_SCVMM_CONNECTOR,             ::fty::SUB_MICROSOFT_SCVMM_CONNECTOR },
-    { asset_subtype::MICROSOFT_SCVMM,                       ::fty::SUB_MICROSOFT_SCVMM },
-    { asset_subtype::DELL_VXRAIL_EXSI,                      ::fty::SUB_DELL_VXRAIL_EXSI },
-    { asset_subtype::MICROSOFT_STANDALONE_HYPERV_SERVER,    ::fty::SUB_MICROSOFT_STANDALONE_HYPERV_SERVER },
-    { asset_subtype::ACTUATOR,                              ::fty::SUB_ACTUATOR }
-};
-
-// Except "" for N_A, the names on the left are the ones from database
-const static std::map<std::string, std::string> subtype_equivs {
-    { "rack controller", "rackcontroller" }, // Mind the space!
-    { "patch panel",     "patchpanel" },     // Mind the space!
-    { "",                "N_A" }             // Do not change, string for assets with undefined type
-};
-// clang-format on
+using detail::NameEntry;
+using detail::subtype_entries;
+using detail::type_entries;
+
+// Consistency of FTY_ASSET_TYPE_LIST/FTY_ASSET_SUBTYPE_LIST
+
+template <size_t Count>
+constexpr bool s_ids_are_unique(const NameEntry (&entries)[Count], size_t limit)
+{
+    for (size_t i = 0; i < Count; i++) {
+        if (entries[i].id >= limit)
+            return false;
+        for (size_t j = 0; j < i; j++)
+            if (entries[i].id == entries[j].id)
+                return false;
+    }
+    return true;
+}
+
+// but for the entry of id except
+template <size_t Count>
+constexpr bool s_names_are_lowercase(const NameEntry (&entries)[Count], size_t except)
+{
+    for (const auto& entry : entries) {
+        if (entry.name.empty())
+            return false;
+        if (entry.id == except)
+            continue;
+        for (char c : entry.name)
+            if (c >= 'A' && c <= 'Z')
+                return false;
+    }
+    return true;
+}
+
+static_assert(s_ids_are_unique(type_entries, asset_type::NB_ASSET_TYPES), "duplicate or out of range type id");
+static_assert(
+    s_ids_are_unique(subtype_entries, asset_subtype::NB_ASSET_SUBTYPES), "duplicate or out of range subtype id");
+static_assert(s_names_are_lowercase(type_entries, asset_type::NB_ASSET_TYPES), "type names must be lowercase");
+static_assert(s_names_are_lowercase(subtype_entries, asset_subtype::N_A), "subtype names but N_A must be lowercase");
+static_assert(type_entries[0].id == asset_type::TUNKNOWN && subtype_entries[0].id == asset_subtype::SUNKNOWN,
+    "unknown must be the first entry");
+
+static_assert(fty::EnumCodec<asset_type>::parse("Rack") == asset_type::RACK);
+static_assert(fty::EnumCodec<asset_subtype>::parse("Patch Panel") == asset_subtype::PATCHPANEL);
+static_assert(fty::EnumCodec<asset_subtype>::parse("n_a") == asset_subtype::SUNKNOWN);
 
 // see fty_common_base.cc for selftests
 
+// built-in names first, the registry only on a miss (ids above the lists or in their gaps)
+
 std::string typeid_to_type(uint16_t type_id)
 {
-    try {
-        return type_names.at(type_id);
-    } catch (...) {
-    }
-    return ::fty::TYPE_UNKNOWN; // type_names.at(asset_type::TUNKNOWN);
+    std::string_view name = typeid_to_type_view(type_id);
+    if (name != ::fty::TYPE_UNKNOWN)
+        return std::string(name);
+    return std::string(AssetRegistry::instance().typeName(type_id));
+}
+
+uint16_t type_to_typeid(std::string_view type)
+{
+    asset_type type_id;
+    if (fty::EnumCodec<asset_type>::parse(type, type_id))
+        return type_id;
+    return AssetRegistry::instance().typeId(type);
 }
 
-uint16_t type_to_typeid(const std::string& type_)
+uint16_t type_to_typeid(const char* type)
 {
-    std::string type(type_);
-    std::transform(type.begin(), type.end(), type.begin(), ::tolower);
+    return type_to_typeid(std::string_view(type));
+}
 
-    for (auto& it : type_names)
-        if (it.second == type)
-            return it.first;
-    return asset_type::TUNKNOWN;
+uint16_t type_to_typeid(const std::string& type)
+{
+    return type_to_typeid(std::string_view(type));
 }
 
 std::string subtypeid_to_subtype(uint16_t subtype_id)
 {
-    try {
-        std::string subtype = subtype_names.at(subtype_id);
-        return subtype;
-    } catch (...) {
-    }
-    return ::fty::SUB_UNKNOWN; // subtype_names.at(asset_subtype::SUNKNOWN);
+    std::string_view name = subtypeid_to_subtype_view(subtype_id);
+    if (name != ::fty::SUB_UNKNOWN)
+        return std::string(name);
+    return std::string(AssetRegistry::instance().subtypeName(subtype_id));
 }
 
-uint16_t subtype_to_subtypeid(const std::string& subtype_)
+uint16_t subtype_to_subtypeid(std::string_view subtype)
 {
-    std::string subtype(subtype_);
-    if (subtype != "N_A")
-        std::transform(subtype.begin(), subtype.end(), subtype.begin(), ::tolower);
-
-    auto ite = subtype_equivs.find(subtype);
-    if (ite != subtype_equivs.end())
-        subtype = ite->second;
-
-    for (auto& it : subtype_names)
-        if (it.second == subtype)
-            return it.first;
-    return asset_subtype::SUNKNOWN;
+    asset_subtype subtype_id;
+    if (fty::EnumCodec<asset_subtype>::parse(subtype, subtype_id))
+        return subtype_id;
+    return AssetRegistry::instance().subtypeId(subtype);
+}
+
+uint16_t subtype_to_subtypeid(const char* subtype)
+{
+    return subtype_to_subtypeid(std::string_view(subtype));
+}
+
+uint16_t subtype_to_subtypeid(const std::string& subtype)
+{
+    return subtype_to_subtypeid(std::string_view(subtype));
 }
 
 std::string operation2str(asset_operation operation)
 {
-    switch (operation) {
-        case asset_operation::INSERT:
-            return "create";
-        case asset_operation::DELETE:
-            return "delete";
-        case asset_operation::UPDATE:
-            return "update";
-        case asset_operation::GET:
-            return "get";
-        case asset_operation::RETIRE:
-            return "retire";
-        case asset_operation::INVENTORY:
-            return "inventory";
-    }
-    return "unknown";
+    return std::string(fty::EnumCodec<asset_operation>::format(operation));
 }
 
 asset_operation str2operation(const std::string& operation)
 {
-    std::string t(operation);
-    std::transform(t.begin(), t.end(), t.begin(), ::tolower);
-    if (t == "create") {
-        return asset_operation::INSERT;
-    } else if (t == "delete") {
-        return asset_operation::DELETE;
-    } else if (t == "retire") {
-        return asset_operation::RETIRE;
-    } else if (t == "inventory") {
-        return asset_operation::INVENTORY;
-    } else if (t == "update") {
-        return asset_operation::UPDATE;
-    } else if (t == "get") {
-        return asset_operation::GET;
-    }
-    return asset_operation::INVENTORY;
+    return fty::EnumCodec<asset_operation>::parse(operation);
 }
 
 bool is_epdu(int x)
@@ -274,16 +185,17 @@ bool is_ups(int x)
 
 bool is_container(const std::string& asset_type)
 {
-    if (asset_type == "datacenter" || asset_type == "room" || asset_type == "row" || asset_type == "rack") {
-        return true;
-    }
-
-    return false;
+    // names are compared case-sensitively here
+    const AssetRegistry& registry = AssetRegistry::instance();
+    uint16_t             type_id  = type_to_typeid(asset_type);
+    return (registry.typeProperties(type_id) & PROP_CONTAINER) && registry.typeName(type_id) == asset_type;
 }
 
 bool is_ok_element_type(uint16_t element_type_id)
 {
-    return typeid_to_type(element_type_id) != ::fty::TYPE_UNKNOWN;
+    if (typeid_to_type_view(element_type_id) != ::fty::TYPE_UNKNOWN)
+        return true;
+    return AssetRegistry::instance().typeName(element_type_id) != ::fty::TYPE_UNKNOWN;
 }
 
 bool is_ok_name(const char* name)
@@ -299,6 +211,26 @@ bool is_ok_name(const char* name)
     return true;
 }
 
+bool is_ok_name(const char* name, std::string* normalized)
+{
+    if (!is_ok_name(name))
+        return false;
+    if (!normalized)
+        return true;
+
+    normalized->clear();
+    std::string_view name_str(name);
+    if (UTF8::is_nfc_quick(name_str) == UTF8::NfcQuickCheck::Yes)
+        return true;
+
+    std::string nfc;
+    if (!UTF8::to_nfc(name_str, nfc) || !is_ok_name(nfc.c_str()))
+        return false;
+    if (nfc != name_str)
+        *normalized = std::move(nfc);
+    return true;
+}
+
 bool is_ok_keytag(const char* keytag)
 {
     size_t length = keytag ? strlen(keytag) : 0;
@@ -326,4 +258,166 @@ bool is_ok_link_type(uint8_t link_type_id)
         return false;
 }
 
+// Batch validation
+
+// length of the well-formed UTF-8 sequence at the start of str, 0 if there is none
+static size_t s_utf8_sequence(const unsigned char* str, size_t length)
+{
+    unsigned char lead = str[0];
+    unsigned char min  = 0x80; // range of the second byte
+    unsigned char max  = 0xBF;
+    size_t        size;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        size = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        size = 3;
+        if (lead == 0xE0)
+            min = 0xA0; // overlong
+        else if (lead == 0xED)
+            max = 0x9F; // surrogates
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        size = 4;
+        if (lead == 0xF0)
+            min = 0x90; // overlong
+        else if (lead == 0xF4)
+            max = 0x8F; // above U+10FFFF
+    } else {
+        return 0;
+    }
+    if (length < size || str[1] < min || str[1] > max)
+        return 0;
+    for (size_t i = 2; i < size; i++)
+        if ((str[i] & 0xC0) != 0x80)
+            return 0;
+    return size;
+}
+
+static constexpr uint8_t CELL_FORBIDDEN = 1; // contains one of _ % @
+static constexpr uint8_t CELL_BAD_UTF8  = 2;
+
+// validates the non-ASCII sequences of str
+static void s_validate_utf8(const unsigned char* str, size_t length, uint8_t& flags)
+{
+    size_t pos = 0;
+    while (pos < length) {
+        if (str[pos] < 0x80) {
+            pos++;
+            continue;
+        }
+        size_t size = s_utf8_sequence(str + pos, length - pos);
+        if (size == 0) {
+            flags |= CELL_BAD_UTF8;
+            return;
+        }
+        pos += size;
+    }
+}
+
+static uint8_t s_scan_cell(std::string_view cell)
+{
+    auto    str    = reinterpret_cast<const unsigned char*>(cell.data());
+    size_t  length = cell.size();
+    uint8_t flags  = 0;
+#if defined(__SSE2__)
+    // cells of 8 bytes or more are read as (overlapping) blocks of 16, forbidden characters and non-ASCII bytes of
+    // all the blocks are accumulated; the UTF-8 sequences are only validated when there are non-ASCII bytes
+    if (length >= 8) {
+        const __m128i underscore = _mm_set1_epi8('_');
+        const __m128i percent    = _mm_set1_epi8('%');
+        const __m128i at         = _mm_set1_epi8('@');
+        __m128i       forbidden  = _mm_setzero_si128();
+        __m128i       high       = _mm_setzero_si128();
+        auto          scan       = [&](__m128i block) {
+            forbidden = _mm_or_si128(forbidden, _mm_cmpeq_epi8(block, underscore));
+            forbidden = _mm_or_si128(forbidden, _mm_cmpeq_epi8(block, percent));
+            forbidden = _mm_or_si128(forbidden, _mm_cmpeq_epi8(block, at));
+            high      = _mm_or_si128(high, block);
+        };
+        if (length >= 16) {
+            size_t pos = 0;
+            for (; pos + 16 <= length; pos += 16)
+                scan(_mm_loadu_si128(reinterpret_cast<const __m128i*>(str + pos)));
+            if (pos < length)
+                scan(_mm_loadu_si128(reinterpret_cast<const __m128i*>(str + length - 16)));
+        } else {
+            scan(_mm_unpacklo_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(str)),
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(str + length - 8))));
+        }
+        if (_mm_movemask_epi8(forbidden) != 0)
+            flags |= CELL_FORBIDDEN;
+        if (_mm_movemask_epi8(high) != 0)
+            s_validate_utf8(str, length, flags);
+        return flags;
+    }
+#endif
+    bool non_ascii = false;
+    for (size_t pos = 0; pos < length; pos++) {
+        unsigned char c = str[pos];
+        if (c == '_' || c == '%' || c == '@')
+            flags |= CELL_FORBIDDEN;
+        non_ascii |= c >= 0x80;
+    }
+    if (non_ascii)
+        s_validate_utf8(str, length, flags);
+    return flags;
+}
+
+static void s_validate_rows(const AssetColumns& columns, size_t begin, size_t end, uint8_t* errors)
+{
+    for (size_t row = begin; row < end; row++) {
+        uint8_t error = ROW_OK;
+        if (columns.names) {
+            std::string_view name  = columns.names[row];
+            uint8_t          flags = s_scan_cell(name);
+            if (name.empty() || (flags & CELL_FORBIDDEN))
+                error |= ROW_BAD_NAME;
+            if (flags & CELL_BAD_UTF8)
+                error |= ROW_BAD_UTF8;
+        }
+        if (columns.keytags) {
+            std::string_view keytag = columns.keytags[row];
+            if (keytag.empty() || keytag.size() > MAX_KEYTAG_LENGTH)
+                error |= ROW_BAD_KEYTAG;
+            if (s_scan_cell(keytag) & CELL_BAD_UTF8)
+                error |= ROW_BAD_UTF8;
+        }
+        if (columns.values) {
+            std::string_view value = columns.values[row];
+            if (value.empty() || value.size() > MAX_VALUE_LENGTH)
+                error |= ROW_BAD_VALUE;
+            if (s_scan_cell(value) & CELL_BAD_UTF8)
+                error |= ROW_BAD_UTF8;
+        }
+        errors[row] = error;
+    }
+}
+
+std::vector<uint8_t> validate_columns(const AssetColumns& columns, unsigned threads)
+{
+    static constexpr size_t ROWS_PER_THREAD = 16384;
+
+    std::vector<uint8_t> errors(columns.rows, ROW_OK);
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t chunks = std::min<size_t>(threads, (columns.rows + ROWS_PER_THREAD - 1) / ROWS_PER_THREAD);
+    if (chunks <= 1) {
+        s_validate_rows(columns, 0, columns.rows, errors.data());
+        return errors;
+    }
+
+    // the calling thread takes the first chunk
+    size_t                   chunk_rows = (columns.rows + chunks - 1) / chunks;
+    std::vector<std::thread> workers;
+    workers.reserve(chunks - 1);
+    for (size_t chunk = 1; chunk < chunks; chunk++) {
+        size_t begin = chunk * chunk_rows;
+        size_t end   = std::min(columns.rows, begin + chunk_rows);
+        workers.emplace_back(s_validate_rows, std::cref(columns), begin, end, errors.data());
+    }
+    s_validate_rows(columns, 0, std::min(columns.rows, chunk_rows), errors.data());
+    for (auto& worker : workers)
+        worker.join();
+    return errors;
+}
+
 } // namespace persist
@@ -17,8 +17,20 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 */
 
 #include "fty_common_filesystem.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <fty_log.h>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <string.h>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
 
 
 namespace shared {
@@ -29,15 +41,6 @@ const char* path_separator()
     return sep;
 }
 
-mode_t file_mode(const char* path)
-{
-    struct stat st;
-
-    if (stat(path, &st) == -1)
-        return 0;
-    return st.st_mode;
-}
-
 bool is_file(const char* path)
 {
     return S_ISREG(file_mode(path));
@@ -51,96 +54,713 @@ bool is_dir(const char* path)
 std::vector<std::string> items_in_directory(const char* path)
 {
     std::vector<std::string> result;
-
-    DIR* dir = opendir(path);
-    if (dir) {
-        struct dirent* entry;
-        while ((entry = readdir(dir)) != nullptr) {
-            result.push_back(entry->d_name);
-        }
-        closedir(dir);
-    }
+    for (const auto& entry : DirRange(path, false).dots(true))
+        result.emplace_back(entry.name);
     return result;
 }
 
 bool is_item_in_directory(const std::string& path, std::vector<std::string>& items)
 {
+    DirRange range(path.c_str(), false);
+    if (!range)
+        return false;
+    for (const auto& entry : range)
+        items.emplace_back(entry.name);
+    return true;
+}
 
-    DIR* dir = opendir(path.c_str());
-    if (!dir) {
+std::vector<std::string> files_in_directory(const char* path)
+{
+    std::vector<std::string> result;
+    is_file_in_directory(path, result);
+    return result;
+}
+
+bool is_file_in_directory(const std::string& path, std::vector<std::string>& files)
+{
+    DirRange range(path.c_str());
+    if (!range)
         return false;
+    for (const auto& entry : range.ofType(FileType::Regular))
+        files.emplace_back(entry.name);
+    return true;
+}
+
+bool list_directory(const char* path, std::vector<DirEntry>& entries, bool follow_symlinks)
+{
+    DirRange range(path, follow_symlinks);
+    if (!range)
+        return false;
+    for (const auto& entry : range)
+        entries.push_back({std::string(entry.name), entry.type});
+    return true;
+}
+
+static FileType s_file_type(mode_t mode)
+{
+    if (S_ISREG(mode))
+        return FileType::Regular;
+    if (S_ISDIR(mode))
+        return FileType::Directory;
+    if (S_ISLNK(mode))
+        return FileType::Symlink;
+    return FileType::Other;
+}
+
+static FileType s_file_type(const struct dirent* entry)
+{
+    switch (entry->d_type) {
+        case DT_REG:
+            return FileType::Regular;
+        case DT_DIR:
+            return FileType::Directory;
+        case DT_LNK:
+            return FileType::Symlink;
+        case DT_UNKNOWN:
+            return FileType::Unknown;
+        default:
+            return FileType::Other;
     }
+}
+
+DirRange::DirRange(const char* path, bool follow_symlinks)
+    : m_dir(opendir(path))
+    , m_follow_symlinks(follow_symlinks)
+{
+}
+
+DirRange::~DirRange()
+{
+    if (m_dir)
+        closedir(m_dir);
+}
+
+DirRange::DirRange(DirRange&& other) noexcept
+    : m_dir(other.m_dir)
+    , m_follow_symlinks(other.m_follow_symlinks)
+    , m_dots(other.m_dots)
+    , m_types(other.m_types)
+    , m_suffixes(std::move(other.m_suffixes))
+    , m_patterns(std::move(other.m_patterns))
+    , m_current(other.m_current)
+{
+    other.m_dir = nullptr;
+}
+
+DirRange& DirRange::ofType(FileType type) &
+{
+    m_types |= uint8_t(1 << static_cast<uint8_t>(type));
+    return *this;
+}
+
+DirRange& DirRange::suffix(std::string suffix) &
+{
+    m_suffixes.push_back(std::move(suffix));
+    return *this;
+}
+
+DirRange& DirRange::glob(std::string pattern) &
+{
+    m_patterns.push_back(std::move(pattern));
+    return *this;
+}
+
+DirRange& DirRange::dots(bool dots) &
+{
+    m_dots = dots;
+    return *this;
+}
+
+// name is the NUL-terminated d_name
+bool DirRange::matches(std::string_view name) const
+{
+    auto ends_with = [&](const std::string& suffix) {
+        return name.size() >= suffix.size() && name.substr(name.size() - suffix.size()) == suffix;
+    };
+    auto matches_glob = [&](const std::string& pattern) {
+        return fnmatch(pattern.c_str(), name.data(), FNM_PERIOD) == 0;
+    };
+    if (!m_suffixes.empty() && std::none_of(m_suffixes.begin(), m_suffixes.end(), ends_with))
+        return false;
+    if (!m_patterns.empty() && std::none_of(m_patterns.begin(), m_patterns.end(), matches_glob))
+        return false;
+    return true;
+}
+
+bool DirRange::next()
+{
+    if (!m_dir)
+        return false;
 
     struct dirent* entry;
-    while ((entry = readdir(dir)) != nullptr) {
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+    while ((entry = readdir(m_dir)) != nullptr) {
+        std::string_view name(entry->d_name);
+        if (!m_dots && (name == "." || name == ".."))
             continue;
+        if (!matches(name))
+            continue;
+
+        FileType type = s_file_type(entry);
+        if (type == FileType::Unknown || (type == FileType::Symlink && m_follow_symlinks)) {
+            struct stat st;
+            if (fstatat(dirfd(m_dir), entry->d_name, &st, m_follow_symlinks ? 0 : AT_SYMLINK_NOFOLLOW) == 0)
+                type = s_file_type(st.st_mode);
+            else
+                type = FileType::Unknown;
         }
-        items.push_back(entry->d_name);
+        if (m_types && !(m_types & (1 << static_cast<uint8_t>(type))))
+            continue;
+
+        m_current = {name, type, entry->d_ino};
+        return true;
     }
-    closedir(dir);
-    return true;
+    return false;
 }
 
-std::vector<std::string> files_in_directory(const char* path)
+std::string WalkEntry::path() const
 {
-    std::vector<std::string> result;
-    std::string              spath = path;
-    spath += path_separator();
+    std::string result;
+    result.reserve(directory.size() + 1 + name.size());
+    shared::path::join(result, directory, name);
+    return result;
+}
+
+namespace {
+
+    // open directory, kept while its subdirectories wait to be opened relative to it
+    struct WalkDirectory
+    {
+        DIR*        dir;
+        std::string path;
+        unsigned    depth;
+
+        ~WalkDirectory()
+        {
+            closedir(dir);
+        }
+    };
+
+    struct WalkTask
+    {
+        std::shared_ptr<WalkDirectory> parent; // null for the root
+        std::string                    name;
+    };
+
+    // tasks of a thread: it takes the newest (depth-first, the entries are still cached), thieves the oldest
+    struct WalkQueue
+    {
+        std::mutex           mutex;
+        std::deque<WalkTask> tasks;
+    };
+
+    class Walker
+    {
+    public:
+        Walker(int root, const std::function<WalkAction(const WalkEntry&)>& visitor, const WalkOptions& options,
+            unsigned threads)
+            : m_root(root)
+            , m_visitor(visitor)
+            , m_options(options)
+            , m_queues(threads)
+        {
+        }
+
+        bool run()
+        {
+            push(0, {nullptr, {}});
+            std::vector<std::thread> threads;
+            for (size_t i = 1; i < m_queues.size(); i++)
+                threads.emplace_back(&Walker::work, this, i);
+            work(0);
+            for (auto& thread : threads)
+                thread.join();
+            return !m_stopped;
+        }
+
+    private:
+        void work(size_t index)
+        {
+            while (true) {
+                WalkTask task;
+                if (pop(index, task)) {
+                    scan(index, std::move(task));
+                    if (--m_pending == 0) {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        m_idle.notify_all();
+                    }
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_idle.wait(lock, [&] {
+                    return m_queued > 0 || m_pending == 0;
+                });
+                if (m_pending == 0)
+                    return;
+            }
+        }
+
+        void push(size_t index, WalkTask&& task)
+        {
+            m_pending++;
+            {
+                std::lock_guard<std::mutex> lock(m_queues[index].mutex);
+                m_queues[index].tasks.push_back(std::move(task));
+            }
+            m_queued++;
+            if (m_queues.size() > 1) {
+                // idle threads check m_queued under m_mutex
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                }
+                m_idle.notify_one();
+            }
+        }
+
+        bool pop(size_t index, WalkTask& task)
+        {
+            if (m_queued == 0)
+                return false;
+            for (size_t i = 0; i < m_queues.size(); i++) {
+                WalkQueue&                  queue = m_queues[(index + i) % m_queues.size()];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.tasks.empty())
+                    continue;
+                if (i == 0) {
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                } else {
+                    task = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                }
+                m_queued--;
+                return true;
+            }
+            return false;
+        }
 
-    for (auto it : items_in_directory(path)) {
-        if (is_file((spath + it).c_str()))
-            result.push_back(it);
+        // false if the directory was already visited through a symbolic link
+        bool firstVisit(int fd)
+        {
+            struct stat st;
+            if (fstat(fd, &st) != 0)
+                return false;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_visited.emplace(st.st_dev, st.st_ino).second;
+        }
+
+        void scan(size_t index, WalkTask&& task)
+        {
+            if (m_stopped)
+                return;
+
+            bool follow = m_options.symlinks == SymlinkPolicy::Follow;
+            int  fd     = m_root;
+            if (task.parent) {
+                fd = openat(dirfd(task.parent->dir), task.name.c_str(),
+                    O_RDONLY | O_DIRECTORY | O_CLOEXEC | (follow ? 0 : O_NOFOLLOW));
+                if (fd == -1) {
+                    log_debug("walk: can't open %s/%s: %s", task.parent->path.c_str(), task.name.c_str(),
+                        strerror(errno));
+                    return;
+                }
+            }
+            if (follow && !firstVisit(fd)) {
+                close(fd);
+                return;
+            }
+            DIR* dir = fdopendir(fd);
+            if (!dir) {
+                close(fd);
+                return;
+            }
+
+            auto directory = std::make_shared<WalkDirectory>();
+            directory->dir = dir;
+            if (task.parent) {
+                directory->depth = task.parent->depth + 1;
+                path::join(directory->path, task.parent->path, task.name);
+            } else {
+                directory->depth = 0;
+            }
+            task.parent.reset();
+
+            struct dirent* entry;
+            while ((entry = readdir(dir)) != nullptr) {
+                // stopped by the visitor in another thread, or cancelled
+                if (m_stopped || (m_options.cancel && *m_options.cancel)) {
+                    m_stopped = true;
+                    return;
+                }
+                const char* name = entry->d_name;
+                if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+                    continue;
+
+                FileType    type = s_file_type(entry);
+                struct stat st;
+                if (type == FileType::Unknown)
+                    type = fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 ? s_file_type(st.st_mode) : type;
+                if (type == FileType::Symlink) {
+                    if (m_options.symlinks == SymlinkPolicy::Ignore)
+                        continue;
+                    if (follow)
+                        type = fstatat(fd, name, &st, 0) == 0 ? s_file_type(st.st_mode) : FileType::Unknown;
+                }
+
+                WalkEntry  walk_entry = {name, directory->path, type, entry->d_ino, directory->depth, fd};
+                WalkAction action     = m_visitor(walk_entry);
+                if (action == WalkAction::Stop) {
+                    m_stopped = true;
+                    return;
+                }
+                if (type == FileType::Directory && action == WalkAction::Continue &&
+                    directory->depth < m_options.maxDepth)
+                    push(index, {directory, name});
+            }
+        }
+
+        int                                                m_root;
+        const std::function<WalkAction(const WalkEntry&)>& m_visitor;
+        const WalkOptions&                                 m_options;
+        std::vector<WalkQueue>                             m_queues;
+        std::atomic<size_t>                                m_pending {0}; // tasks queued or running
+        std::atomic<size_t>                                m_queued {0};
+        std::atomic<bool>                                  m_stopped {false};
+        std::mutex                                         m_mutex; // for m_idle and m_visited
+        std::condition_variable                            m_idle;
+        std::set<std::pair<dev_t, ino_t>>                  m_visited;
+    };
+
+} // namespace
+
+bool walk(const char* path, const std::function<WalkAction(const WalkEntry&)>& visitor, const WalkOptions& options)
+{
+    int root = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (root == -1)
+        return false;
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    return Walker(root, visitor, options, threads).run();
+}
+
+// whether the entry path (relative to fd) which made mkdirat() fail with EEXIST is a directory, errno if not
+static bool s_existing_dir(int fd, const char* path)
+{
+    struct stat st;
+    if (fstatat(fd, path, &st, 0) == -1)
+        return false;
+    if (!S_ISDIR(st.st_mode)) {
+        errno = ENOTDIR;
+        return false;
     }
-    return result;
+    return true;
 }
 
-bool is_file_in_directory(const std::string& path, std::vector<std::string>& files)
+// creates path relative to fd and its missing parents; created gets prefix + each path created, outermost first
+static bool s_make_directories(
+    int fd, const std::string& path, mode_t mode, const std::string& prefix, std::vector<std::string>& created)
 {
-    std::string spath = path;
-    spath += path_separator();
+    auto report = [&](size_t end) {
+        while (end > 1 && path[end - 1] == '/')
+            end--;
+        created.push_back(prefix + path.substr(0, end));
+        invalidate_stat_cache(created.back().c_str());
+    };
 
-    std::vector<std::string> items;
-    if (is_item_in_directory(spath, items) == false) {
+    // the common cases: the parent exists, or everything does
+    if (mkdirat(fd, path.c_str(), mode) == 0) {
+        report(path.size());
+        return true;
+    }
+    if (errno == EEXIST)
+        return s_existing_dir(fd, path.c_str());
+    if (errno != ENOENT)
         return false;
+
+    // ends of the components, then the deepest existing ancestor, from the end
+    std::vector<size_t> ends;
+    for (size_t i = 0; i < path.size(); i++) {
+        if (path[i] != '/' && (i + 1 == path.size() || path[i + 1] == '/'))
+            ends.push_back(i + 1);
+    }
+    size_t existing = ends.size() - 1;
+    int    dir      = -1;
+    for (; existing > 0 && dir == -1; existing--) {
+        dir = openat(fd, path.substr(0, ends[existing - 1]).c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+        if (dir == -1 && errno != ENOENT)
+            return false;
     }
+    if (dir != -1)
+        existing++;
 
-    for (const auto& item : items) {
-        std::string temp = spath + item;
-        if (is_file(temp.c_str()))
-            files.push_back(item);
+    // then down from it: the first component is relative to fd, the next ones to their parent
+    for (size_t i = existing; i < ends.size(); i++) {
+        size_t      begin = i == 0 ? 0 : path.find_first_not_of('/', ends[i - 1]);
+        std::string name  = dir == -1 ? path.substr(0, ends[i]) : path.substr(begin, ends[i] - begin);
+        int         at    = dir == -1 ? fd : dir;
+        if (mkdirat(at, name.c_str(), mode) == 0) {
+            report(ends[i]);
+        } else if (errno != EEXIST || !s_existing_dir(at, name.c_str())) {
+            // another process may have created it meanwhile, anything else is an error
+            int error = errno;
+            if (dir != -1)
+                close(dir);
+            errno = error;
+            return false;
+        }
+        if (i + 1 == ends.size())
+            break;
+        int next  = openat(at, name.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+        int error = errno;
+        if (dir != -1)
+            close(dir);
+        if (next == -1) {
+            errno = error;
+            return false;
+        }
+        dir = next;
     }
+    if (dir != -1)
+        close(dir);
     return true;
 }
 
+bool make_directories(const char* path, std::vector<std::string>& created, mode_t mode)
+{
+    if (!path || !*path) {
+        errno = ENOENT;
+        return false;
+    }
+    return s_make_directories(AT_FDCWD, path, mode, "", created);
+}
+
+bool make_subdirectories(
+    const char* parent, const std::vector<std::string>& names, std::vector<std::string>& created, mode_t mode)
+{
+    if (!make_directories(parent, created, mode))
+        return false;
+    int fd = open(parent, O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1)
+        return false;
+
+    std::string prefix = parent;
+    if (prefix.back() != '/')
+        prefix += '/';
+    bool ok    = true;
+    int  error = 0;
+    for (const auto& name : names) {
+        if (name.empty() || !s_make_directories(fd, name, mode, prefix, created)) {
+            ok    = false;
+            error = name.empty() ? ENOENT : errno;
+        }
+    }
+    close(fd);
+    errno = error;
+    return ok;
+}
+
 bool mkdir_if_needed(const char* path, mode_t mode, bool create_parent)
 {
     if (!path || strlen(path) == 0)
         return false;
-    if (is_dir(path))
-        return true;
 
     if (create_parent) {
-        std::string parent = path;
-        size_t      i      = parent.find_last_of(path_separator());
-        if (i != std::string::npos) {
-            parent = parent.substr(0, i);
-            mkdir_if_needed(parent.c_str(), mode, create_parent);
+        std::vector<std::string> created;
+        return make_directories(path, created, mode);
+    }
+    if (mkdir(path, mode) == 0) {
+        invalidate_stat_cache(path);
+        return true;
+    }
+    return errno == EEXIST && s_existing_dir(AT_FDCWD, path);
+}
+
+bool read_file(const char* path, std::string& content)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return false;
+    }
+
+    // the size is a hint: the file may change meanwhile, and is 0 for procfs and sysfs;
+    // one more byte is asked, so that a short read tells the end of an unchanged regular file
+    bool   regular = S_ISREG(st.st_mode) && st.st_size > 0;
+    size_t size    = regular ? size_t(st.st_size) : 0;
+    size_t length  = 0;
+    content.resize(size + 1);
+    while (true) {
+        if (length == content.size())
+            content.resize(std::max<size_t>(4096, content.size() * 2));
+        size_t  wanted = content.size() - length;
+        ssize_t count  = read(fd, &content[length], wanted);
+        if (count == -1) {
+            if (errno == EINTR)
+                continue;
+            int error = errno;
+            close(fd);
+            content.clear();
+            errno = error;
+            return false;
         }
+        length += size_t(count);
+        if (count == 0 || (regular && size_t(count) < wanted && length >= size))
+            break;
     }
-    mkdir(path, mode);
-    return false;
+    close(fd);
+    content.resize(length);
+    return true;
+}
+
+MappedFile::MappedFile(const char* path, Advice advice)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return;
+    struct stat st;
+    int         error = 0;
+    if (fstat(fd, &st) == -1) {
+        error = errno;
+    } else if (!S_ISREG(st.st_mode)) {
+        error = S_ISDIR(st.st_mode) ? EISDIR : EINVAL;
+    } else if (st.st_size > 0) {
+        void* data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            error = errno;
+        } else {
+            m_data = data;
+            m_size = size_t(st.st_size);
+        }
+    }
+    close(fd);
+    if (error) {
+        errno = error;
+        return;
+    }
+    m_valid = true;
+
+    static const int advices[] = {MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED};
+    if (m_data && advice != Advice::Normal)
+        madvise(m_data, m_size, advices[int(advice)]);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data)
+        munmap(m_data, m_size);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : m_data(other.m_data)
+    , m_size(other.m_size)
+    , m_valid(other.m_valid)
+{
+    other.m_data  = nullptr;
+    other.m_size  = 0;
+    other.m_valid = false;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other) {
+        if (m_data)
+            munmap(m_data, m_size);
+        m_data        = other.m_data;
+        m_size        = other.m_size;
+        m_valid       = other.m_valid;
+        other.m_data  = nullptr;
+        other.m_size  = 0;
+        other.m_valid = false;
+    }
+    return *this;
 }
 
 // basename from libgen.h does not play nice with const char*
 std::string basename(const std::string& path)
 {
-    auto pos = path.rfind(path_separator());
-    if (pos == std::string::npos)
-        return std::string{path};
-
-    return path.substr(pos + 1);
+    return std::string(path::basename(path));
 }
 
+namespace path {
+
+    static constexpr char SEPARATOR = '/';
+
+    std::string_view basename(std::string_view path)
+    {
+        size_t pos = path.rfind(SEPARATOR);
+        return pos == std::string_view::npos ? path : path.substr(pos + 1);
+    }
+
+    std::string_view dirname(std::string_view path)
+    {
+        size_t pos = path.rfind(SEPARATOR);
+        if (pos == std::string_view::npos)
+            return {};
+        size_t end = path.find_last_not_of(SEPARATOR, pos);
+        // only separators before the last one: the root
+        return end == std::string_view::npos ? path.substr(0, 1) : path.substr(0, end + 1);
+    }
+
+    std::string_view extension(std::string_view path)
+    {
+        std::string_view name = basename(path);
+        size_t           pos  = name.rfind('.');
+        if (pos == std::string_view::npos || pos == 0 || name == "..")
+            return {};
+        return name.substr(pos);
+    }
+
+    std::string_view join(std::string& buffer, std::string_view directory, std::string_view name)
+    {
+        buffer.assign(directory);
+        if (!buffer.empty() && buffer.back() != SEPARATOR)
+            buffer += SEPARATOR;
+        buffer.append(name);
+        return buffer;
+    }
+
+    std::string_view normalize(std::string& buffer, std::string_view path)
+    {
+        buffer.clear();
+        bool absolute = !path.empty() && path[0] == SEPARATOR;
+        if (absolute)
+            buffer += SEPARATOR;
+        // the components start after the root
+        size_t root = buffer.size();
+
+        for (size_t pos = 0; pos < path.size();) {
+            size_t end = path.find(SEPARATOR, pos);
+            if (end == std::string_view::npos)
+                end = path.size();
+            std::string_view component = path.substr(pos, end - pos);
+            pos                        = end + 1;
+            if (component.empty() || component == ".")
+                continue;
+            if (component == "..") {
+                std::string_view done(buffer.data() + root, buffer.size() - root);
+                size_t           last = done.rfind(SEPARATOR);
+                // a component to go back from, not a leading ".."
+                if (!done.empty() && basename(done) != "..") {
+                    buffer.resize(last == std::string_view::npos ? root : root + last);
+                    continue;
+                }
+                // nothing above the root
+                if (absolute)
+                    continue;
+            }
+            if (buffer.size() > root)
+                buffer += SEPARATOR;
+            buffer.append(component);
+        }
+        if (buffer.empty())
+            buffer = ".";
+        return buffer;
+    }
+
+} // namespace path
+
 
 } // namespace shared
@@ -0,0 +1,369 @@
+/*
+Copyright (C) 2014 - 2020 Eaton
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "fty_common_filesystem.h"
+#include <algorithm>
+#include <fty_log.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace shared {
+
+static constexpr uint32_t WATCHED_EVENTS = IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                           IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+static std::atomic<StatCache*> s_stat_cache {nullptr};
+
+// prefix of the paths in the parent directory of path: "a/" for "a/b", "" for "b"
+static std::string s_prefix(const std::string& path)
+{
+    return path.substr(0, path.rfind(path_separator()[0]) + 1);
+}
+
+static mode_t s_stat(const char* path)
+{
+    struct stat st;
+
+    if (stat(path, &st) == -1)
+        return 0;
+    return st.st_mode;
+}
+
+mode_t file_mode(const char* path)
+{
+    StatCache* cache = s_stat_cache.load(std::memory_order_acquire);
+    return cache ? cache->mode(path) : s_stat(path);
+}
+
+void set_stat_cache(StatCache* cache)
+{
+    s_stat_cache.store(cache, std::memory_order_release);
+}
+
+void invalidate_stat_cache(const char* path)
+{
+    StatCache* cache = s_stat_cache.load(std::memory_order_acquire);
+    if (cache)
+        cache->invalidate(path);
+}
+
+StatCache::StatCache(std::chrono::milliseconds ttl, bool use_inotify, size_t max_entries)
+    : m_ttl(ttl)
+    , m_shardCapacity(std::max<size_t>(1, max_entries / SHARDS))
+{
+    if (!use_inotify)
+        return;
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    m_wakeup  = eventfd(0, EFD_CLOEXEC);
+    if (m_inotify == -1 || m_wakeup == -1) {
+        log_debug("StatCache: no inotify, entries only expire: %s", strerror(errno));
+        if (m_inotify != -1)
+            close(m_inotify);
+        if (m_wakeup != -1)
+            close(m_wakeup);
+        m_inotify = -1;
+        m_wakeup  = -1;
+        return;
+    }
+    m_thread = std::thread(&StatCache::run, this);
+}
+
+StatCache::~StatCache()
+{
+    StatCache* self = this;
+    s_stat_cache.compare_exchange_strong(self, nullptr);
+
+    if (m_thread.joinable()) {
+        uint64_t one = 1;
+        if (write(m_wakeup, &one, sizeof(one)) != sizeof(one))
+            log_error("StatCache: can't wake up the inotify thread");
+        m_thread.join();
+    }
+    if (m_inotify != -1)
+        close(m_inotify);
+    if (m_wakeup != -1)
+        close(m_wakeup);
+}
+
+StatCache::Shard& StatCache::shard(const std::string& path)
+{
+    return m_shards[std::hash<std::string>()(path) % SHARDS];
+}
+
+mode_t StatCache::mode(const char* path)
+{
+    std::string key(path);
+    Shard&      s   = shard(key);
+    auto        now = std::chrono::steady_clock::now();
+    uint64_t    generation;
+    {
+        std::shared_lock<std::shared_mutex> lock(s.mutex);
+        auto                                it = s.entries.find(key);
+        if (it != s.entries.end() && now < it->second.expiry) {
+            s.hits.fetch_add(1, std::memory_order_relaxed);
+            return it->second.mode;
+        }
+        generation = s.generation;
+    }
+    s.misses.fetch_add(1, std::memory_order_relaxed);
+
+    // watch before stat(), so that a change after it is reported
+    uint64_t watch_id  = 0;
+    bool     cacheable = m_inotify == -1 || watch(key, watch_id);
+    mode_t   mode      = s_stat(path);
+    Released released;
+    {
+        std::unique_lock<std::shared_mutex> lock(s.mutex);
+        // not if it was invalidated meanwhile, the mode may be the old one
+        if (!cacheable || s.generation != generation) {
+            released.emplace_back(std::move(key), watch_id);
+        } else if (auto it = s.entries.find(key); it != s.entries.end()) {
+            released.emplace_back(std::move(key), it->second.watch);
+            it->second = {mode, now + m_ttl, watch_id};
+        } else {
+            if (s.entries.size() >= m_shardCapacity)
+                evict(s, now, released);
+            s.entries.emplace(std::move(key), Entry {mode, now + m_ttl, watch_id});
+        }
+    }
+    unwatch(released);
+    return mode;
+}
+
+// make room in a full shard: drop the expired entries, else the oldest quarter (the ttl is the same for all)
+void StatCache::evict(Shard& s, std::chrono::steady_clock::time_point now, Released& released)
+{
+    auto limit = now;
+    if (std::none_of(s.entries.begin(), s.entries.end(), [&](const auto& entry) {
+            return entry.second.expiry <= now;
+        })) {
+        std::vector<std::chrono::steady_clock::time_point> expiries;
+        expiries.reserve(s.entries.size());
+        for (const auto& entry : s.entries)
+            expiries.push_back(entry.second.expiry);
+        auto nth = expiries.begin() + ptrdiff_t(expiries.size() / 4);
+        std::nth_element(expiries.begin(), nth, expiries.end());
+        limit = *nth;
+    }
+    for (auto it = s.entries.begin(); it != s.entries.end();) {
+        if (it->second.expiry <= limit) {
+            released.emplace_back(it->first, it->second.watch);
+            it = s.entries.erase(it);
+            m_evictions.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void StatCache::invalidate(const std::string& path)
+{
+    drop(path);
+}
+
+void StatCache::clear()
+{
+    for (auto& s : m_shards) {
+        Released released;
+        {
+            std::unique_lock<std::shared_mutex> lock(s.mutex);
+            for (const auto& entry : s.entries)
+                released.emplace_back(entry.first, entry.second.watch);
+            s.entries.clear();
+            s.generation++;
+        }
+        unwatch(released);
+    }
+}
+
+StatCache::Stats StatCache::stats() const
+{
+    Stats stats {0, 0, m_invalidations.load(std::memory_order_relaxed), m_evictions.load(std::memory_order_relaxed),
+        0};
+    for (const auto& s : m_shards) {
+        stats.hits += s.hits.load(std::memory_order_relaxed);
+        stats.misses += s.misses.load(std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> lock(m_watchMutex);
+    stats.watches = m_watches.size();
+    return stats;
+}
+
+size_t StatCache::size() const
+{
+    size_t size = 0;
+    for (const auto& s : m_shards) {
+        std::shared_lock<std::shared_mutex> lock(s.mutex);
+        size += s.entries.size();
+    }
+    return size;
+}
+
+bool StatCache::drop(const std::string& path)
+{
+    Shard&   s = shard(path);
+    uint64_t watch_id;
+    {
+        std::unique_lock<std::shared_mutex> lock(s.mutex);
+        s.generation++;
+        auto it = s.entries.find(path);
+        if (it == s.entries.end())
+            return false;
+        watch_id = it->second.watch;
+        s.entries.erase(it);
+    }
+    unwatch(path, watch_id);
+    return true;
+}
+
+void StatCache::dropPrefix(const std::string& prefix)
+{
+    for (auto& s : m_shards) {
+        Released released;
+        {
+            std::unique_lock<std::shared_mutex> lock(s.mutex);
+            s.generation++;
+            for (auto it = s.entries.begin(); it != s.entries.end();) {
+                if (it->first.compare(0, prefix.size(), prefix) == 0) {
+                    released.emplace_back(it->first, it->second.watch);
+                    it = s.entries.erase(it);
+                    m_invalidations.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        unwatch(released);
+    }
+}
+
+// watch the parent directory of path, under the prefix of the paths in it, and count path as one of its users until
+// unwatch(path, id); false if the directory doesn't exist: nothing would report its creation
+bool StatCache::watch(const std::string& path, uint64_t& id)
+{
+    std::string prefix = s_prefix(path);
+
+    std::lock_guard<std::mutex> lock(m_watchMutex);
+    if (auto it = m_watchedDirs.find(prefix); it != m_watchedDirs.end()) {
+        it->second.users++;
+        id = it->second.id;
+        return true;
+    }
+    int wd = inotify_add_watch(m_inotify, prefix.empty() ? "." : prefix.c_str(), WATCHED_EVENTS);
+    if (wd == -1) {
+        if (errno == ENOENT || errno == ENOTDIR)
+            return false;
+        // watch limit reached, the ttl still applies
+        log_debug("StatCache: can't watch '%s': %s", prefix.c_str(), strerror(errno));
+        return true;
+    }
+    id = ++m_lastWatch;
+    m_watchedDirs.emplace(prefix, Watch {wd, id, 1});
+    m_watches[wd].push_back(std::move(prefix));
+    return true;
+}
+
+// release a user of the watch id of the parent directory of path, and remove the watch once it has none; a watch
+// which was replaced since (the directory was deleted) is left alone
+void StatCache::unwatch(const std::string& path, uint64_t id)
+{
+    if (id == 0)
+        return;
+    std::string prefix = s_prefix(path);
+
+    std::lock_guard<std::mutex> lock(m_watchMutex);
+    auto                        it = m_watchedDirs.find(prefix);
+    if (it == m_watchedDirs.end() || it->second.id != id || --it->second.users != 0)
+        return;
+    int   wd       = it->second.wd;
+    auto& prefixes = m_watches[wd];
+    m_watchedDirs.erase(it);
+    prefixes.erase(std::find(prefixes.begin(), prefixes.end(), prefix));
+    // "a/" and "./a/" share the watch of a
+    if (prefixes.empty()) {
+        m_watches.erase(wd);
+        inotify_rm_watch(m_inotify, wd);
+    }
+}
+
+void StatCache::unwatch(const Released& released)
+{
+    for (const auto& [path, id] : released)
+        unwatch(path, id);
+}
+
+void StatCache::run()
+{
+    while (true) {
+        struct pollfd fds[2] = {{m_inotify, POLLIN, 0}, {m_wakeup, POLLIN, 0}};
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR)
+                continue;
+            log_error("StatCache: poll failed, entries only expire: %s", strerror(errno));
+            return;
+        }
+        if (fds[1].revents)
+            return;
+
+        alignas(struct inotify_event) char buffer[16384];
+        ssize_t                            length = read(m_inotify, buffer, sizeof(buffer));
+        for (ssize_t offset = 0; offset < length;) {
+            const auto* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+            offset += ssize_t(sizeof(struct inotify_event) + event->len);
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                dropPrefix("");
+                continue;
+            }
+            std::vector<std::string> prefixes;
+            {
+                std::lock_guard<std::mutex> lock(m_watchMutex);
+                auto                        it = m_watches.find(event->wd);
+                if (it == m_watches.end())
+                    continue;
+                prefixes = it->second;
+                // the directory is gone, its entries will be watched again from their next lookup
+                if (event->mask & IN_IGNORED) {
+                    for (const auto& prefix : prefixes)
+                        m_watchedDirs.erase(prefix);
+                    m_watches.erase(it);
+                }
+            }
+            if (event->mask & IN_MOVE_SELF) {
+                // the watch follows the directory, not its path; IN_IGNORED comes next
+                inotify_rm_watch(m_inotify, event->wd);
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                for (const auto& prefix : prefixes)
+                    dropPrefix(prefix);
+                continue;
+            }
+            if (event->len == 0)
+                continue;
+            for (const auto& prefix : prefixes)
+                if (drop(prefix + event->name))
+                    m_invalidations.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace shared
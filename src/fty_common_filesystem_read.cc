@@ -0,0 +1,422 @@
+/*
+Copyright (C) 2014 - 2020 Eaton
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "fty_common_filesystem.h"
+#include <algorithm>
+#include <deque>
+#include <fcntl.h>
+#include <fty_log.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+
+// IORING_OP_OPENAT, IORING_OP_READ and IORING_OP_CLOSE are enumerators; IORING_FEAT_RW_CUR_POS comes with them in the
+// headers of Linux 5.6, older ones build the thread pool only
+#if defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup)
+#define FTY_HAVE_IO_URING 1
+#endif
+
+namespace shared {
+
+#ifdef FTY_HAVE_IO_URING
+
+namespace {
+
+    // io_uring through its syscalls, the few calls read_files() needs (liburing is not a dependency)
+    class Ring
+    {
+    public:
+        explicit Ring(unsigned entries)
+        {
+            struct io_uring_params params;
+            memset(&params, 0, sizeof(params));
+            m_fd = int(syscall(__NR_io_uring_setup, entries, &params));
+            if (m_fd == -1)
+                return;
+
+            m_sqSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+            m_cqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+            if (params.features & IORING_FEAT_SINGLE_MMAP)
+                m_sqSize = m_cqSize = std::max(m_sqSize, m_cqSize);
+            m_sq = mmap(nullptr, m_sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+            if (m_sq == MAP_FAILED) {
+                m_sq = nullptr;
+                return;
+            }
+            if (params.features & IORING_FEAT_SINGLE_MMAP) {
+                m_cq = m_sq;
+            } else {
+                m_cq = mmap(nullptr, m_cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+                    IORING_OFF_CQ_RING);
+                if (m_cq == MAP_FAILED) {
+                    m_cq = nullptr;
+                    return;
+                }
+            }
+            m_sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+            void* sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd,
+                IORING_OFF_SQES);
+            if (sqes == MAP_FAILED)
+                return;
+            m_sqes = static_cast<struct io_uring_sqe*>(sqes);
+
+            auto sq    = static_cast<char*>(m_sq);
+            auto cq    = static_cast<char*>(m_cq);
+            m_sqHead   = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+            m_sqTail   = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+            m_sqMask   = *reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+            m_sqArray  = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+            m_cqHead   = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+            m_cqTail   = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+            m_cqMask   = *reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+            m_cqes     = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+            m_entries  = params.sq_entries;
+            m_capacity = params.cq_entries;
+            m_tail     = *m_sqTail;
+        }
+
+        ~Ring()
+        {
+            if (m_sqes)
+                munmap(m_sqes, m_sqesSize);
+            if (m_cq && m_cq != m_sq)
+                munmap(m_cq, m_cqSize);
+            if (m_sq)
+                munmap(m_sq, m_sqSize);
+            if (m_fd != -1)
+                close(m_fd);
+        }
+
+        Ring(const Ring&) = delete;
+        Ring& operator=(const Ring&) = delete;
+
+        explicit operator bool() const
+        {
+            return m_sqes != nullptr;
+        }
+
+        /// operations which may be in flight without overflowing the completions
+        unsigned capacity() const
+        {
+            return m_capacity;
+        }
+
+        /// free submission entries
+        unsigned space() const
+        {
+            return m_entries - (m_tail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE));
+        }
+
+        /// next submission entry, cleared; there must be space()
+        struct io_uring_sqe* sqe()
+        {
+            uint32_t index   = m_tail & m_sqMask;
+            m_sqArray[index] = index;
+            m_tail++;
+            memset(&m_sqes[index], 0, sizeof(struct io_uring_sqe));
+            return &m_sqes[index];
+        }
+
+        /// submits the new entries and waits for a completion; false with errno on failure
+        bool submitAndWait()
+        {
+            __atomic_store_n(m_sqTail, m_tail, __ATOMIC_RELEASE);
+            while (true) {
+                unsigned pending = m_tail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+                if (syscall(__NR_io_uring_enter, m_fd, pending, 1, IORING_ENTER_GETEVENTS, nullptr, 0) != -1)
+                    return true;
+                if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                    return false;
+            }
+        }
+
+        /// entries published to the kernel but not taken by it (after a failed submitAndWait(), they never will be)
+        unsigned unsubmitted() const
+        {
+            return m_tail - __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+        }
+
+        /// waits for a completion without submitting anything
+        void wait()
+        {
+            struct pollfd fds = {m_fd, POLLIN, 0};
+            while (poll(&fds, 1, -1) == -1 && (errno == EINTR || errno == ENOMEM))
+                ;
+        }
+
+        /// calls f(user_data, res) for each completion
+        template <typename F>
+        void reap(F&& f)
+        {
+            uint32_t head = *m_cqHead;
+            for (uint32_t tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE); head != tail; head++) {
+                const struct io_uring_cqe& cqe = m_cqes[head & m_cqMask];
+                f(cqe.user_data, cqe.res);
+            }
+            __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+        }
+
+    private:
+        int                  m_fd       = -1;
+        void*                m_sq       = nullptr;
+        void*                m_cq       = nullptr;
+        size_t               m_sqSize   = 0;
+        size_t               m_cqSize   = 0;
+        size_t               m_sqesSize = 0;
+        struct io_uring_sqe* m_sqes     = nullptr;
+        uint32_t*            m_sqHead   = nullptr;
+        uint32_t*            m_sqTail   = nullptr;
+        uint32_t*            m_sqArray  = nullptr;
+        uint32_t             m_sqMask   = 0;
+        uint32_t*            m_cqHead   = nullptr;
+        uint32_t*            m_cqTail   = nullptr;
+        uint32_t             m_cqMask   = 0;
+        struct io_uring_cqe* m_cqes     = nullptr;
+        unsigned             m_entries  = 0;
+        unsigned             m_capacity = 0;
+        uint32_t             m_tail     = 0; // entries prepared, published by submitAndWait()
+    };
+
+    // in the 2 low bits of the user_data of an operation, the index of its file above
+    enum Operation : uint64_t
+    {
+        OP_OPEN,
+        OP_READ,
+        OP_CLOSE,
+    };
+
+} // namespace
+
+static constexpr unsigned RING_ENTRIES = 256;
+
+// reads the end of a file which didn't fit its size, from offset length
+static int s_read_rest(int fd, std::string& content, size_t length)
+{
+    while (true) {
+        if (length == content.size())
+            content.resize(std::max<size_t>(4096, content.size() * 2));
+        ssize_t count = pread(fd, &content[length], content.size() - length, off_t(length));
+        if (count == -1 && errno == ESPIPE)
+            count = read(fd, &content[length], content.size() - length);
+        if (count == -1) {
+            if (errno == EINTR)
+                continue;
+            return errno;
+        }
+        if (count == 0)
+            break;
+        length += size_t(count);
+    }
+    content.resize(length);
+    return 0;
+}
+
+// false if io_uring can't be used at all
+static bool s_read_files_uring(const std::vector<std::string>& paths, std::vector<FileRead>& results)
+{
+    Ring ring(RING_ENTRIES);
+    if (!ring) {
+        log_debug("read_files: no io_uring: %s", strerror(errno));
+        return false;
+    }
+
+    struct File
+    {
+        int    fd       = -1;
+        size_t size     = 0;
+        bool   regular  = false;
+        bool   fallback = false; // operations not supported by the kernel
+        bool   finished = false; // read and closed, or failed
+    };
+    std::vector<File>    files(paths.size());
+    std::deque<uint64_t> ready; // reads and closes to queue, as user_data
+    size_t               next     = 0;
+    size_t               done     = 0;
+    unsigned             inflight = 0;
+
+    auto failed = [&](size_t index, int error) {
+        if (error == EINVAL || error == EOPNOTSUPP)
+            files[index].fallback = true;
+        else
+            results[index].error = error;
+    };
+    auto finish = [&](size_t index) {
+        if (files[index].fd != -1) {
+            ready.push_back(index << 2 | OP_CLOSE);
+            return;
+        }
+        files[index].finished = true;
+        done++;
+    };
+
+    while (done < paths.size()) {
+        while (!ready.empty() && inflight < ring.capacity() && ring.space()) {
+            size_t               index = ready.front() >> 2;
+            File&                file  = files[index];
+            struct io_uring_sqe* sqe   = ring.sqe();
+            sqe->user_data             = ready.front();
+            sqe->fd                    = file.fd;
+            if ((ready.front() & 3) == OP_READ) {
+                std::string& content = results[index].content;
+                sqe->opcode          = IORING_OP_READ;
+                sqe->addr            = uint64_t(uintptr_t(content.data()));
+                sqe->len             = uint32_t(content.size());
+            } else {
+                sqe->opcode = IORING_OP_CLOSE;
+            }
+            ready.pop_front();
+            inflight++;
+        }
+        while (next < paths.size() && inflight < ring.capacity() && ring.space()) {
+            struct io_uring_sqe* sqe = ring.sqe();
+            sqe->opcode              = IORING_OP_OPENAT;
+            sqe->fd                  = AT_FDCWD;
+            sqe->addr                = uint64_t(uintptr_t(paths[next].c_str()));
+            sqe->open_flags          = O_RDONLY | O_CLOEXEC;
+            sqe->user_data           = next << 2 | OP_OPEN;
+            next++;
+            inflight++;
+        }
+
+        if (!ring.submitAndWait()) {
+            // not expected once the ring works: the files not read yet fail
+            log_error("read_files: io_uring_enter failed: %s", strerror(errno));
+            // the operations taken by the kernel still use the paths and the buffers of results, wait for them
+            for (inflight -= ring.unsubmitted(); inflight > 0;) {
+                ring.wait();
+                ring.reap([&](uint64_t data, int res) {
+                    inflight--;
+                    size_t index = size_t(data >> 2);
+                    if ((data & 3) == OP_OPEN && res >= 0) {
+                        close(res);
+                    } else if ((data & 3) == OP_CLOSE) {
+                        files[index].fd       = -1;
+                        files[index].finished = true;
+                    }
+                });
+            }
+            for (size_t i = 0; i < paths.size(); i++) {
+                if (!files[i].finished && !results[i].error && !files[i].fallback)
+                    results[i].error = EIO;
+                if (files[i].fd != -1)
+                    close(files[i].fd);
+            }
+            break;
+        }
+
+        ring.reap([&](uint64_t data, int res) {
+            inflight--;
+            size_t index   = size_t(data >> 2);
+            File&  file    = files[index];
+            auto&  content = results[index].content;
+            switch (data & 3) {
+                case OP_OPEN: {
+                    if (res < 0) {
+                        failed(index, -res);
+                        finish(index);
+                        break;
+                    }
+                    // fstat() is cheap on an open file, IORING_OP_STATX always goes through a kernel worker
+                    file.fd = res;
+                    struct stat st;
+                    if (fstat(file.fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+                        file.regular = true;
+                        file.size    = size_t(st.st_size);
+                    }
+                    // one more byte than the size, see read_file()
+                    content.resize(file.regular ? file.size + 1 : 4096);
+                    ready.push_back(index << 2 | OP_READ);
+                    break;
+                }
+                case OP_READ:
+                    if (res < 0) {
+                        failed(index, -res);
+                    } else if (file.regular && size_t(res) < content.size() && size_t(res) >= file.size) {
+                        content.resize(size_t(res));
+                    } else if (res == 0) {
+                        content.clear();
+                    } else if (int error = s_read_rest(file.fd, content, size_t(res))) {
+                        failed(index, error);
+                    }
+                    finish(index);
+                    break;
+                case OP_CLOSE:
+                    file.fd       = -1;
+                    file.finished = true;
+                    done++;
+                    break;
+            }
+        });
+    }
+
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (files[i].fallback && !read_file(paths[i].c_str(), results[i].content))
+            results[i].error = errno;
+        if (results[i].error)
+            results[i].content.clear();
+    }
+    return true;
+}
+
+#else
+
+// no io_uring in the kernel headers
+static bool s_read_files_uring(const std::vector<std::string>&, std::vector<FileRead>&)
+{
+    return false;
+}
+
+#endif
+
+static void s_read_files_threads(
+    const std::vector<std::string>& paths, std::vector<FileRead>& results, unsigned threads)
+{
+    std::atomic<size_t> next {0};
+    auto                work = [&] {
+        for (size_t i = next++; i < paths.size(); i = next++) {
+            if (!read_file(paths[i].c_str(), results[i].content))
+                results[i].error = errno;
+        }
+    };
+
+    // the calling thread is one of them
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; i++)
+        pool.emplace_back(work);
+    work();
+    for (auto& thread : pool)
+        thread.join();
+}
+
+std::vector<FileRead> read_files(const std::vector<std::string>& paths, const ReadFilesOptions& options)
+{
+    std::vector<FileRead> results(paths.size());
+    if (paths.empty() || (options.ioUring && s_read_files_uring(paths, results)))
+        return results;
+
+    unsigned threads = options.threads ? options.threads : std::max(4u, std::thread::hardware_concurrency());
+    s_read_files_threads(paths, results, unsigned(std::min<size_t>(threads, paths.size())));
+    return results;
+}
+
+} // namespace shared
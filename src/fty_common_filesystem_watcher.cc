@@ -0,0 +1,307 @@
+/*
+Copyright (C) 2014 - 2020 Eaton
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "fty_common_filesystem.h"
+#include <fcntl.h>
+#include <fty_log.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace shared {
+
+static constexpr uint32_t WATCHED_EVENTS =
+    IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+static FileType s_file_type(mode_t mode)
+{
+    if (S_ISREG(mode))
+        return FileType::Regular;
+    if (S_ISDIR(mode))
+        return FileType::Directory;
+    if (S_ISLNK(mode))
+        return FileType::Symlink;
+    return FileType::Other;
+}
+
+static bool s_same(const struct timespec& a, const struct timespec& b)
+{
+    return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+}
+
+DirectoryWatcher::DirectoryWatcher(const std::string& path, WatcherOptions options)
+    : m_path(path)
+    , m_options(std::move(options))
+{
+    // watch first, so that nothing is missed between the listing and the events
+    if (!m_options.forcePolling) {
+        m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        m_wakeup  = eventfd(0, EFD_CLOEXEC);
+        if (m_inotify == -1 || m_wakeup == -1) {
+            log_debug("DirectoryWatcher: polling %s, no inotify: %s", m_path.c_str(), strerror(errno));
+            if (m_inotify != -1)
+                close(m_inotify);
+            if (m_wakeup != -1)
+                close(m_wakeup);
+            m_inotify = -1;
+            m_wakeup  = -1;
+        } else if (addWatch()) {
+            m_polling = false;
+        } else {
+            log_debug("DirectoryWatcher: polling %s, can't watch it: %s", m_path.c_str(), strerror(errno));
+        }
+    }
+
+    DIR* dir = opendir(m_path.c_str());
+    m_valid  = dir != nullptr;
+    if (dir)
+        closedir(dir);
+    std::vector<DirChange> changes;
+    rescan(changes);
+
+    m_thread = std::thread(&DirectoryWatcher::run, this);
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_changed.notify_all();
+    if (m_wakeup != -1) {
+        uint64_t one = 1;
+        if (write(m_wakeup, &one, sizeof(one)) != sizeof(one))
+            log_error("DirectoryWatcher: can't wake up the thread of %s", m_path.c_str());
+    }
+    m_thread.join();
+    if (m_inotify != -1)
+        close(m_inotify);
+    if (m_wakeup != -1)
+        close(m_wakeup);
+}
+
+std::shared_ptr<const std::vector<DirEntry>> DirectoryWatcher::snapshot() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_snapshot) {
+        auto entries = std::make_shared<std::vector<DirEntry>>();
+        entries->reserve(m_entries.size());
+        for (const auto& entry : m_entries)
+            entries->push_back({entry.first, entry.second.type});
+        m_snapshot = std::move(entries);
+    }
+    return m_snapshot;
+}
+
+std::vector<DirChange> DirectoryWatcher::takeChanges()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<DirChange>      changes;
+    changes.swap(m_changes);
+    return changes;
+}
+
+bool DirectoryWatcher::waitForChanges(std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_changed.wait_for(lock, timeout, [&] {
+        return !m_changes.empty();
+    });
+}
+
+// watch m_path with inotify, false if it can't (yet)
+bool DirectoryWatcher::addWatch()
+{
+    m_watch = inotify_add_watch(m_inotify, m_path.c_str(), WATCHED_EVENTS);
+    return m_watch != -1;
+}
+
+void DirectoryWatcher::run()
+{
+    while (true) {
+        while (!m_polling) {
+            struct pollfd fds[2] = {{m_inotify, POLLIN, 0}, {m_wakeup, POLLIN, 0}};
+            if (poll(fds, 2, -1) == -1) {
+                if (errno == EINTR)
+                    continue;
+                log_error("DirectoryWatcher: poll failed on %s: %s", m_path.c_str(), strerror(errno));
+                inotify_rm_watch(m_inotify, m_watch);
+                close(m_inotify);
+                m_inotify = -1;
+                m_polling = true;
+                break;
+            }
+            if (fds[1].revents)
+                return;
+            std::vector<DirChange> changes;
+            readEvents(changes);
+            publish(changes);
+        }
+
+        while (m_polling) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                if (m_changed.wait_for(lock, m_options.pollInterval, [&] {
+                        return m_stopping;
+                    }))
+                    return;
+            }
+            // back to inotify once the directory is there again; watch first, then catch up with a listing
+            bool watched = m_inotify != -1 && addWatch();
+            std::vector<DirChange> changes;
+            rescan(changes);
+            publish(changes);
+            if (watched) {
+                log_debug("DirectoryWatcher: %s is back, watching it", m_path.c_str());
+                m_polling = false;
+            }
+        }
+    }
+}
+
+void DirectoryWatcher::readEvents(std::vector<DirChange>& changes)
+{
+    alignas(struct inotify_event) char buffer[16384];
+    ssize_t                            length = read(m_inotify, buffer, sizeof(buffer));
+    if (length <= 0)
+        return;
+
+    bool rescan_needed = false;
+    bool gone          = false;
+    for (ssize_t offset = 0; offset < length;) {
+        const auto* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+        offset += ssize_t(sizeof(struct inotify_event) + event->len);
+
+        if (event->mask & IN_Q_OVERFLOW) {
+            rescan_needed = true;
+            continue;
+        }
+        // left over from the watch of a directory which was moved or deleted
+        if (event->wd != m_watch)
+            continue;
+        // the directory itself is gone, poll its path until it comes back
+        if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+            log_debug("DirectoryWatcher: %s moved or deleted, polling it", m_path.c_str());
+            // the watch follows a moved directory, not its path
+            if (event->mask & IN_MOVE_SELF)
+                inotify_rm_watch(m_inotify, m_watch);
+            m_watch       = -1;
+            gone          = true;
+            rescan_needed = true;
+            continue;
+        }
+        if (event->len == 0)
+            continue;
+
+        const char*                 name = event->name;
+        Cached                      entry;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto                        it = m_entries.find(name);
+        if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+            if (it != m_entries.end()) {
+                m_entries.erase(it);
+                changes.push_back({DirChange::Kind::Removed, name});
+            }
+        } else if (cached(name, entry)) {
+            bool known      = it != m_entries.end();
+            m_entries[name] = entry;
+            // a file created then written in the same batch is only added
+            bool just_added = !changes.empty() && changes.back().kind == DirChange::Kind::Added &&
+                              changes.back().name == name;
+            if (!just_added)
+                changes.push_back({known ? DirChange::Kind::Modified : DirChange::Kind::Added, name});
+        }
+        m_snapshot.reset();
+    }
+    if (rescan_needed)
+        rescan(changes);
+    // once the listing is up to date, as when going back to inotify
+    if (gone)
+        m_polling = true;
+}
+
+// metadata of entry name, following symbolic links; false if it is gone
+bool DirectoryWatcher::cached(const char* name, Cached& entry)
+{
+    const char* path = path::join(m_entryPath, m_path, name).data();
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        entry = {s_file_type(st.st_mode), st.st_mtim, st.st_size};
+        return true;
+    }
+    // dangling symbolic link
+    if (lstat(path, &st) == 0) {
+        entry = {FileType::Unknown, st.st_mtim, st.st_size};
+        return true;
+    }
+    return false;
+}
+
+void DirectoryWatcher::rescan(std::vector<DirChange>& changes)
+{
+    std::map<std::string, Cached> entries;
+    for (const auto& item : DirRange(m_path.c_str(), false)) {
+        Cached entry;
+        std::string name(item.name);
+        if (cached(name.c_str(), entry))
+            entries.emplace(std::move(name), entry);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto                        old = m_entries.begin();
+    for (const auto& entry : entries) {
+        for (; old != m_entries.end() && old->first < entry.first; ++old)
+            changes.push_back({DirChange::Kind::Removed, old->first});
+        if (old == m_entries.end() || old->first != entry.first) {
+            changes.push_back({DirChange::Kind::Added, entry.first});
+            continue;
+        }
+        if (old->second.type != entry.second.type || old->second.size != entry.second.size ||
+            !s_same(old->second.mtime, entry.second.mtime))
+            changes.push_back({DirChange::Kind::Modified, entry.first});
+        ++old;
+    }
+    for (; old != m_entries.end(); ++old)
+        changes.push_back({DirChange::Kind::Removed, old->first});
+
+    if (!changes.empty() || entries.size() != m_entries.size())
+        m_snapshot.reset();
+    m_entries.swap(entries);
+}
+
+void DirectoryWatcher::publish(std::vector<DirChange>& changes)
+{
+    if (changes.empty())
+        return;
+    if (m_options.callback) {
+        for (const auto& change : changes)
+            m_options.callback(change);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_changes.insert(m_changes.end(), std::make_move_iterator(changes.begin()),
+            std::make_move_iterator(changes.end()));
+    }
+    m_changed.notify_all();
+}
+
+} // namespace shared
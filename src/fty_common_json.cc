@@ -27,8 +27,10 @@
 */
 
 #include "fty_common_json.h"
+#include "fty_common_filesystem.h"
 #include <cxxtools/jsondeserializer.h>
 #include <cxxtools/jsonserializer.h>
+#include <string.h>
 
 namespace JSON {
 
@@ -150,12 +152,11 @@ void readFromString(const std::string string, cxxtools::SerializationInfo& si)
 // read/set SI from JSON file
 void readFromFile(const std::string path_name, cxxtools::SerializationInfo& si)
 {
-    std::ifstream input;
-    input.open(path_name);
-    input.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    cxxtools::JsonDeserializer deserializer(input);
-    deserializer.deserialize(si);
-    input.close();
+    std::string content;
+    if (!shared::read_file(path_name.c_str(), content))
+        throw std::ifstream::failure("can't read " + path_name + ": " + strerror(errno));
+    std::istringstream input(std::move(content));
+    readFromStream(input, si);
 }
 
 } // namespace JSON
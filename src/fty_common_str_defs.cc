@@ -27,9 +27,21 @@
 #include "fty_common_str_defs.h"
 
 /* Implement variables declared in str_defs.h */
-const char* AVG_STEPS[AVG_STEPS_SIZE] = {"15m", "30m", "1h", "8h", "24h", "7d", "30d"};
+using fty::AvgStep;
+using fty::AvgType;
+using StepCodec = fty::EnumCodec<AvgStep>;
+using TypeCodec = fty::EnumCodec<AvgType>;
 
-const char* AVG_TYPES[AVG_TYPES_SIZE] = {"arithmetic_mean", "min", "max", "consumption"};
+static_assert(AVG_STEPS_SIZE == StepCodec::count && AVG_TYPES_SIZE == TypeCodec::count);
+
+const char* AVG_STEPS[AVG_STEPS_SIZE] = {StepCodec::format(AvgStep::Min15).data(),
+    StepCodec::format(AvgStep::Min30).data(), StepCodec::format(AvgStep::Hour1).data(),
+    StepCodec::format(AvgStep::Hour8).data(), StepCodec::format(AvgStep::Hour24).data(),
+    StepCodec::format(AvgStep::Day7).data(), StepCodec::format(AvgStep::Day30).data()};
+
+const char* AVG_TYPES[AVG_TYPES_SIZE] = {TypeCodec::format(AvgType::ArithmeticMean).data(),
+    TypeCodec::format(AvgType::Min).data(), TypeCodec::format(AvgType::Max).data(),
+    TypeCodec::format(AvgType::Consumption).data()};
 
 const char* DATETIME_FORMAT = "%4d%2d%2d%2d%2d%2d%c";
 
@@ -28,9 +28,27 @@
 
 #include "fty_common_utf8.h"
 #include "fty_common_json.h"
+#include <algorithm>
 #include <cassert>
+#include <charconv>
+#include <cwchar>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <fcntl.h>
 #include <czmq.h>
 #include <fty_log.h>
+#include <langinfo.h>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
 
 namespace UTF8 {
 
@@ -173,12 +191,10 @@ int utf8_to_codepoint(const char* uchar, char** codepoint)
 // 1, ..., 4 - # of utf8 octets
 // -1 - error
 
-int8_t utf8_octets(const char* c)
+// same without logging, for inputs which may not be NUL terminated
+static int8_t s_lead_octets(uint8_t b)
 {
-    assert(c);
-    const uint8_t b = uint8_t(*c); // UTF is defined in terms of 8-bit octets, do not equate those to potentially
-                                   // varied-width platform defined char's
-    if ((b & 0x80) == 0)           // lead bit is zero, must be a single ascii
+    if ((b & 0x80) == 0) // lead bit is zero, must be a single ascii
         return 1;
     else if ((b & 0xE0) == 0xC0) // 110x xxxx (2 octets)
         return 2;
@@ -186,11 +202,20 @@ int8_t utf8_octets(const char* c)
         return 3;
     else if ((b & 0xF8) == 0xF0) // 1111 0xxx (4 octets)
         return 4;
-    else
-        log_error("Unrecognized utf8 lead byte '%" PRIx8 "' in string '%s'", b, c);
     return -1;
 }
 
+int8_t utf8_octets(const char* c)
+{
+    assert(c);
+    const uint8_t b = uint8_t(*c); // UTF is defined in terms of 8-bit octets, do not equate those to potentially
+                                   // varied-width platform defined char's
+    int8_t octets = s_lead_octets(b);
+    if (octets == -1)
+        log_error("Unrecognized utf8 lead byte '%" PRIx8 "' in string '%s'", b, c);
+    return octets;
+}
+
 // ignores case on 1 octet bytes
 // 0 - same
 // 1 - different
@@ -259,14 +284,76 @@ int utf8eq(const char* s1, const char* s2)
     return 1;
 }
 
-std::string escape(const char* string)
+namespace {
+
+// Output of the escaping functions, written either like snprintf does or appended to a string
+
+class BufferSink
 {
-    if (!string)
-        return "(null_ptr)";
+public:
+    BufferSink(char* out, size_t size)
+        : m_out(out)
+        , m_size(size)
+    {
+    }
 
-    std::string            after;
-    std::string::size_type length = strlen(string);
-    after.reserve(length * 2);
+    void append(const char* str, size_t length)
+    {
+        if (m_length < m_size)
+            memcpy(m_out + m_length, str, std::min(length, m_size - 1 - m_length));
+        m_length += length;
+    }
+
+    void clear()
+    {
+        m_length = 0;
+    }
+
+    // terminates the output, returns the complete length
+    size_t finish()
+    {
+        if (m_size != 0)
+            m_out[std::min(m_length, m_size - 1)] = '\0';
+        return m_length;
+    }
+
+private:
+    char*  m_out;
+    size_t m_size;
+    size_t m_length = 0;
+};
+
+class StringSink
+{
+public:
+    explicit StringSink(std::string& out)
+        : m_out(out)
+    {
+    }
+
+    void append(const char* str, size_t length)
+    {
+        m_out.append(str, length);
+    }
+
+    void clear()
+    {
+        m_out.clear();
+    }
+
+private:
+    std::string& m_out;
+};
+
+} // namespace
+
+template <typename Sink>
+static void s_escape(const char* string, size_t length, Sink& sink)
+{
+    if (!string) {
+        sink.append("(null_ptr)", 10);
+        return;
+    }
 
     /*
         Quote from http://www.json.org/
@@ -284,68 +371,97 @@ std::string escape(const char* string)
             \u four-hex-digits
         ------------------------------
     */
-    std::string::size_type i = 0;
+    auto plain = [](char c) {
+        return (c & 0x80) == 0 && c != '"' && c != '\\' && c != '\b' && c != '\f' && c != '\n' && c != '\r' &&
+               c != '\t';
+    };
+
+    size_t i = 0;
     while (i < length) {
+        size_t run = i;
+        while (run < length && plain(string[run]))
+            run++;
+        sink.append(string + i, run - i);
+        i = run;
+        if (i == length)
+            break;
+
         char   c     = string[i];
-        int8_t width = UTF8::utf8_octets(string + i);
+        // utf8_octets() would log the string up to a NUL, which the buffer may not have
+        int8_t width = s_lead_octets(uint8_t(c));
         switch (width) {
             case -1:
-                log_debug("Cannot escape string '%s' because of invalid UTF-8 sequences at offset %ju", string, i);
-                return "(invalid_utf8)";
+                log_debug("Cannot escape string '%.*s' because of invalid UTF-8 sequences at offset %ju",
+                    int(length), string, i);
+                sink.clear();
+                sink.append("(invalid_utf8)", 14);
+                return;
             case 1:
                 switch (c) {
                     case '"':
-                        after.append("\\\"");
+                        sink.append("\\\"", 2);
                         break;
                     case '\b':
-                        after.append("\\\\b");
+                        sink.append("\\\\b", 3);
                         break;
                     case '\f':
-                        after.append("\\\\f");
+                        sink.append("\\\\f", 3);
                         break;
                     case '\n':
-                        after.append("\\\\n");
+                        sink.append("\\\\n", 3);
                         break;
                     case '\r':
-                        after.append("\\\\r");
+                        sink.append("\\\\r", 3);
                         break;
                     case '\t':
-                        after.append("\\\\t");
-                        break;
-                    case '\\':
-                        after.append("\\\\");
+                        sink.append("\\\\t", 3);
                         break;
-                    default:
-                        after += c;
+                    default: // '\\'
+                        sink.append("\\\\", 2);
                 }      // cases of single-byte codepoint "c"
                 break; // case width==1
             case 2:
             case 3:
             case 4: {
+                if (size_t(width) > length - i) {
+                    log_debug("Cannot escape string '%.*s' because of truncated UTF-8 sequence at offset %ju",
+                        int(length), string, i);
+                    sink.clear();
+                    sink.append("(invalid_utf8)", 14);
+                    return;
+                }
                 // escape UTF-8 chars which have more than 1 byte
-                // allocate memory for "\u" + 4 hex digits + terminator
-                // allocating 8 bytes just for performance doesn't make sense
-                char* codepoint = static_cast<char*>(calloc(7, sizeof(char)));
-                // calloc () takes care of zero termination, which utf8_to_codepoint () doesn't do
+                // "\u" + up to 5 hex digits, zero filled as utf8_to_codepoint () doesn't terminate the output
+                char  buffer[8] = {};
+                char* codepoint = buffer;
                 UTF8::utf8_to_codepoint(string + i, &codepoint);
-
-                std::string codepoint_str(codepoint);
-                free(codepoint);
-                codepoint = nullptr;
-                after.append(codepoint_str);
-            } // scope codepoint_str and codepoint
-            break;
+                sink.append(buffer, strlen(buffer));
+            } break;
             default:
                 log_debug(
-                    "Cannot escape string '%s' because utf8_octets() returned "
+                    "Cannot escape string '%.*s' because the lead byte announced an "
                     "unexpected byte length %" PRIi8 " for logical character at offset %ju",
-                    string, width, i);
-                return "(invalid_utf8)";
+                    int(length), string, width, i);
+                sink.clear();
+                sink.append("(invalid_utf8)", 14);
+                return;
         } // cases of width
 
         // We should not have width==0 ever, and -1 is filtered above
         i += size_t(width);
     }
+}
+
+std::string escape(const char* string)
+{
+    if (!string)
+        return "(null_ptr)";
+
+    std::string after;
+    size_t      length = strlen(string);
+    after.reserve(length * 2);
+    StringSink sink(after);
+    s_escape(string, length, sink);
     return after;
 }
 
@@ -354,25 +470,358 @@ std::string escape(const std::string& before)
     return escape(before.c_str());
 }
 
-std::string bash_escape(std::string& param)
+size_t escape_to(const char* string, size_t length, char* out, size_t size)
 {
-    std::string escape_chars(" \t!\"#$&'()*,;<=>?[\\]^`{|}~");
-    std::string escaped;
-    size_t      start = 0;
-    while (true) {
-        size_t end = param.find_first_of(escape_chars, start);
-        if (end == std::string::npos) {
-            escaped += param.substr(start);
+    BufferSink sink(out, size);
+    s_escape(string, length, sink);
+    return sink.finish();
+}
+
+static bool s_read_hex4(const char* str, const char* end, uint32_t& value)
+{
+    if (end - str < 4)
+        return false;
+    value = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = str[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9')
+            value |= uint32_t(c - '0');
+        else if (c >= 'a' && c <= 'f')
+            value |= uint32_t(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F')
+            value |= uint32_t(c - 'A' + 10);
+        else
+            return false;
+    }
+    return true;
+}
+
+static size_t s_encode_utf8(uint32_t codepoint, char* out)
+{
+    if (codepoint < 0x80) {
+        out[0] = char(codepoint);
+        return 1;
+    }
+    if (codepoint < 0x800) {
+        out[0] = char(0xC0 | (codepoint >> 6));
+        out[1] = char(0x80 | (codepoint & 0x3F));
+        return 2;
+    }
+    if (codepoint < 0x10000) {
+        out[0] = char(0xE0 | (codepoint >> 12));
+        out[1] = char(0x80 | ((codepoint >> 6) & 0x3F));
+        out[2] = char(0x80 | (codepoint & 0x3F));
+        return 3;
+    }
+    out[0] = char(0xF0 | (codepoint >> 18));
+    out[1] = char(0x80 | ((codepoint >> 12) & 0x3F));
+    out[2] = char(0x80 | ((codepoint >> 6) & 0x3F));
+    out[3] = char(0x80 | (codepoint & 0x3F));
+    return 4;
+}
+
+size_t unescape_to(std::string_view str, char* out)
+{
+    const char* in  = str.data();
+    const char* end = in + str.size();
+    char*       dst = out;
+
+    // the output never grows, so dst never passes in and out may be str itself
+    while (in < end) {
+        // memchr () is vectorized by the C library, clean runs are copied in bulk
+        const char* backslash = static_cast<const char*>(memchr(in, '\\', size_t(end - in)));
+        size_t      run       = backslash ? size_t(backslash - in) : size_t(end - in);
+        if (dst != in)
+            memmove(dst, in, run);
+        dst += run;
+        in += run;
+        if (!backslash)
+            break;
+
+        if (end - in < 2) {
+            log_debug("Cannot unescape string '%.*s': truncated escape sequence at offset %zu", int(str.size()),
+                str.data(), size_t(in - str.data()));
+            return std::string::npos;
+        }
+        char c = in[1];
+        in += 2;
+        switch (c) {
+            case '"':
+            case '\\':
+            case '/':
+                *dst++ = c;
+                break;
+            case 'b':
+                *dst++ = '\b';
+                break;
+            case 'f':
+                *dst++ = '\f';
+                break;
+            case 'n':
+                *dst++ = '\n';
+                break;
+            case 'r':
+                *dst++ = '\r';
+                break;
+            case 't':
+                *dst++ = '\t';
+                break;
+            case 'u': {
+                uint32_t codepoint;
+                if (!s_read_hex4(in, end, codepoint)) {
+                    log_debug("Cannot unescape string '%.*s': invalid \\u sequence at offset %zu", int(str.size()),
+                        str.data(), size_t(in - 2 - str.data()));
+                    return std::string::npos;
+                }
+                in += 4;
+                if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+                    // high surrogate, must be followed by the low one
+                    uint32_t low;
+                    if (end - in < 6 || in[0] != '\\' || in[1] != 'u' || !s_read_hex4(in + 2, end, low) ||
+                        low < 0xDC00 || low > 0xDFFF) {
+                        log_debug("Cannot unescape string '%.*s': unpaired surrogate at offset %zu", int(str.size()),
+                            str.data(), size_t(in - 6 - str.data()));
+                        return std::string::npos;
+                    }
+                    in += 6;
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                } else if (codepoint >= 0xDC00 && codepoint <= 0xDFFF) {
+                    log_debug("Cannot unescape string '%.*s': unpaired surrogate at offset %zu", int(str.size()),
+                        str.data(), size_t(in - 6 - str.data()));
+                    return std::string::npos;
+                }
+                dst += s_encode_utf8(codepoint, dst);
+            } break;
+            default:
+                log_debug("Cannot unescape string '%.*s': invalid escape sequence at offset %zu", int(str.size()),
+                    str.data(), size_t(in - 2 - str.data()));
+                return std::string::npos;
+        }
+    }
+    return size_t(dst - out);
+}
+
+bool unescape(std::string_view str, std::string& out)
+{
+    out.resize(str.size());
+    size_t length = unescape_to(str, &out[0]);
+    if (length == std::string::npos) {
+        out.clear();
+        return false;
+    }
+    out.resize(length);
+    return true;
+}
+
+bool unescape_in_place(std::string& str)
+{
+    size_t length = unescape_to(str, &str[0]);
+    if (length == std::string::npos)
+        return false;
+    str.resize(length);
+    return true;
+}
+
+// Escaping engine
+//
+// Every context is described by a 256-entry table giving the replacement of each byte (bytes without replacement are
+// copied as they are). Runs of bytes which don't need escaping are skipped 16 bytes at a time when SSE2 is available.
+
+namespace {
+
+struct EscapeTable
+{
+    uint8_t length[256];  // length of the replacement, 0 if the byte is copied
+    char    text[256][6]; // replacement
+    bool    quote[256];   // byte requires the output to be enclosed in quotes (CSV)
+    char    open;         // quote written before the output, '\0' for none
+    char    close;        // quote written after the output
+    bool    always_quote; // otherwise only if a byte requires it
+
+    // bytes to look for when skipping runs with SIMD
+    // more than 8 special bytes: only alphanumeric and non-ASCII bytes are skipped
+    char specials[8];
+    int  special_count;
+    bool controls; // bytes below 0x20 are special
+};
+
+constexpr void s_set_escape(EscapeTable& table, unsigned char c, std::string_view text)
+{
+    table.length[c] = uint8_t(text.size());
+    for (size_t i = 0; i < text.size(); i++)
+        table.text[c][i] = text[i];
+}
+
+constexpr EscapeTable s_make_escape_table(EscapeContext context)
+{
+    EscapeTable table{};
+    switch (context) {
+        case EscapeContext::Shell: {
+            // same set as the historical bash_escape
+            constexpr std::string_view specials = " \t!\"#$&'()*,;<=>?[\\]^`{|}~";
+            for (char c : specials) {
+                char text[2] = {'\\', c};
+                s_set_escape(table, static_cast<unsigned char>(c), std::string_view(text, 2));
+            }
+            break;
+        }
+        case EscapeContext::Json: {
+            constexpr char hex[] = "0123456789abcdef";
+            for (unsigned c = 0; c < 0x20; c++) {
+                char text[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+                s_set_escape(table, static_cast<unsigned char>(c), std::string_view(text, 6));
+            }
+            s_set_escape(table, '"', "\\\"");
+            s_set_escape(table, '\\', "\\\\");
+            s_set_escape(table, '\b', "\\b");
+            s_set_escape(table, '\f', "\\f");
+            s_set_escape(table, '\n', "\\n");
+            s_set_escape(table, '\r', "\\r");
+            s_set_escape(table, '\t', "\\t");
+            break;
+        }
+        case EscapeContext::Csv:
+            s_set_escape(table, '"', "\"\"");
+            table.quote['"']  = true;
+            table.quote[',']  = true;
+            table.quote['\r'] = true;
+            table.quote['\n'] = true;
+            table.open        = '"';
+            table.close       = '"';
             break;
+        case EscapeContext::Xml:
+            s_set_escape(table, '&', "&amp;");
+            s_set_escape(table, '<', "&lt;");
+            s_set_escape(table, '>', "&gt;");
+            s_set_escape(table, '"', "&quot;");
+            s_set_escape(table, '\'', "&#39;");
+            break;
+        case EscapeContext::SqlIdentifier:
+            s_set_escape(table, '`', "``");
+            table.open         = '`';
+            table.close        = '`';
+            table.always_quote = true;
+            break;
+    }
+
+    for (unsigned c = 0; c < 256; c++) {
+        if (table.length[c] == 0 && !table.quote[c])
+            continue;
+        if (c < 0x20) {
+            table.controls = true;
+        } else if (table.special_count < 8) {
+            table.specials[table.special_count] = char(c);
+            table.special_count++;
+        } else {
+            table.special_count++;
+        }
+    }
+    return table;
+}
+
+constexpr EscapeTable s_escape_tables[] = {
+    s_make_escape_table(EscapeContext::Shell),
+    s_make_escape_table(EscapeContext::Json),
+    s_make_escape_table(EscapeContext::Csv),
+    s_make_escape_table(EscapeContext::Xml),
+    s_make_escape_table(EscapeContext::SqlIdentifier),
+};
+
+// length of the leading run of bytes which are copied as they are
+static size_t s_plain_run(const EscapeTable& table, const unsigned char* str, size_t length)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    if (table.special_count <= 8) {
+        for (; i + 16 <= length; i += 16) {
+            __m128i block   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+            __m128i special = _mm_setzero_si128();
+            for (int k = 0; k < table.special_count; k++)
+                special = _mm_or_si128(special, _mm_cmpeq_epi8(block, _mm_set1_epi8(table.specials[k])));
+            if (table.controls) {
+                __m128i limit = _mm_set1_epi8(0x1f);
+                special       = _mm_or_si128(special, _mm_cmpeq_epi8(_mm_max_epu8(block, limit), limit));
+            }
+            if (_mm_movemask_epi8(special) != 0)
+                break;
+        }
+    } else {
+        auto in_range = [](__m128i block, char low, char high) {
+            __m128i clamped = _mm_min_epu8(_mm_max_epu8(block, _mm_set1_epi8(low)), _mm_set1_epi8(high));
+            return _mm_cmpeq_epi8(clamped, block);
+        };
+        for (; i + 16 <= length; i += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+            __m128i lower = _mm_or_si128(block, _mm_set1_epi8(0x20));
+            __m128i plain = _mm_or_si128(in_range(block, '0', '9'), in_range(lower, 'a', 'z'));
+            plain         = _mm_or_si128(plain, in_range(block, char(0x80), char(0xff)));
+            if (_mm_movemask_epi8(plain) != 0xffff)
+                break;
         }
-        size_t length = end - start;
-        escaped += param.substr(start, length) + "\\" + param[end];
-        start = end + 1;
     }
+#endif
+    while (i < length && table.length[str[i]] == 0 && !table.quote[str[i]])
+        i++;
+    return i;
+}
+
+} // namespace
+
+template <typename Sink>
+static void s_escape_for(EscapeContext context, std::string_view str, Sink& sink)
+{
+    const EscapeTable&   table = s_escape_tables[static_cast<int>(context)];
+    const unsigned char* in    = reinterpret_cast<const unsigned char*>(str.data());
+
+    bool quoted = table.always_quote;
+    if (!quoted && table.open != '\0') {
+        for (size_t pos = 0; pos < str.size() && !quoted; pos++) {
+            pos += s_plain_run(table, in + pos, str.size() - pos);
+            quoted = pos < str.size() && table.quote[in[pos]];
+        }
+    }
+
+    if (quoted)
+        sink.append(&table.open, 1);
+    size_t pos = 0;
+    while (pos < str.size()) {
+        size_t run = s_plain_run(table, in + pos, str.size() - pos);
+        sink.append(str.data() + pos, run);
+        pos += run;
+        if (pos == str.size())
+            break;
+        unsigned char c = in[pos++];
+        if (table.length[c] != 0)
+            sink.append(table.text[c], table.length[c]);
+        else
+            sink.append(reinterpret_cast<const char*>(&c), 1);
+    }
+    if (quoted)
+        sink.append(&table.close, 1);
+}
 
+size_t escape_to(EscapeContext context, std::string_view str, char* out, size_t size)
+{
+    BufferSink sink(out, size);
+    s_escape_for(context, str, sink);
+    return sink.finish();
+}
+
+std::string escape_for(EscapeContext context, std::string_view str)
+{
+    std::string escaped;
+    escaped.reserve(str.size() + str.size() / 8 + 2);
+    StringSink sink(escaped);
+    s_escape_for(context, str, sink);
     return escaped;
 }
 
+std::string bash_escape(std::string& param)
+{
+    return escape_for(EscapeContext::Shell, param);
+}
+
 // This function converts string expressed as ("Text used as a key with %s and %d", var1, var2, ...) into JSON format:
 // {
 //  "key" : "Text used as a key with $var1$ and $var2$",
@@ -385,89 +834,136 @@ std::string bash_escape(std::string& param)
 // It makes the following assumptions:
 // * we are not using a 'space' flag in formatting directives
 // * every conversion is either %s, or a sequence of non-space characters started with % and ended with a space
+//
+// Keys are almost always string literals, so the parsing is done once per key: the key is compiled into a template
+// made of literal segments and typed argument slots, which is cached and then rendered in a single append pass.
 
-static std::string s_jsonify_translation_string(const char* key, va_list args)
+namespace {
+
+// type of the argument consumed by a printf conversion
+enum class ArgKind : uint8_t
 {
-    // log_trace ("called");
+    NoArg, // %m
+    Int,
+    Long,
+    LongLong,
+    IntMax,
+    SSize,
+    PtrDiff,
+    UInt,
+    ULong,
+    ULongLong,
+    UIntMax,
+    Size,
+    Double,
+    LongDouble,
+    String,
+    Pointer,
+    Char,
+    WInt
+};
 
-    // check if 'key' is already in JSON format
-    // since we may start/end with {{vari}} and we don't want to go through the whole string,
-    // check just first two and last two characters
-    size_t length = strlen(key);
-    if (length >= 2 && key[0] == '{' && key[1] != '{' && key[length - 2] != '}' && key[length - 1] == '}') {
-        return std::string(key);
-    }
+struct ArgValue
+{
+    union
+    {
+        long long          i;
+        unsigned long long u;
+        double             d;
+        long double        ld;
+        const void*        p;
+    };
+    size_t length     = std::string_view::npos; // length of a string, if known
+    bool   terminated = true;                   // string is followed by a NUL character
+    bool   json       = false;                  // string is known to be serialized JSON
+};
 
-    size_t  pos      = 0;
-    int     va_index = 1;
-    va_list args2, args3;
-    va_copy(args2, args);
-    va_copy(args3, args);
+// literal text followed by an (optional) printf conversion
+struct Piece
+{
+    std::string literal;
+    std::string spec;               // empty for the trailing literal
+    ArgKind     kind       = ArgKind::NoArg;
+    uint8_t     stars      = 0;     // number of '*' width/precision arguments
+    bool        plain      = false; // no flags, width nor precision
+    char        float_conv = '\0';  // %f, %e or %g without flags nor width, rendered by std::to_chars
+    int         precision  = 6;
+    bool        json_slot  = false; // whole variable is this %s, nested JSON objects are embedded unquoted
+};
 
-    // make std::string copy so we can use insert/append
+struct CompiledTemplate
+{
+    std::string        key;              // original key, validates pointer-keyed cache hits
+    bool               verbatim = false; // key is already in JSON format
+    bool               legacy   = false; // format not understood by the compiler, rendered by vsnprintf
+    std::string        format;           // JSON printf format
+    std::vector<Piece> pieces;
+    size_t             size_hint = 0;
+};
+
+// build the JSON printf format out of the translation key
+static void s_build_json_format(const char* key, CompiledTemplate& tmpl)
+{
     std::string key_replaced;
-    key_replaced.reserve(length);
+    key_replaced.reserve(tmpl.key.size() + 16);
     std::string json_format;
-    std::string var_entry;
+    int         va_index = 1;
 
     while (*key != '\0') {
+        // copy the literal run up to the next formatting directive
+        const char* percent = strchr(key, '%');
+        if (percent == nullptr) {
+            key_replaced.append(key);
+            break;
+        }
+        key_replaced.append(key, size_t(percent - key));
+        key = percent;
+
         // start of formatting directive
-        if (*key == '%') {
-            std::string var_str     = "var" + std::to_string(va_index);
-            std::string var_str_ref = "{{" + var_str + "}}";
-            std::string format;
-            // copy the formatting directive
-            bool loop_control = true;
-            while (loop_control) {
-                switch (*key) {
-                    case ' ':
-                    case '\0':
-                    case '"':
-                    case '(':
-                    case ')':
-                    case '[':
-                    case ']':
+        std::string var_str = "var" + std::to_string(va_index);
+        std::string format;
+        // copy the formatting directive
+        bool loop_control = true;
+        while (loop_control) {
+            switch (*key) {
+                case ' ':
+                case '\0':
+                case '"':
+                case '(':
+                case ')':
+                case '[':
+                case ']':
+                    loop_control = false;
+                    break;
+                case '\'':
+                    if (*(key - 1) != '%') {
                         loop_control = false;
                         break;
-                    case '\'':
-                        if (*(key - 1) != '%') {
-                            loop_control = false;
-                            break;
-                        } else {
-                            [[fallthrough]];
-                        }
-                    default:
-                        format.append(key, 1);
-                        key++;
-                        if (format == "%s")
-                            loop_control = false;
-                        break;
-                }
+                    } else {
+                        [[fallthrough]];
+                    }
+                default:
+                    format.append(key, 1);
+                    key++;
+                    if (format == "%s")
+                        loop_control = false;
+                    break;
             }
+        }
 
-            var_entry = " \"" + var_str + "\": \"" + format + "\",";
-            // update the key_replaced with variable string reference
-            key_replaced.append(var_str_ref);
-
-            // append JSON format entry for this variable
-            // TODO: build objects for some variables (like dates)
-            json_format.append(var_entry);
-            va_index++;
+        // update the key_replaced with variable string reference
+        key_replaced.append("{{").append(var_str).append("}}");
 
-            format.clear();
-            var_entry.clear();
-            // update the position in key_replaced to correspond to key
-            pos += var_str_ref.size();
-        } else {
-            key_replaced.insert(pos, key, 1);
-            key++;
-            pos++;
-        }
+        // append JSON format entry for this variable
+        // TODO: build objects for some variables (like dates)
+        json_format.append(" \"").append(var_str).append("\": \"").append(format).append("\",");
+        va_index++;
     }
 
     if (json_format.empty()) {
-        // no formatting directives, finish up the JSON and return
-        return "{ \"key\": \"" + key_replaced + "\" }";
+        // no formatting directives, the JSON is complete
+        tmpl.format = "{ \"key\": \"" + key_replaced + "\" }";
+        return;
     }
 
     // finish up the JSON with formatting directives:
@@ -475,33 +971,628 @@ static std::string s_jsonify_translation_string(const char* key, va_list args)
     // remove the trailing comma
     json_format.pop_back();
     json_format.append(" } }");
+    tmpl.format = std::move(json_format);
+}
+
+// split the JSON printf format into literal segments and typed argument slots
+// returns false for conversions we do not handle (positional arguments, %n, ...)
+static bool s_compile_pieces(const std::string& format, std::vector<Piece>& pieces)
+{
+    const char* f = format.c_str();
+    Piece       piece;
+
+    while (*f != '\0') {
+        if (*f != '%') {
+            const char* percent = strchr(f, '%');
+            size_t      run     = percent ? size_t(percent - f) : strlen(f);
+            piece.literal.append(f, run);
+            f += run;
+            continue;
+        }
+        if (f[1] == '%') {
+            piece.literal += '%';
+            f += 2;
+            continue;
+        }
 
-    // replace formatting directives with real content
-    char* json_attempt = static_cast<char*>(zmalloc(json_format.length()));
-    if (json_attempt == nullptr) {
-        log_error("JSON buffer allocate has failed (%zu bytes)", json_format.length());
+        const char* start     = f++;
+        bool        plain     = true;
+        bool        flagged   = false;
+        uint8_t     stars     = 0;
+        int         precision = -1;
+
+        // positional arguments can't be consumed in order
+        const char* digits = f;
+        while (isdigit(static_cast<unsigned char>(*digits)))
+            digits++;
+        if (digits != f && *digits == '$')
+            return false;
+
+        // flags
+        while (*f != '\0' && strchr("-+ #0'I", *f) != nullptr) {
+            plain   = false;
+            flagged = true;
+            f++;
+        }
+        // width
+        const char* after_flags = f;
+        if (*f == '*') {
+            stars++;
+            f++;
+        }
+        while (isdigit(static_cast<unsigned char>(*f)))
+            f++;
+        bool has_width = f != after_flags;
+        // precision
+        if (*f == '.') {
+            f++;
+            if (*f == '*') {
+                stars++;
+                f++;
+            } else {
+                precision = 0;
+                while (isdigit(static_cast<unsigned char>(*f))) {
+                    precision = std::min(precision * 10 + (*f - '0'), 1000);
+                    f++;
+                }
+            }
+        }
+        if (f != after_flags)
+            plain = false;
+
+        // length modifier
+        int length = 0; // 1 = hh/h, 2 = l, 3 = ll/q, 4 = L, 5 = j, 6 = z/Z, 7 = t
+        switch (*f) {
+            case 'h':
+                // value is narrowed by printf
+                length = 1;
+                plain  = false;
+                f += (f[1] == 'h') ? 2 : 1;
+                break;
+            case 'l':
+                length = (f[1] == 'l') ? 3 : 2;
+                f += (f[1] == 'l') ? 2 : 1;
+                break;
+            case 'q':
+                length = 3;
+                f++;
+                break;
+            case 'L':
+                length = 4;
+                f++;
+                break;
+            case 'j':
+                length = 5;
+                f++;
+                break;
+            case 'z':
+            case 'Z':
+                length = 6;
+                f++;
+                break;
+            case 't':
+                length = 7;
+                f++;
+                break;
+            default:
+                break;
+        }
+
+        ArgKind kind;
+        switch (*f) {
+            case 'd':
+            case 'i': {
+                static const ArgKind kinds[] = {ArgKind::Int, ArgKind::Int, ArgKind::Long, ArgKind::LongLong,
+                    ArgKind::LongLong, ArgKind::IntMax, ArgKind::SSize, ArgKind::PtrDiff};
+                kind = kinds[length];
+                break;
+            }
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X': {
+                static const ArgKind kinds[] = {ArgKind::UInt, ArgKind::UInt, ArgKind::ULong, ArgKind::ULongLong,
+                    ArgKind::ULongLong, ArgKind::UIntMax, ArgKind::Size, ArgKind::PtrDiff};
+                kind = kinds[length];
+                if (*f != 'u')
+                    plain = false;
+                break;
+            }
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                kind  = (length == 4) ? ArgKind::LongDouble : ArgKind::Double;
+                plain = false;
+                if ((*f == 'f' || *f == 'e' || *f == 'g') && length == 0 && !flagged && !has_width && stars == 0) {
+                    piece.float_conv = *f;
+                    piece.precision  = precision < 0 ? 6 : precision;
+                }
+                break;
+            case 'c':
+                kind = (length == 2) ? ArgKind::WInt : ArgKind::Char;
+                if (length != 0)
+                    plain = false;
+                break;
+            case 's':
+                kind = (length == 0) ? ArgKind::String : ArgKind::Pointer;
+                if (length != 0)
+                    plain = false;
+                break;
+            case 'p':
+                kind  = ArgKind::Pointer;
+                plain = false;
+                break;
+            case 'm':
+                kind  = ArgKind::NoArg;
+                plain = false;
+                break;
+            default:
+                // %n, %C, %S, incomplete directive...
+                return false;
+        }
+        f++;
+
+        piece.spec.assign(start, size_t(f - start));
+        piece.json_slot = kind == ArgKind::String && piece.spec == "%s" && !piece.literal.empty() &&
+                          piece.literal.back() == '"' && *f == '"';
+        piece.kind  = kind;
+        piece.stars = stars;
+        piece.plain = plain;
+        pieces.push_back(std::move(piece));
+        piece = Piece();
     }
-    size_t missing = size_t(vsnprintf(json_attempt, json_format.length(), json_format.c_str(), args2));
-    va_end(args2);
-    if (missing >= json_format.length()) {
-        char* json = static_cast<char*>(realloc(json_attempt, missing + 1));
-        if (json == nullptr) {
-            log_error("JSON buffer reallocate has failed (%zu bytes)", (missing + 1));
+    pieces.push_back(std::move(piece));
+    return true;
+}
+
+static std::shared_ptr<const CompiledTemplate> s_compile_template(const char* key, size_t length)
+{
+    auto tmpl = std::make_shared<CompiledTemplate>();
+    tmpl->key.assign(key, length);
+
+    // check if 'key' is already in JSON format
+    // since we may start/end with {{vari}} and we don't want to go through the whole string,
+    // check just first two and last two characters
+    if (length >= 2 && key[0] == '{' && key[1] != '{' && key[length - 2] != '}' && key[length - 1] == '}') {
+        tmpl->verbatim = true;
+        return tmpl;
+    }
+
+    s_build_json_format(key, *tmpl);
+    if (!s_compile_pieces(tmpl->format, tmpl->pieces)) {
+        log_debug("Translation key '%s' is not compiled, falling back to vsnprintf", key);
+        tmpl->legacy = true;
+        tmpl->pieces.clear();
+    }
+    for (const auto& piece : tmpl->pieces)
+        tmpl->size_hint += piece.literal.size() + 8;
+    return tmpl;
+}
+
+// Thread-safe cache of compiled templates
+// Lookups are keyed on the key pointer (string literals have a stable address), the content is checked to catch
+// reused buffers and the content hash is used as a fallback for keys built at runtime.
+class TemplateCache
+{
+public:
+    std::shared_ptr<const CompiledTemplate> get(const char* key)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            auto                                it = m_byPointer.find(key);
+            if (it != m_byPointer.end() && it->second->key.compare(key) == 0)
+                return it->second;
         }
-        if (json != nullptr && json != json_attempt) {
-            json_attempt = json;
+
+        std::string_view content(key);
+        {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            auto                                it = m_byContent.find(content);
+            if (it != m_byContent.end()) {
+                auto tmpl = it->second;
+                lock.unlock();
+                remember(key, tmpl);
+                return tmpl;
+            }
+        }
+
+        auto tmpl = s_compile_template(key, content.size());
+        remember(key, tmpl);
+        return tmpl;
+    }
+
+private:
+    // keys built at runtime (e.g. translated error messages) must not grow the cache forever
+    static constexpr size_t MAX_ENTRIES = 4096;
+
+    void remember(const char* key, const std::shared_ptr<const CompiledTemplate>& tmpl)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        if (m_byPointer.size() >= MAX_ENTRIES || m_byContent.size() >= MAX_ENTRIES) {
+            m_byPointer.clear();
+            m_byContent.clear();
         }
-        vsnprintf(json_attempt, missing + 1, json_format.c_str(), args3);
-        va_end(args3);
+        m_byPointer[key] = tmpl;
+        m_byContent.emplace(std::string_view(tmpl->key), tmpl);
+    }
+
+    std::shared_mutex                                                             m_mutex;
+    std::unordered_map<const char*, std::shared_ptr<const CompiledTemplate>>      m_byPointer;
+    std::unordered_map<std::string_view, std::shared_ptr<const CompiledTemplate>> m_byContent;
+};
+
+static TemplateCache& s_template_cache()
+{
+    static TemplateCache cache;
+    return cache;
+}
+
+template <typename T>
+static int s_snprintf(char* buffer, size_t size, const Piece& piece, const int* stars, T value)
+{
+    switch (piece.stars) {
+        case 0:
+            return snprintf(buffer, size, piece.spec.c_str(), value);
+        case 1:
+            return snprintf(buffer, size, piece.spec.c_str(), stars[0], value);
+        default:
+            return snprintf(buffer, size, piece.spec.c_str(), stars[0], stars[1], value);
+    }
+}
+
+static int s_format_value(char* buffer, size_t size, const Piece& piece, const int* stars, const ArgValue& value)
+{
+    switch (piece.kind) {
+        case ArgKind::NoArg:
+            return snprintf(buffer, size, piece.spec.c_str(), 0);
+        case ArgKind::Int:
+        case ArgKind::Char:
+            return s_snprintf(buffer, size, piece, stars, int(value.i));
+        case ArgKind::Long:
+            return s_snprintf(buffer, size, piece, stars, long(value.i));
+        case ArgKind::LongLong:
+            return s_snprintf(buffer, size, piece, stars, value.i);
+        case ArgKind::IntMax:
+            return s_snprintf(buffer, size, piece, stars, intmax_t(value.i));
+        case ArgKind::SSize:
+            return s_snprintf(buffer, size, piece, stars, ssize_t(value.i));
+        case ArgKind::PtrDiff:
+            return s_snprintf(buffer, size, piece, stars, ptrdiff_t(value.i));
+        case ArgKind::UInt:
+            return s_snprintf(buffer, size, piece, stars, unsigned(value.u));
+        case ArgKind::ULong:
+            return s_snprintf(buffer, size, piece, stars, static_cast<unsigned long>(value.u));
+        case ArgKind::ULongLong:
+            return s_snprintf(buffer, size, piece, stars, value.u);
+        case ArgKind::UIntMax:
+            return s_snprintf(buffer, size, piece, stars, uintmax_t(value.u));
+        case ArgKind::Size:
+            return s_snprintf(buffer, size, piece, stars, size_t(value.u));
+        case ArgKind::WInt:
+            return s_snprintf(buffer, size, piece, stars, wint_t(value.u));
+        case ArgKind::Double:
+            return s_snprintf(buffer, size, piece, stars, value.d);
+        case ArgKind::LongDouble:
+            return s_snprintf(buffer, size, piece, stars, value.ld);
+        case ArgKind::String:
+            return s_snprintf(buffer, size, piece, stars, static_cast<const char*>(value.p));
+        case ArgKind::Pointer:
+            return s_snprintf(buffer, size, piece, stars, value.p);
+    }
+    return -1;
+}
+
+// printf honours LC_NUMERIC, std::to_chars does not
+static bool s_c_decimal_point()
+{
+    const char* point = nl_langinfo(RADIXCHAR);
+    return point && point[0] == '.' && point[1] == '\0';
+}
+
+// append one argument, returns false if the output has to stop here (embedded NUL character)
+static bool s_append_value(std::string& out, const Piece& piece, const int* stars, const ArgValue& value)
+{
+    if (piece.plain) {
+        char  digits[24];
+        char* end = digits;
+        switch (piece.kind) {
+            case ArgKind::String: {
+                const char* str = static_cast<const char*>(value.p);
+                if (str == nullptr)
+                    out.append("(null)");
+                else if (value.length != std::string_view::npos)
+                    out.append(str, value.length);
+                else
+                    out.append(str);
+                return true;
+            }
+            case ArgKind::Char:
+                if (char(value.i) == '\0')
+                    return false;
+                out += char(value.i);
+                return true;
+            case ArgKind::Int:
+                end = std::to_chars(digits, digits + sizeof(digits), int(value.i)).ptr;
+                break;
+            case ArgKind::Long:
+            case ArgKind::LongLong:
+            case ArgKind::IntMax:
+            case ArgKind::SSize:
+            case ArgKind::PtrDiff:
+                end = std::to_chars(digits, digits + sizeof(digits), value.i).ptr;
+                break;
+            case ArgKind::UInt:
+                end = std::to_chars(digits, digits + sizeof(digits), unsigned(value.u)).ptr;
+                break;
+            case ArgKind::ULong:
+            case ArgKind::ULongLong:
+            case ArgKind::UIntMax:
+            case ArgKind::Size:
+                end = std::to_chars(digits, digits + sizeof(digits), value.u).ptr;
+                break;
+            default:
+                break;
+        }
+        if (end != digits) {
+            out.append(digits, size_t(end - digits));
+            return true;
+        }
+    }
+
+    char buffer[64];
+    if (piece.float_conv != '\0' && s_c_decimal_point()) {
+        std::chars_format format = piece.float_conv == 'f'
+            ? std::chars_format::fixed
+            : (piece.float_conv == 'e' ? std::chars_format::scientific : std::chars_format::general);
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value.d, format, piece.precision);
+        if (result.ec == std::errc()) {
+            out.append(buffer, size_t(result.ptr - buffer));
+            return true;
+        }
+    }
+
+    if (piece.kind == ArgKind::String && !value.terminated && value.p != nullptr) {
+        std::string copy(static_cast<const char*>(value.p), value.length);
+        ArgValue    terminated;
+        terminated.p = copy.c_str();
+        return s_append_value(out, piece, stars, terminated);
+    }
+
+    int needed = s_format_value(buffer, sizeof(buffer), piece, stars, value);
+    if (needed < 0)
+        return true;
+    if (size_t(needed) < sizeof(buffer)) {
+        out.append(buffer, size_t(needed));
     } else {
-        // log_trace ("JSON buffer was sufficient");
+        size_t offset = out.size();
+        out.resize(offset + size_t(needed) + 1);
+        s_format_value(&out[offset], size_t(needed) + 1, piece, stars, value);
+        out.resize(offset + size_t(needed));
+    }
+    // vsnprintf output used to be read back as a C string
+    return strlen(out.c_str() + (out.size() - size_t(needed))) == size_t(needed);
+}
+
+// arguments of a jsonify_translation_string call
+class VaArgSource
+{
+public:
+    explicit VaArgSource(va_list args)
+    {
+        va_copy(m_args, args);
+    }
+
+    ~VaArgSource()
+    {
+        va_end(m_args);
+    }
+
+    int star()
+    {
+        return va_arg(m_args, int);
+    }
+
+    ArgValue value(ArgKind kind)
+    {
+        ArgValue value;
+        value.u = 0;
+        switch (kind) {
+            case ArgKind::NoArg:
+                break;
+            case ArgKind::Int:
+            case ArgKind::Char:
+                value.i = va_arg(m_args, int);
+                break;
+            case ArgKind::Long:
+                value.i = va_arg(m_args, long);
+                break;
+            case ArgKind::LongLong:
+                value.i = va_arg(m_args, long long);
+                break;
+            case ArgKind::IntMax:
+                value.i = va_arg(m_args, intmax_t);
+                break;
+            case ArgKind::SSize:
+                value.i = va_arg(m_args, ssize_t);
+                break;
+            case ArgKind::PtrDiff:
+                value.i = va_arg(m_args, ptrdiff_t);
+                break;
+            case ArgKind::UInt:
+            case ArgKind::WInt:
+                value.u = va_arg(m_args, unsigned);
+                break;
+            case ArgKind::ULong:
+                value.u = va_arg(m_args, unsigned long);
+                break;
+            case ArgKind::ULongLong:
+                value.u = va_arg(m_args, unsigned long long);
+                break;
+            case ArgKind::UIntMax:
+                value.u = va_arg(m_args, uintmax_t);
+                break;
+            case ArgKind::Size:
+                value.u = va_arg(m_args, size_t);
+                break;
+            case ArgKind::Double:
+                value.d = va_arg(m_args, double);
+                break;
+            case ArgKind::LongDouble:
+                value.ld = va_arg(m_args, long double);
+                break;
+            case ArgKind::String:
+            case ArgKind::Pointer:
+                value.p = va_arg(m_args, const void*);
+                break;
+        }
+        return value;
+    }
+
+private:
+    va_list m_args;
+};
+
+// arguments of a UTF8::jsonify call, already checked against the key at compile time
+class TypedArgSource
+{
+public:
+    TypedArgSource(const detail::TranslationArg* args, size_t count)
+        : m_args(args)
+        , m_count(count)
+    {
+    }
+
+    int star()
+    {
+        return int(next().i);
+    }
+
+    ArgValue value(ArgKind kind)
+    {
+        ArgValue value;
+        value.u = 0;
+        if (kind == ArgKind::NoArg)
+            return value;
+
+        const detail::TranslationArg& arg = next();
+        switch (kind) {
+            case ArgKind::Double:
+                value.d = double(arg.d);
+                break;
+            case ArgKind::LongDouble:
+                value.ld = arg.d;
+                break;
+            case ArgKind::String:
+                value.p = arg.p;
+                if (arg.type == detail::TranslationArg::Type::String && arg.p != nullptr) {
+                    value.length     = arg.str.size();
+                    value.terminated = arg.terminated;
+                    value.json       = arg.json;
+                }
+                break;
+            case ArgKind::Pointer:
+                value.p = arg.p;
+                break;
+            default:
+                if (arg.type == detail::TranslationArg::Type::Unsigned)
+                    value.u = arg.u;
+                else
+                    value.i = arg.i;
+                break;
+        }
+        return value;
     }
 
-    std::string json_str(json_attempt);
-    free(json_attempt);
+private:
+    const detail::TranslationArg& next()
+    {
+        static const detail::TranslationArg missing;
+        return m_next < m_count ? m_args[m_next++] : missing;
+    }
+
+    const detail::TranslationArg* m_args;
+    size_t                        m_count;
+    size_t                        m_next = 0;
+};
+
+// is str[start..] a single JSON object (braces are counted the same way as JSON::readObject does)
+static bool s_is_json_object(const std::string& str, size_t start)
+{
+    if (start >= str.size() || str[start] != '{')
+        return false;
+    int count = 0;
+    for (size_t i = start; i < str.size(); i++) {
+        if (str[i] == '{') {
+            count++;
+        } else if (str[i] == '}') {
+            if (--count == 0)
+                return i + 1 == str.size();
+        }
+    }
+    return false;
+}
 
-    // drop quotes enclosing inserted variables which are already in JSON format
-    // - one from the previous call, second from this one
+template <typename Source>
+static void s_render(const CompiledTemplate& tmpl, std::string& out, Source& source)
+{
+    out.reserve(tmpl.size_hint);
+    bool unquote = false;
+    for (const auto& piece : tmpl.pieces) {
+        if (unquote) {
+            // closing quote of an embedded JSON object
+            out += ' ';
+            out.append(piece.literal, 1, std::string::npos);
+            unquote = false;
+        } else {
+            out.append(piece.literal);
+        }
+        if (piece.spec.empty())
+            continue;
+
+        int stars[2] = {0, 0};
+        for (uint8_t i = 0; i < piece.stars; i++)
+            stars[i] = source.star();
+
+        size_t   start = out.size();
+        ArgValue value = source.value(piece.kind);
+        if (!s_append_value(out, piece, stars, value)) {
+            out.resize(strlen(out.c_str()));
+            return;
+        }
+        // variables which are already in JSON format (e.g. nested translations) are embedded as objects
+        if (piece.json_slot && (value.json || s_is_json_object(out, start))) {
+            out[start - 1] = ' ';
+            unquote        = true;
+        }
+    }
+}
+
+// render the JSON printf format with vsnprintf, for formats the template compiler does not handle
+static void s_render_legacy(const CompiledTemplate& tmpl, std::string& out, va_list args)
+{
+    va_list args2;
+    va_copy(args2, args);
+    int needed = vsnprintf(nullptr, 0, tmpl.format.c_str(), args2);
+    va_end(args2);
+    if (needed < 0) {
+        log_error("JSON formatting has failed for key '%s'", tmpl.key.c_str());
+        return;
+    }
+    out.resize(size_t(needed) + 1);
+    vsnprintf(&out[0], size_t(needed) + 1, tmpl.format.c_str(), args);
+    out.resize(strlen(out.c_str()));
+}
+
+// drop quotes enclosing inserted variables which are already in JSON format
+// - one from the previous call, second from this one
+// s_render does it while rendering, this is only needed for the output of vsnprintf
+static void s_unquote_json_variables(std::string& json_str)
+{
     size_t insert_start = json_str.find("\"{");
     size_t object_start = insert_start, object_end;
     while (insert_start != std::string::npos) {
@@ -528,10 +1619,67 @@ static std::string s_jsonify_translation_string(const char* key, va_list args)
         insert_start = json_str.find("\"{", insert_start);
         object_start = insert_start;
     }
-    key_replaced.clear();
+}
+
+} // namespace
+
+// renders into json_str, which is expected to be empty
+static void s_jsonify_translation_string(std::string& json_str, const char* key, va_list args)
+{
+    auto tmpl = s_template_cache().get(key);
+    if (tmpl->verbatim) {
+        json_str.assign(tmpl->key);
+        return;
+    }
+
+    if (tmpl->legacy) {
+        s_render_legacy(*tmpl, json_str, args);
+        s_unquote_json_variables(json_str);
+    } else {
+        VaArgSource source(args);
+        s_render(*tmpl, json_str, source);
+    }
+}
+
+static std::string s_jsonify_translation_string(const char* key, va_list args)
+{
+    std::string json_str;
+    s_jsonify_translation_string(json_str, key, args);
+    return json_str;
+}
+
+// Per thread buffer of the C API, which keeps its capacity between calls (up to a limit)
+static std::string& s_scratch()
+{
+    static constexpr size_t     MAX_CAPACITY = 64 * 1024;
+    static thread_local std::string scratch;
+    if (scratch.capacity() > MAX_CAPACITY)
+        std::string().swap(scratch);
+    scratch.clear();
+    return scratch;
+}
+
+namespace detail {
+
+std::string jsonify_translation_args(const char* key, const TranslationArg* args, size_t count)
+{
+    auto tmpl = s_template_cache().get(key);
+    if (tmpl->verbatim)
+        return tmpl->key;
+    if (tmpl->legacy) {
+        // not reachable, UTF8::jsonify rejects such keys at compile time
+        log_error("Translation key '%s' can't be rendered from typed arguments", key);
+        return std::string();
+    }
+
+    std::string    json_str;
+    TypedArgSource source(args, count);
+    s_render(*tmpl, json_str, source);
     return json_str;
 }
 
+} // namespace detail
+
 std::string jsonify_translation_string(const char* key, ...)
 {
     va_list args;
@@ -547,24 +1695,259 @@ std::string vajsonify_translation_string(const char* key, va_list args)
     return jsonified_str;
 }
 
+// GNU gettext .mo file layout
+static constexpr uint32_t MO_MAGIC         = 0x950412de;
+static constexpr uint32_t MO_MAGIC_SWAPPED = 0xde120495;
+static constexpr size_t   MO_HEADER_SIZE   = 28;
+
+// hash function of gettext (hash-string.c), msgfmt uses it to build the hash table
+static uint32_t s_mo_hash(std::string_view str)
+{
+    uint32_t hval = 0;
+    for (char c : str) {
+        hval <<= 4;
+        hval += static_cast<unsigned char>(c);
+        uint32_t g = hval & (uint32_t(0xf) << 28);
+        if (g != 0) {
+            hval ^= g >> 24;
+            hval ^= g;
+        }
+    }
+    return hval;
+}
+
+MessageCatalog::~MessageCatalog()
+{
+    close();
+}
+
+MessageCatalog::MessageCatalog(MessageCatalog&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MessageCatalog& MessageCatalog::operator=(MessageCatalog&& other) noexcept
+{
+    if (this != &other) {
+        close();
+        m_data         = std::exchange(other.m_data, nullptr);
+        m_size         = std::exchange(other.m_size, 0);
+        m_swap         = other.m_swap;
+        m_count        = std::exchange(other.m_count, 0);
+        m_originals    = other.m_originals;
+        m_translations = other.m_translations;
+        m_hashSize     = std::exchange(other.m_hashSize, 0);
+        m_hashTable    = other.m_hashTable;
+    }
+    return *this;
+}
+
+bool MessageCatalog::open(const std::string& path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        log_error("Can't open message catalog %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || size_t(st.st_size) < MO_HEADER_SIZE) {
+        log_error("Message catalog %s is too short", path.c_str());
+        ::close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        log_error("Can't map message catalog %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+    m_data = static_cast<const char*>(data);
+    m_size = size_t(st.st_size);
+
+    uint32_t magic;
+    memcpy(&magic, m_data, sizeof(magic));
+    m_swap = magic == MO_MAGIC_SWAPPED;
+    if (magic != MO_MAGIC && !m_swap) {
+        log_error("%s is not a message catalog", path.c_str());
+        close();
+        return false;
+    }
+    if ((word(4) >> 16) > 1) {
+        log_error("Message catalog %s has unsupported revision %" PRIu32, path.c_str(), word(4));
+        close();
+        return false;
+    }
+    uint32_t count        = word(8);
+    uint32_t originals    = word(12);
+    uint32_t translations = word(16);
+    uint32_t hash_size    = word(20);
+    uint32_t hash_table   = word(24);
+    if (uint64_t(originals) + uint64_t(count) * 8 > m_size || uint64_t(translations) + uint64_t(count) * 8 > m_size ||
+        uint64_t(hash_table) + uint64_t(hash_size) * 4 > m_size) {
+        log_error("Message catalog %s is corrupted", path.c_str());
+        close();
+        return false;
+    }
+    m_count        = count;
+    m_originals    = originals;
+    m_translations = translations;
+    // the hash table is optional, lookups fall back to a binary search on the sorted originals
+    m_hashSize  = hash_size > 2 ? hash_size : 0;
+    m_hashTable = hash_table;
+    return true;
+}
+
+void MessageCatalog::close()
+{
+    if (m_data != nullptr)
+        munmap(const_cast<char*>(m_data), m_size);
+    m_data     = nullptr;
+    m_size     = 0;
+    m_count    = 0;
+    m_hashSize = 0;
+}
+
+bool MessageCatalog::isOpen() const
+{
+    return m_data != nullptr;
+}
+
+size_t MessageCatalog::size() const
+{
+    return m_count;
+}
+
+uint32_t MessageCatalog::word(size_t offset) const
+{
+    uint32_t value;
+    memcpy(&value, m_data + offset, sizeof(value));
+    return m_swap ? __builtin_bswap32(value) : value;
+}
+
+// string of the originals or translations table, empty if out of the file
+std::string_view MessageCatalog::entry(uint32_t table, uint32_t index) const
+{
+    size_t   descriptor = size_t(table) + size_t(index) * 8;
+    uint32_t length     = word(descriptor);
+    uint32_t offset     = word(descriptor + 4);
+    if (uint64_t(offset) + length >= m_size)
+        return std::string_view();
+    return std::string_view(m_data + offset, length);
+}
+
+std::string_view MessageCatalog::lookup(std::string_view msgid) const
+{
+    if (m_data == nullptr)
+        return std::string_view();
+
+    // original may be followed by its plural form ("msgid\0msgid_plural")
+    auto matches = [&msgid](std::string_view original) {
+        return original.size() >= msgid.size() && memcmp(original.data(), msgid.data(), msgid.size()) == 0 &&
+               (original.size() == msgid.size() || original[msgid.size()] == '\0');
+    };
+    auto translation = [this](uint32_t index) {
+        std::string_view str = entry(m_translations, index);
+        return str.substr(0, strnlen(str.data(), str.size()));
+    };
+
+    if (m_hashSize != 0) {
+        uint32_t hash = s_mo_hash(msgid);
+        uint32_t idx  = hash % m_hashSize;
+        uint32_t incr = 1 + (hash % (m_hashSize - 2));
+        for (uint32_t probes = 0; probes < m_hashSize; probes++) {
+            uint32_t nstr = word(size_t(m_hashTable) + size_t(idx) * 4);
+            if (nstr == 0)
+                return std::string_view();
+            nstr--;
+            if (nstr < m_count && matches(entry(m_originals, nstr)))
+                return translation(nstr);
+            idx = (idx >= m_hashSize - incr) ? idx - (m_hashSize - incr) : idx + incr;
+        }
+        return std::string_view();
+    }
+
+    uint32_t bottom = 0;
+    uint32_t top    = m_count;
+    while (bottom < top) {
+        uint32_t         middle   = bottom + (top - bottom) / 2;
+        std::string_view original = entry(m_originals, middle);
+        original                  = original.substr(0, strnlen(original.data(), original.size()));
+        int cmp                   = msgid.compare(original);
+        if (cmp == 0)
+            return translation(middle);
+        if (cmp < 0)
+            top = middle;
+        else
+            bottom = middle + 1;
+    }
+    return std::string_view();
+}
+
+size_t MessageCatalog::render(
+    std::string_view key, const std::string_view* vars, size_t count, char* out, size_t size) const
+{
+    std::string_view text = lookup(key);
+    if (text.empty())
+        text = key;
+
+    size_t length = 0;
+    auto   append = [&](const char* str, size_t len) {
+        if (length < size) {
+            size_t room = std::min(len, size - 1 - length);
+            memcpy(out + length, str, room);
+        }
+        length += len;
+    };
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t open = text.find("{{var", pos);
+        if (open == std::string_view::npos)
+            break;
+        // placeholder is {{varN}}
+        size_t index  = 0;
+        size_t digits = open + 5;
+        while (digits < text.size() && isdigit(static_cast<unsigned char>(text[digits])) && index < count + 1) {
+            index = index * 10 + size_t(text[digits] - '0');
+            digits++;
+        }
+        bool placeholder = digits > open + 5 && text.compare(digits, 2, "}}") == 0 && index >= 1 && index <= count;
+        if (!placeholder) {
+            append(text.data() + pos, open + 5 - pos);
+            pos = open + 5;
+            continue;
+        }
+        append(text.data() + pos, open - pos);
+        append(vars[index - 1].data(), vars[index - 1].size());
+        pos = digits + 2;
+    }
+    append(text.data() + pos, text.size() - pos);
+
+    if (size != 0)
+        out[std::min(length, size - 1)] = '\0';
+    return length;
+}
+
 } // namespace UTF8
 
 char* utf8_escape(const char* string)
 {
-    std::string escaped_str = UTF8::escape(string);
-    size_t      length      = escaped_str.length();
-    char*       escaped     = static_cast<char*>(zmalloc(length + 1));
-    strcpy(escaped, escaped_str.c_str());
+    std::string&     escaped_str = UTF8::s_scratch();
+    UTF8::StringSink sink(escaped_str);
+    UTF8::s_escape(string, string ? strlen(string) : 0, sink);
+    size_t length  = escaped_str.length();
+    char*  escaped = static_cast<char*>(zmalloc(length + 1));
+    memcpy(escaped, escaped_str.data(), length);
     return escaped;
 }
 
 char* utf8_bash_escape(const char* string)
 {
-    std::string string_str(string);
-    std::string escaped_str = UTF8::bash_escape(string_str);
-    size_t      length      = escaped_str.length();
-    char*       escaped     = static_cast<char*>(zmalloc(length + 1));
-    strcpy(escaped, escaped_str.c_str());
+    size_t length  = UTF8::escape_to(UTF8::EscapeContext::Shell, string, nullptr, 0);
+    char*  escaped = static_cast<char*>(zmalloc(length + 1));
+    UTF8::escape_to(UTF8::EscapeContext::Shell, string, escaped, length + 1);
     return escaped;
 }
 
@@ -572,10 +1955,102 @@ char* utf8_jsonify_translation_string(const char* key, ...)
 {
     va_list args;
     va_start(args, key);
-    std::string jsonified_str = UTF8::s_jsonify_translation_string(key, args);
+    std::string& jsonified_str = UTF8::s_scratch();
+    UTF8::s_jsonify_translation_string(jsonified_str, key, args);
     va_end(args);
     size_t length    = jsonified_str.length();
     char*  jsonified = static_cast<char*>(zmalloc(length + 1));
-    strcpy(jsonified, jsonified_str.c_str());
+    memcpy(jsonified, jsonified_str.data(), length);
     return jsonified;
 }
+
+static int s_result(size_t length, size_t size, size_t* needed)
+{
+    if (needed)
+        *needed = length;
+    return length < size ? 0 : -1;
+}
+
+int utf8_escape_n(const char* string, size_t length, char* out, size_t size, size_t* needed)
+{
+    return s_result(UTF8::escape_to(string, length, out, size), size, needed);
+}
+
+int utf8_bash_escape_n(const char* string, size_t length, char* out, size_t size, size_t* needed)
+{
+    return s_result(
+        UTF8::escape_to(UTF8::EscapeContext::Shell, std::string_view(string, length), out, size), size, needed);
+}
+
+int utf8_jsonify_translation_string_n(char* out, size_t size, size_t* needed, const char* key, ...)
+{
+    va_list args;
+    va_start(args, key);
+    int result = utf8_vajsonify_translation_string_n(out, size, needed, key, args);
+    va_end(args);
+    return result;
+}
+
+int utf8_vajsonify_translation_string_n(char* out, size_t size, size_t* needed, const char* key, va_list args)
+{
+    std::string& jsonified_str = UTF8::s_scratch();
+    UTF8::s_jsonify_translation_string(jsonified_str, key, args);
+    UTF8::BufferSink sink(out, size);
+    sink.append(jsonified_str.data(), jsonified_str.size());
+    return s_result(sink.finish(), size, needed);
+}
+
+zframe_t* utf8_escape_frame(const char* string, size_t length)
+{
+    std::string&     escaped = UTF8::s_scratch();
+    UTF8::StringSink sink(escaped);
+    UTF8::s_escape(string, length, sink);
+    return zframe_new(escaped.data(), escaped.size());
+}
+
+zframe_t* utf8_bash_escape_frame(const char* string, size_t length)
+{
+    std::string&     escaped = UTF8::s_scratch();
+    UTF8::StringSink sink(escaped);
+    UTF8::s_escape_for(UTF8::EscapeContext::Shell, std::string_view(string, length), sink);
+    return zframe_new(escaped.data(), escaped.size());
+}
+
+zframe_t* utf8_jsonify_translation_frame(const char* key, ...)
+{
+    va_list args;
+    va_start(args, key);
+    std::string& jsonified_str = UTF8::s_scratch();
+    UTF8::s_jsonify_translation_string(jsonified_str, key, args);
+    va_end(args);
+    return zframe_new(jsonified_str.data(), jsonified_str.size());
+}
+
+static int s_append_frame(zmsg_t* msg, zframe_t* frame)
+{
+    if (!msg || !frame) {
+        zframe_destroy(&frame);
+        return -1;
+    }
+    return zmsg_append(msg, &frame);
+}
+
+int utf8_escape_zmsg(zmsg_t* msg, const char* string, size_t length)
+{
+    return s_append_frame(msg, utf8_escape_frame(string, length));
+}
+
+int utf8_bash_escape_zmsg(zmsg_t* msg, const char* string, size_t length)
+{
+    return s_append_frame(msg, utf8_bash_escape_frame(string, length));
+}
+
+int utf8_jsonify_translation_zmsg(zmsg_t* msg, const char* key, ...)
+{
+    va_list args;
+    va_start(args, key);
+    std::string& jsonified_str = UTF8::s_scratch();
+    UTF8::s_jsonify_translation_string(jsonified_str, key, args);
+    va_end(args);
+    return s_append_frame(msg, zframe_new(jsonified_str.data(), jsonified_str.size()));
+}
@@ -0,0 +1,299 @@
+/*  =========================================================================
+    fty_common_utf8_nfc - Unicode normalization form C of UTF-8 strings
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_common_utf8_nfc - Unicode normalization form C of UTF-8 strings
+@discuss
+    Implements the quick check and the normalization algorithm of UAX #15, see
+    fty_common_utf8_nfc_data.py for the tables.
+@end
+*/
+
+#include "fty_common_utf8.h"
+#include "fty_common_utf8_nfc_data.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace UTF8 {
+
+using namespace nfc;
+
+// Hangul syllables (Unicode 3.12)
+static constexpr uint32_t HANGUL_S_BASE  = 0xAC00;
+static constexpr uint32_t HANGUL_L_BASE  = 0x1100;
+static constexpr uint32_t HANGUL_V_BASE  = 0x1161;
+static constexpr uint32_t HANGUL_T_BASE  = 0x11A7;
+static constexpr uint32_t HANGUL_L_COUNT = 19;
+static constexpr uint32_t HANGUL_V_COUNT = 21;
+static constexpr uint32_t HANGUL_T_COUNT = 28;
+static constexpr uint32_t HANGUL_N_COUNT = HANGUL_V_COUNT * HANGUL_T_COUNT;
+static constexpr uint32_t HANGUL_S_COUNT = HANGUL_L_COUNT * HANGUL_N_COUNT;
+
+static constexpr uint32_t INVALID = 0xFFFFFFFF;
+
+static const Properties& s_properties(uint32_t codepoint)
+{
+    if (codepoint >= TRIE_LIMIT)
+        return PROPERTIES[0];
+    return PROPERTIES[BLOCK_PROPERTIES[BLOCKS[codepoint >> BLOCK_SHIFT]][codepoint & ((1u << BLOCK_SHIFT) - 1)]];
+}
+
+// decodes the code point at str[pos] and advances pos, INVALID on ill-formed UTF-8
+static uint32_t s_decode(std::string_view str, size_t& pos)
+{
+    auto byte = [&](size_t i) {
+        return static_cast<unsigned char>(str[i]);
+    };
+
+    unsigned char lead = byte(pos);
+    if (lead < 0x80) {
+        pos++;
+        return lead;
+    }
+
+    size_t   length;
+    uint32_t codepoint;
+    uint32_t min;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length    = 2;
+        codepoint = lead & 0x1F;
+        min       = 0x80;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length    = 3;
+        codepoint = lead & 0x0F;
+        min       = 0x800;
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length    = 4;
+        codepoint = lead & 0x07;
+        min       = 0x10000;
+    } else {
+        return INVALID;
+    }
+    if (str.size() - pos < length)
+        return INVALID;
+    for (size_t i = 1; i < length; i++) {
+        unsigned char next = byte(pos + i);
+        if ((next & 0xC0) != 0x80)
+            return INVALID;
+        codepoint = (codepoint << 6) | (next & 0x3F);
+    }
+    if (codepoint < min || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+        return INVALID;
+    pos += length;
+    return codepoint;
+}
+
+static void s_encode(uint32_t codepoint, std::string& out)
+{
+    if (codepoint < 0x80) {
+        out += char(codepoint);
+    } else if (codepoint < 0x800) {
+        out += char(0xC0 | (codepoint >> 6));
+        out += char(0x80 | (codepoint & 0x3F));
+    } else if (codepoint < 0x10000) {
+        out += char(0xE0 | (codepoint >> 12));
+        out += char(0x80 | ((codepoint >> 6) & 0x3F));
+        out += char(0x80 | (codepoint & 0x3F));
+    } else {
+        out += char(0xF0 | (codepoint >> 18));
+        out += char(0x80 | ((codepoint >> 12) & 0x3F));
+        out += char(0x80 | ((codepoint >> 6) & 0x3F));
+        out += char(0x80 | (codepoint & 0x3F));
+    }
+}
+
+// appends the full canonical decomposition of codepoint
+static void s_decompose(uint32_t codepoint, std::vector<uint32_t>& out)
+{
+    if (codepoint >= HANGUL_S_BASE && codepoint < HANGUL_S_BASE + HANGUL_S_COUNT) {
+        uint32_t index = codepoint - HANGUL_S_BASE;
+        out.push_back(HANGUL_L_BASE + index / HANGUL_N_COUNT);
+        out.push_back(HANGUL_V_BASE + (index % HANGUL_N_COUNT) / HANGUL_T_COUNT);
+        if (index % HANGUL_T_COUNT != 0)
+            out.push_back(HANGUL_T_BASE + index % HANGUL_T_COUNT);
+        return;
+    }
+
+    auto it = std::lower_bound(std::begin(DECOMPOSITIONS), std::end(DECOMPOSITIONS), codepoint,
+        [](const Decomposition& decomposition, uint32_t value) {
+            return decomposition.codepoint < value;
+        });
+    if (it == std::end(DECOMPOSITIONS) || it->codepoint != codepoint) {
+        out.push_back(codepoint);
+        return;
+    }
+    out.insert(out.end(), DECOMPOSITION_DATA + it->offset, DECOMPOSITION_DATA + it->offset + it->length);
+}
+
+// primary composite of the pair, INVALID if there is none
+static uint32_t s_compose(uint32_t first, uint32_t second)
+{
+    if (first >= HANGUL_L_BASE && first < HANGUL_L_BASE + HANGUL_L_COUNT && second >= HANGUL_V_BASE &&
+        second < HANGUL_V_BASE + HANGUL_V_COUNT) {
+        return HANGUL_S_BASE + ((first - HANGUL_L_BASE) * HANGUL_V_COUNT + second - HANGUL_V_BASE) * HANGUL_T_COUNT;
+    }
+    bool lv_syllable =
+        first >= HANGUL_S_BASE && first < HANGUL_S_BASE + HANGUL_S_COUNT && (first - HANGUL_S_BASE) % HANGUL_T_COUNT == 0;
+    if (lv_syllable && second > HANGUL_T_BASE && second < HANGUL_T_BASE + HANGUL_T_COUNT) {
+        return first + second - HANGUL_T_BASE;
+    }
+
+    uint64_t pair = uint64_t(first) << 32 | second;
+    auto     it   = std::lower_bound(std::begin(COMPOSITIONS), std::end(COMPOSITIONS), pair,
+        [](const Composition& composition, uint64_t value) {
+            return composition.pair < value;
+        });
+    if (it == std::end(COMPOSITIONS) || it->pair != pair)
+        return INVALID;
+    return it->composite;
+}
+
+NfcQuickCheck is_nfc_quick(std::string_view str)
+{
+    NfcQuickCheck result   = NfcQuickCheck::Yes;
+    uint8_t       last_ccc = 0;
+    size_t        pos      = 0;
+    while (pos < str.size()) {
+        // fast path: ASCII, 8 bytes at a time
+        while (str.size() - pos >= 8) {
+            uint64_t block;
+            memcpy(&block, str.data() + pos, 8);
+            if (block & 0x8080808080808080ull)
+                break;
+            pos += 8;
+            last_ccc = 0;
+        }
+        if (pos == str.size())
+            break;
+
+        // fast path: code points below U+0300 (lead bytes up to 0xCB) have ccc 0 and are in NFC
+        unsigned char lead = static_cast<unsigned char>(str[pos]);
+        if (lead < 0x80) {
+            pos++;
+            last_ccc = 0;
+            continue;
+        }
+        if (lead >= 0xC2 && lead <= 0xCB && pos + 1 < str.size() &&
+            (static_cast<unsigned char>(str[pos + 1]) & 0xC0) == 0x80) {
+            pos += 2;
+            last_ccc = 0;
+            continue;
+        }
+
+        uint32_t codepoint = s_decode(str, pos);
+        if (codepoint == INVALID)
+            return NfcQuickCheck::No;
+        const Properties& properties = s_properties(codepoint);
+        if (properties.ccc != 0 && last_ccc > properties.ccc)
+            return NfcQuickCheck::No;
+        if (properties.qc == QC_NO)
+            return NfcQuickCheck::No;
+        if (properties.qc == QC_MAYBE)
+            result = NfcQuickCheck::Maybe;
+        last_ccc = properties.ccc;
+    }
+    return result;
+}
+
+bool to_nfc(std::string_view str, std::string& out)
+{
+    switch (is_nfc_quick(str)) {
+        case NfcQuickCheck::Yes:
+            out.assign(str.data(), str.size());
+            return true;
+        case NfcQuickCheck::No:
+        case NfcQuickCheck::Maybe:
+            break;
+    }
+
+    // full canonical decomposition
+    std::vector<uint32_t> buffer;
+    buffer.reserve(str.size() + str.size() / 2);
+    size_t pos = 0;
+    while (pos < str.size()) {
+        uint32_t codepoint = s_decode(str, pos);
+        if (codepoint == INVALID)
+            return false;
+        s_decompose(codepoint, buffer);
+    }
+
+    // canonical ordering: stable sort of each run of non-starters by combining class
+    for (size_t i = 0; i < buffer.size();) {
+        if (s_properties(buffer[i]).ccc == 0) {
+            i++;
+            continue;
+        }
+        size_t end = i;
+        while (end < buffer.size() && s_properties(buffer[end]).ccc != 0)
+            end++;
+        std::stable_sort(buffer.begin() + long(i), buffer.begin() + long(end), [](uint32_t a, uint32_t b) {
+            return s_properties(a).ccc < s_properties(b).ccc;
+        });
+        i = end;
+    }
+
+    // canonical composition, in place
+    size_t  starter  = std::string::npos;
+    uint8_t last_ccc = 0;
+    size_t  length   = 0;
+    for (uint32_t codepoint : buffer) {
+        uint8_t ccc = s_properties(codepoint).ccc;
+        if (starter != std::string::npos) {
+            // blocked by a character in between with ccc 0 or ccc >= ccc of this one
+            bool blocked = length - 1 != starter && (last_ccc == 0 || last_ccc >= ccc);
+            if (!blocked) {
+                uint32_t composite = s_compose(buffer[starter], codepoint);
+                if (composite != INVALID) {
+                    buffer[starter] = composite;
+                    continue;
+                }
+            }
+        }
+        if (ccc == 0)
+            starter = length;
+        last_ccc         = ccc;
+        buffer[length++] = codepoint;
+    }
+
+    out.clear();
+    out.reserve(str.size());
+    for (size_t i = 0; i < length; i++)
+        s_encode(buffer[i], out);
+    return true;
+}
+
+bool is_nfc(std::string_view str)
+{
+    switch (is_nfc_quick(str)) {
+        case NfcQuickCheck::Yes:
+            return true;
+        case NfcQuickCheck::No:
+            return false;
+        case NfcQuickCheck::Maybe:
+            break;
+    }
+    std::string normalized;
+    return to_nfc(str, normalized) && normalized == str;
+}
+
+} // namespace UTF8
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+#
+# Generates fty_common_utf8_nfc_data.h, the Unicode tables used by UTF8::is_nfc_quick and UTF8::to_nfc, from the
+# Unicode database of the running Python interpreter:
+#
+#     python3 src/fty_common_utf8_nfc_data.py > src/fty_common_utf8_nfc_data.h
+#
+# Hangul syllables are composed and decomposed algorithmically and are left out of the tables.
+
+import sys
+import unicodedata
+
+TRIE_LIMIT = 0x30000
+BLOCK_SHIFT = 7
+BLOCK_SIZE = 1 << BLOCK_SHIFT
+
+QC_YES, QC_MAYBE, QC_NO = 0, 1, 2
+
+
+def is_hangul_syllable(cp):
+    return 0xAC00 <= cp <= 0xD7A3
+
+
+def canonical_mapping(cp):
+    decomposition = unicodedata.decomposition(chr(cp))
+    if not decomposition or decomposition.startswith("<"):
+        return None
+    return [int(part, 16) for part in decomposition.split()]
+
+
+decompositions = {}
+compositions = {}
+quick_check = {}
+
+for cp in range(0x110000):
+    if 0xD800 <= cp <= 0xDFFF or is_hangul_syllable(cp):
+        continue
+    char = chr(cp)
+    if unicodedata.normalize("NFC", char) != char:
+        quick_check[cp] = QC_NO
+    mapping = canonical_mapping(cp)
+    if mapping is None:
+        continue
+    decompositions[cp] = [ord(c) for c in unicodedata.normalize("NFD", char)]
+    if len(mapping) == 2 and quick_check.get(cp) != QC_NO:
+        compositions[(mapping[0], mapping[1])] = cp
+
+for first, second in compositions:
+    quick_check.setdefault(second, QC_MAYBE)
+# Hangul vowels and trailing consonants compose with the preceding jamo
+for cp in list(range(0x1161, 0x1176)) + list(range(0x11A8, 0x11C3)):
+    quick_check.setdefault(cp, QC_MAYBE)
+
+assert all(cp < TRIE_LIMIT for cp in quick_check)
+assert all(unicodedata.combining(chr(cp)) == 0 for cp in range(TRIE_LIMIT, 0x110000) if not 0xD800 <= cp <= 0xDFFF)
+
+properties = [(0, QC_YES)]
+blocks = []
+block_index = {}
+stage1 = []
+for start in range(0, TRIE_LIMIT, BLOCK_SIZE):
+    block = []
+    for cp in range(start, start + BLOCK_SIZE):
+        value = (0, QC_YES) if 0xD800 <= cp <= 0xDFFF else (unicodedata.combining(chr(cp)), quick_check.get(cp, QC_YES))
+        if value not in properties:
+            properties.append(value)
+        block.append(properties.index(value))
+    block = tuple(block)
+    if block not in block_index:
+        block_index[block] = len(blocks)
+        blocks.append(block)
+    stage1.append(block_index[block])
+
+assert len(properties) < 256 and len(blocks) < 256
+# the fast path of is_nfc_quick relies on it
+assert all(stage1[cp >> BLOCK_SHIFT] == 0 for cp in range(0, 0x300, BLOCK_SIZE))
+
+
+def rows(values, per_line, width=0):
+    values = [str(v).rjust(width) for v in values]
+    for i in range(0, len(values), per_line):
+        yield "    " + ", ".join(values[i:i + per_line]) + ","
+
+
+out = []
+out.append("// Generated by fty_common_utf8_nfc_data.py from the Unicode %s database, do not edit"
+           % unicodedata.unidata_version)
+out.append("")
+out.append("#pragma once")
+out.append("")
+out.append("#include <cstdint>")
+out.append("")
+out.append("namespace UTF8::nfc {")
+out.append("")
+out.append("constexpr const char* UNICODE_VERSION = \"%s\";" % unicodedata.unidata_version)
+out.append("")
+out.append("// NFC_Quick_Check values")
+out.append("constexpr uint8_t QC_YES   = %d;" % QC_YES)
+out.append("constexpr uint8_t QC_MAYBE = %d;" % QC_MAYBE)
+out.append("constexpr uint8_t QC_NO    = %d;" % QC_NO)
+out.append("")
+out.append("struct Properties")
+out.append("{")
+out.append("    uint8_t ccc; // Canonical_Combining_Class")
+out.append("    uint8_t qc;  // NFC_Quick_Check")
+out.append("};")
+out.append("")
+out.append("// two-stage lookup of code points below TRIE_LIMIT, all others have default properties")
+out.append("constexpr uint32_t TRIE_LIMIT  = 0x%X;" % TRIE_LIMIT)
+out.append("constexpr unsigned BLOCK_SHIFT = %d;" % BLOCK_SHIFT)
+out.append("")
+out.append("constexpr Properties PROPERTIES[] = {")
+out.extend(rows(["{%d, %d}" % p for p in properties], 8))
+out.append("};")
+out.append("")
+out.append("constexpr uint8_t BLOCKS[] = {")
+out.extend(rows(stage1, 16, 3))
+out.append("};")
+out.append("")
+out.append("constexpr uint8_t BLOCK_PROPERTIES[][%d] = {" % BLOCK_SIZE)
+for block in blocks:
+    out.append("    {")
+    out.extend("    " + row for row in rows(block, 16, 3))
+    out.append("    },")
+out.append("};")
+out.append("")
+out.append("// full canonical decompositions, sorted by code point")
+out.append("struct Decomposition")
+out.append("{")
+out.append("    uint32_t codepoint;")
+out.append("    uint16_t offset; // in DECOMPOSITION_DATA")
+out.append("    uint16_t length;")
+out.append("};")
+out.append("")
+data = []
+entries = []
+for cp in sorted(decompositions):
+    entries.append("{0x%04X, %d, %d}" % (cp, len(data), len(decompositions[cp])))
+    data.extend(decompositions[cp])
+assert len(data) < 0x10000
+out.append("constexpr Decomposition DECOMPOSITIONS[] = {")
+out.extend(rows(entries, 6))
+out.append("};")
+out.append("")
+out.append("constexpr uint32_t DECOMPOSITION_DATA[] = {")
+out.extend(rows(["0x%04X" % cp for cp in data], 10))
+out.append("};")
+out.append("")
+out.append("// primary composites, sorted by pair = first << 32 | second")
+out.append("struct Composition")
+out.append("{")
+out.append("    uint64_t pair;")
+out.append("    uint32_t composite;")
+out.append("};")
+out.append("")
+out.append("constexpr Composition COMPOSITIONS[] = {")
+out.extend(rows(["{0x%04X%08X, 0x%04X}" % (first, second, composite)
+                 for (first, second), composite in sorted(compositions.items())], 4))
+out.append("};")
+out.append("")
+out.append("} // namespace UTF8::nfc")
+
+sys.stdout.write("\n".join(out) + "\n")
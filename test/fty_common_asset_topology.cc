@@ -0,0 +1,233 @@
+/*  =========================================================================
+    fty_common_asset_topology - Containment tree of the assets
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "fty_common_asset_topology.h"
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <random>
+
+using persist::AssetTopology;
+
+// datacenters > rooms > rows > racks > devices, every fourth device is an UPS
+static void s_build(AssetTopology& topology, size_t datacenters, size_t fanout, size_t devices)
+{
+    for (size_t dc = 0; dc < datacenters; dc++) {
+        std::string dc_name = "datacenter-" + std::to_string(dc);
+        topology.apply(persist::INSERT, dc_name, "", persist::DATACENTER, persist::N_A);
+        for (size_t room = 0; room < fanout; room++) {
+            std::string room_name = dc_name + "-room-" + std::to_string(room);
+            topology.apply(persist::INSERT, room_name, dc_name, persist::ROOM, persist::N_A);
+            for (size_t row = 0; row < fanout; row++) {
+                std::string row_name = room_name + "-row-" + std::to_string(row);
+                topology.apply(persist::INSERT, row_name, room_name, persist::ROW, persist::N_A);
+                for (size_t rack = 0; rack < fanout; rack++) {
+                    std::string rack_name = row_name + "-rack-" + std::to_string(rack);
+                    topology.apply(persist::INSERT, rack_name, row_name, persist::RACK, persist::N_A);
+                    for (size_t device = 0; device < devices; device++) {
+                        topology.apply(persist::INSERT, rack_name + "-device-" + std::to_string(device), rack_name,
+                            persist::DEVICE, device % 4 ? persist::SERVER : persist::UPS);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// the answers of the numbering and of the links must be the same
+static bool s_consistent(AssetTopology& topology, const std::vector<uint32_t>& nodes)
+{
+    std::vector<std::vector<uint32_t>> descendants[2];
+    std::vector<bool>                  ancestors[2];
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1)
+            topology.reindex();
+        for (uint32_t a : nodes) {
+            descendants[pass].push_back(topology.descendants(a));
+            std::sort(descendants[pass].back().begin(), descendants[pass].back().end());
+            for (uint32_t b : nodes)
+                ancestors[pass].push_back(topology.isAncestor(a, b));
+        }
+    }
+    return descendants[0] == descendants[1] && ancestors[0] == ancestors[1];
+}
+
+TEST_CASE("asset topology")
+{
+    AssetTopology topology;
+    s_build(topology, 2, 2, 4);
+    CHECK(topology.size() == 2 + 4 + 8 + 16 + 64);
+    CHECK(!topology.indexed());
+
+    for (bool indexed : {false, true}) {
+        if (indexed)
+            topology.reindex();
+        CHECK(topology.indexed() == indexed);
+
+        uint32_t dc     = topology.find("datacenter-1");
+        uint32_t room   = topology.find("datacenter-1-room-0");
+        uint32_t rack   = topology.find("datacenter-1-room-0-row-1-rack-0");
+        uint32_t device = topology.find("datacenter-1-room-0-row-1-rack-0-device-3");
+        REQUIRE(device != AssetTopology::npos);
+        CHECK(topology.name(rack) == "datacenter-1-room-0-row-1-rack-0");
+        CHECK(topology.type(rack) == persist::RACK);
+        CHECK(topology.subtype(device) == persist::SERVER);
+        CHECK(topology.parent(dc) == AssetTopology::npos);
+        CHECK(topology.isAncestor(dc, device));
+        CHECK(topology.isAncestor(room, rack));
+        CHECK(!topology.isAncestor(rack, room));
+        CHECK(!topology.isAncestor(rack, rack));
+        CHECK(!topology.isAncestor(topology.find("datacenter-0"), device));
+        CHECK(topology.ancestorOfType(device, persist::DATACENTER) == dc);
+        CHECK(topology.ancestorOfType(device, persist::ROW) == topology.parent(rack));
+        CHECK(topology.ancestorOfType(dc, persist::DATACENTER) == AssetTopology::npos);
+        CHECK(topology.descendants(dc).size() == 2 + 4 + 8 + 32);
+        CHECK(topology.descendants(room, persist::UPS).size() == 4);
+        CHECK(topology.descendants(device).empty());
+        for (uint32_t ups : topology.descendants(dc, persist::UPS))
+            CHECK(topology.isAncestor(dc, ups));
+    }
+
+    // move a rack to another datacenter
+    uint32_t rack = topology.find("datacenter-1-room-0-row-1-rack-0");
+    CHECK(topology.apply(persist::UPDATE, "datacenter-1-room-0-row-1-rack-0", "datacenter-0-room-1-row-0",
+        persist::RACK, persist::N_A));
+    CHECK(!topology.indexed());
+    CHECK(topology.find("datacenter-1-room-0-row-1-rack-0") == rack);
+    CHECK(topology.ancestorOfType(rack, persist::DATACENTER) == topology.find("datacenter-0"));
+    CHECK(topology.descendants(topology.find("datacenter-1"), persist::UPS).size() == 7);
+    CHECK(topology.descendants(topology.find("datacenter-0"), persist::UPS).size() == 9);
+
+    // no cycle
+    CHECK(!topology.apply(persist::UPDATE, "datacenter-0", "datacenter-0-room-1-row-0-rack-1", persist::DATACENTER,
+        persist::N_A));
+    CHECK(!topology.apply(persist::UPDATE, "datacenter-0", "datacenter-0", persist::DATACENTER, persist::N_A));
+    CHECK(topology.parent(topology.find("datacenter-0")) == AssetTopology::npos);
+
+    // the children of a removed asset lose their parent, its index is reused
+    uint32_t row = topology.find("datacenter-0-room-1-row-0");
+    CHECK(topology.apply(persist::RETIRE, "datacenter-0-room-1-row-0"));
+    CHECK(topology.find("datacenter-0-room-1-row-0") == AssetTopology::npos);
+    CHECK(topology.parent(rack) == AssetTopology::npos);
+    CHECK(!topology.apply(persist::DELETE, "datacenter-0-room-1-row-0"));
+    CHECK(topology.apply(persist::INSERT, "datacenter-2", "", persist::DATACENTER, persist::N_A));
+    CHECK(topology.find("datacenter-2") == row);
+    CHECK(topology.apply(persist::GET, "datacenter-2"));
+    CHECK(topology.apply(persist::INVENTORY, "whatever"));
+
+    // a parent may come after its children
+    CHECK(topology.apply(persist::INSERT, "rack-new", "row-new", persist::RACK, persist::N_A));
+    uint32_t new_row = topology.find("row-new");
+    REQUIRE(new_row != AssetTopology::npos);
+    CHECK(topology.type(new_row) == persist::TUNKNOWN);
+    CHECK(topology.apply(persist::INSERT, "row-new", "datacenter-2-room-0", persist::ROW, persist::N_A));
+    CHECK(topology.find("row-new") == new_row);
+    CHECK(topology.type(new_row) == persist::ROW);
+    topology.reindex();
+    CHECK(topology.isAncestor(topology.find("datacenter-2-room-0"), topology.find("rack-new")));
+
+    CHECK(topology.apply(persist::INSERT, "", "") == false);
+
+    SECTION("random changes")
+    {
+        std::mt19937 random(41);
+        for (int round = 0; round < 20; round++) {
+            for (int change = 0; change < 20; change++) {
+                std::string name   = "asset-" + std::to_string(random() % 60);
+                std::string parent = random() % 4 ? "asset-" + std::to_string(random() % 60) : "";
+                topology.apply(random() % 5 ? persist::UPDATE : persist::DELETE, name, parent, persist::DEVICE,
+                    persist::UPS);
+            }
+            std::vector<uint32_t> nodes;
+            for (int i = 0; i < 60; i++) {
+                uint32_t node = topology.find("asset-" + std::to_string(i));
+                if (node != AssetTopology::npos)
+                    nodes.push_back(node);
+            }
+            nodes.push_back(topology.find("datacenter-1"));
+            CHECK(s_consistent(topology, nodes));
+        }
+    }
+}
+
+TEST_CASE("asset topology benchmark", "[.][benchmark]")
+{
+    // 10 datacenters > 10 rooms > 10 rows > 10 racks > 99 devices: 1001110 assets
+    AssetTopology topology;
+    s_build(topology, 10, 10, 99);
+    REQUIRE(topology.size() == 1001110);
+
+    std::mt19937          random(41);
+    std::vector<uint32_t> devices;
+    for (int i = 0; i < 1000000; i++)
+        devices.push_back(uint32_t(random() % topology.size()));
+    uint32_t room = topology.find("datacenter-3-room-7");
+
+    BENCHMARK("reindex, 1M assets")
+    {
+        topology.reindex();
+        return topology.indexed();
+    };
+
+    BENCHMARK("isAncestor, 1M queries")
+    {
+        size_t count = 0;
+        for (uint32_t device : devices)
+            count += topology.isAncestor(room, device);
+        return count;
+    };
+
+    BENCHMARK("ancestorOfType datacenter, 1M queries")
+    {
+        size_t sum = 0;
+        for (uint32_t device : devices)
+            sum += topology.ancestorOfType(device, persist::DATACENTER);
+        return sum;
+    };
+
+    BENCHMARK("UPSes of a room")
+    {
+        return topology.descendants(room, persist::UPS);
+    };
+
+    BENCHMARK("move a rack and reindex")
+    {
+        topology.apply(persist::UPDATE, "datacenter-0-room-0-row-0-rack-0",
+            random() % 2 ? "datacenter-9-room-9-row-9" : "datacenter-0-room-0-row-0", persist::RACK, persist::N_A);
+        topology.reindex();
+        return topology.indexed();
+    };
+
+    BENCHMARK("move a rack, then UPSes of a room without reindex")
+    {
+        topology.apply(persist::UPDATE, "datacenter-3-room-7-row-0-rack-0",
+            random() % 2 ? "datacenter-9-room-9-row-9" : "datacenter-3-room-7-row-0", persist::RACK, persist::N_A);
+        return topology.descendants(room, persist::UPS);
+    };
+
+    BENCHMARK("isAncestor, 1M queries without reindex")
+    {
+        size_t count = 0;
+        for (uint32_t device : devices)
+            count += topology.isAncestor(room, device);
+        return count;
+    };
+}
@@ -19,9 +19,18 @@
     =========================================================================
 */
 
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
 #include "fty_common_base.h"
+#include "fty_common_asset_registry.h"
 #include "fty_common_asset_types.h"
+#include "fty_common_str_defs.h"
+#include "fty_common_utf8.h"
+#include <atomic>
 #include <catch2/catch.hpp>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <unistd.h>
 
 TEST_CASE("Base")
 {
@@ -146,6 +155,503 @@ TEST_CASE("Base")
         CHECK(success);
     }
 
+    printf("test: string_view lookups\n");
+    {
+        CHECK(persist::type_to_typeid(std::string_view("Rack")) == persist::asset_type::RACK);
+        CHECK(persist::type_to_typeid(std::string_view("racks")) == persist::asset_type::TUNKNOWN);
+        CHECK(persist::type_to_typeid("HOST-GROUP") == persist::asset_type::HOST_GROUP);
+        CHECK(persist::subtype_to_subtypeid(std::string_view("Rack Controller")) ==
+              persist::asset_subtype::RACKCONTROLLER);
+        CHECK(persist::subtype_to_subtypeid("PatchPanel") == persist::asset_subtype::PATCHPANEL);
+        CHECK(persist::subtype_to_subtypeid("VM") == persist::asset_subtype::VIRTUAL);
+        // N_A is case-sensitive
+        CHECK(persist::subtype_to_subtypeid(std::string_view("N_A")) == persist::asset_subtype::N_A);
+        CHECK(persist::subtype_to_subtypeid(std::string_view("n_a")) == persist::asset_subtype::SUNKNOWN);
+        CHECK(persist::subtype_to_subtypeid(std::string_view()) == persist::asset_subtype::N_A);
+        // substring of a longer buffer
+        std::string_view buffer = "ups,epdu";
+        CHECK(persist::subtype_to_subtypeid(buffer.substr(0, 3)) == persist::asset_subtype::UPS);
+        CHECK(persist::subtype_to_subtypeid(buffer.substr(4)) == persist::asset_subtype::EPDU);
+
+        // every name maps back to its id, whatever the case
+        for (uint16_t id = 1; id < persist::asset_subtype::NB_ASSET_SUBTYPES; id++) {
+            std::string name = persist::subtypeid_to_subtype(id);
+            if (name == fty::SUB_UNKNOWN)
+                continue;
+            CHECK(persist::subtype_to_subtypeid(std::string_view(name)) == id);
+            if (name != fty::SUB_N_A) {
+                std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+                CHECK(persist::subtype_to_subtypeid(std::string_view(name)) == id);
+            }
+        }
+    }
+
+    printf("test: string_view names\n");
+    {
+        static_assert(persist::typeid_to_type_view(persist::asset_type::RACK) == fty::TYPE_RACK);
+        static_assert(persist::subtypeid_to_subtype_view(persist::asset_subtype::VIRTUAL) == fty::SUB_VM);
+
+        CHECK(persist::typeid_to_type_view(14) == fty::TYPE_UNKNOWN);
+        CHECK(persist::typeid_to_type_view(persist::asset_type::NB_ASSET_TYPES) == fty::TYPE_UNKNOWN);
+        CHECK(persist::typeid_to_type_view(65535) == fty::TYPE_UNKNOWN);
+        CHECK(persist::subtypeid_to_subtype_view(persist::asset_subtype::N_A) == "N_A");
+        CHECK(persist::subtypeid_to_subtype_view(30) == fty::SUB_UNKNOWN);
+        CHECK(persist::subtypeid_to_subtype_view(1000) == fty::SUB_UNKNOWN);
+        for (uint16_t id = 0; id < 256; id++) {
+            CHECK(persist::typeid_to_type(id) == persist::typeid_to_type_view(id));
+            CHECK(persist::subtypeid_to_subtype(id) == persist::subtypeid_to_subtype_view(id));
+        }
+    }
+
+    {
+        std::string normalized = "previous";
+        CHECK(persist::is_ok_name("Rack A", &normalized));
+        CHECK(normalized.empty());
+        // "Salle \u00e9tage" typed decomposed
+        CHECK(persist::is_ok_name("Salle e\xcc\x81tage", &normalized));
+        CHECK(normalized == "Salle \xc3\xa9tage");
+        CHECK(persist::is_ok_name("Salle e\xcc\x81tage", nullptr));
+        CHECK(!persist::is_ok_name("bad_name", &normalized));
+        CHECK(!persist::is_ok_name("invalid \xff", &normalized));
+        CHECK(persist::is_ok_name("invalid \xff"));
+    }
+
+    printf("test: id classification\n");
+    {
+        static_assert(persist::is_container(persist::asset_type::ROW));
+        static_assert(!persist::is_container(persist::asset_type::DEVICE));
+        static_assert(persist::is_power_device(persist::asset_subtype::UPS));
+
+        CHECK(persist::is_container(persist::asset_type::DATACENTER));
+        CHECK(!persist::is_container(uint16_t(1000)));
+        CHECK(persist::is_container("rack"));
+        CHECK(!persist::is_container("Rack"));
+        CHECK(!persist::is_container("device"));
+        CHECK(persist::is_power_device(persist::asset_subtype::EPDU));
+        CHECK(persist::is_power_device(persist::asset_subtype::PCU));
+        CHECK(!persist::is_power_device(persist::asset_subtype::SERVER));
+        CHECK(persist::is_virtualization(persist::asset_subtype::VMWARE_ESXI));
+        CHECK(persist::is_connector(persist::asset_subtype::DELL_VXRAIL_CONNECTOR));
+        CHECK(persist::is_sensor(persist::asset_subtype::SENSORGPIO));
+        CHECK(persist::is_actuator(persist::asset_subtype::GPO));
+        CHECK(persist::type_properties(persist::asset_type::COPS) == persist::PROP_POWER);
+        CHECK(persist::subtype_properties(1000) == persist::PROP_NONE);
+
+        // the legacy single id helpers agree
+        for (uint16_t id = 0; id < persist::asset_type::NB_ASSET_TYPES; id++) {
+            CHECK(persist::is_container(id) == persist::is_container(persist::typeid_to_type(id)));
+            if (persist::is_rack(id) || persist::is_dc(id))
+                CHECK(persist::is_container(id));
+        }
+        for (uint16_t id = 0; id < persist::asset_subtype::NB_ASSET_SUBTYPES; id++) {
+            if (persist::is_ups(id) || persist::is_epdu(id) || persist::is_pdu(id))
+                CHECK(persist::is_power_device(id));
+        }
+    }
+
+    printf("test: validate_columns\n");
+    {
+        std::vector<std::string_view> names   = {"Rack A", "", "bad_name", "r\xc3\xa9seau", "bad\xc3", "a@b"};
+        std::string                   long_keytag(41, 'k');
+        std::vector<std::string_view> keytags = {"location", "x", std::string_view(), "k", "k", long_keytag};
+        std::vector<std::string_view> values  = {"v", "v", "v", "", "\xed\xa0\x80", "v"};
+        persist::AssetColumns columns;
+        columns.names   = names.data();
+        columns.keytags = keytags.data();
+        columns.values  = values.data();
+        columns.rows    = names.size();
+        auto errors     = persist::validate_columns(columns);
+        REQUIRE(errors.size() == 6);
+        CHECK(errors[0] == persist::ROW_OK);
+        CHECK(errors[1] == persist::ROW_BAD_NAME);
+        CHECK(errors[2] == (persist::ROW_BAD_NAME | persist::ROW_BAD_KEYTAG));
+        CHECK(errors[3] == persist::ROW_BAD_VALUE);
+        CHECK(errors[4] == persist::ROW_BAD_UTF8);
+        CHECK(errors[5] == (persist::ROW_BAD_NAME | persist::ROW_BAD_KEYTAG));
+
+        columns.keytags = nullptr;
+        columns.values  = nullptr;
+        CHECK(persist::validate_columns(columns)[2] == persist::ROW_BAD_NAME);
+
+        // same results as the single cell checks, whatever the number of threads
+        std::mt19937             random(39);
+        const std::string        alphabet[] = {"a", "Z", " ", "_", "%", "@", "\xc3\xa9", "\xe2\x82\xac",
+            "\xf0\x9f\x94\x8c", "\xc3", "\x80", "\xc0\xaf", "\xf4\x90\x80\x80"};
+        std::vector<std::string> cells;
+        for (int i = 0; i < 3 * 40000; i++) {
+            std::string cell;
+            size_t      length = random() % 4 == 0 ? random() % 300 : random() % 24;
+            while (cell.size() < length)
+                cell += random() % 8 ? alphabet[random() % 3] : alphabet[random() % std::size(alphabet)];
+            cells.push_back(cell);
+        }
+        std::vector<std::string_view> views(cells.begin(), cells.end());
+        columns.names   = views.data();
+        columns.keytags = views.data() + 40000;
+        columns.values  = views.data() + 80000;
+        columns.rows    = 40000;
+        auto single     = persist::validate_columns(columns, 1);
+        CHECK(persist::validate_columns(columns, 4) == single);
+        bool same = true;
+        for (size_t row = 0; row < columns.rows; row++) {
+            std::string normalized;
+            uint8_t     expected = persist::ROW_OK;
+            if (!persist::is_ok_name(cells[row].c_str()))
+                expected |= persist::ROW_BAD_NAME;
+            if (!persist::is_ok_keytag(cells[40000 + row].c_str()))
+                expected |= persist::ROW_BAD_KEYTAG;
+            if (!persist::is_ok_value(cells[80000 + row].c_str()))
+                expected |= persist::ROW_BAD_VALUE;
+            for (size_t column = 0; column < 3; column++)
+                if (!UTF8::to_nfc(cells[column * 40000 + row], normalized))
+                    expected |= persist::ROW_BAD_UTF8;
+            same &= single[row] == expected;
+        }
+        CHECK(same);
+    }
+
+    printf("test: enum codecs\n");
+    {
+        using OperationCodec = fty::EnumCodec<persist::asset_operation>;
+        static_assert(OperationCodec::parse("Create") == persist::asset_operation::INSERT);
+        static_assert(OperationCodec::format(persist::asset_operation::INSERT) == "create");
+
+        CHECK(persist::operation2str(persist::asset_operation::RETIRE) == "retire");
+        CHECK(persist::operation2str(persist::asset_operation(0)) == "unknown");
+        CHECK(persist::str2operation("DELETE") == persist::asset_operation::DELETE);
+        CHECK(persist::str2operation("insert") == persist::asset_operation::INVENTORY);
+        CHECK(persist::str2operation("") == persist::asset_operation::INVENTORY);
+        for (int operation = persist::asset_operation::INSERT; operation <= persist::asset_operation::INVENTORY;
+             operation++) {
+            auto value = persist::asset_operation(operation);
+            CHECK(persist::str2operation(persist::operation2str(value)) == value);
+        }
+
+        using StepCodec = fty::EnumCodec<fty::AvgStep>;
+        using TypeCodec = fty::EnumCodec<fty::AvgType>;
+        for (size_t i = 0; i < AVG_STEPS_SIZE; i++) {
+            fty::AvgStep step = fty::AvgStep::Min15;
+            CHECK(StepCodec::parse(AVG_STEPS[i], step));
+            CHECK(StepCodec::format(step) == AVG_STEPS[i]);
+        }
+        for (size_t i = 0; i < AVG_TYPES_SIZE; i++) {
+            fty::AvgType type = fty::AvgType::Min;
+            CHECK(TypeCodec::parse(AVG_TYPES[i], type));
+            CHECK(TypeCodec::format(type) == AVG_TYPES[i]);
+        }
+        fty::AvgStep step = fty::AvgStep::Day7;
+        CHECK(!StepCodec::parse("2h", step));
+        CHECK(step == fty::AvgStep::Day7);
+        CHECK(StepCodec::parse("24H") == fty::AvgStep::Hour24);
+        CHECK(TypeCodec::parse("Arithmetic_Mean") == fty::AvgType::ArithmeticMean);
+        CHECK(TypeCodec::format(fty::AvgType(42)).empty());
+    }
+
     //  @end
     printf(" * fty_commons: OK\n");
 }
+
+// writes content in a temporary file, returns its path
+static std::string s_temporary_file(const std::string& content)
+{
+    char path[] = "/tmp/fty-common-registry-XXXXXX";
+    int  fd     = mkstemp(path);
+    REQUIRE(fd != -1);
+    close(fd);
+    std::ofstream(path) << content;
+    return path;
+}
+
+TEST_CASE("Asset registry")
+{
+    SECTION("add")
+    {
+        persist::AssetRegistry registry;
+        CHECK(registry.addedTypes() == 0);
+        CHECK(registry.typeId("zone") == persist::TUNKNOWN);
+        CHECK(registry.typeName(300) == fty::TYPE_UNKNOWN);
+
+        CHECK(registry.add({{300, "Zone", persist::PROP_CONTAINER}}, {{400, "heat-pump", persist::PROP_POWER}}));
+        CHECK(registry.typeId("zone") == 300);
+        CHECK(registry.typeId("ZONE") == 300);
+        CHECK(registry.typeName(300) == "zone");
+        CHECK(registry.typeProperties(300) == persist::PROP_CONTAINER);
+        CHECK(registry.subtypeId("Heat-Pump") == 400);
+        CHECK(registry.subtypeName(400) == "heat-pump");
+        CHECK(registry.subtypeProperties(400) == persist::PROP_POWER);
+        CHECK(registry.subtypeName(401) == fty::SUB_UNKNOWN);
+
+        // built-in ones are still there
+        CHECK(registry.typeId("rack") == persist::RACK);
+        CHECK(registry.subtypeId("N_A") == persist::N_A);
+        CHECK(registry.typeName(persist::RACK) == "rack");
+        CHECK(registry.typeProperties(persist::RACK) == persist::PROP_CONTAINER);
+
+        // the same entry again is fine, clashes are rejected with nothing added
+        CHECK(registry.add({{300, "zone", persist::PROP_CONTAINER}}, {}));
+        CHECK(!registry.add({{301, "wing"}, {302, "zone"}}, {}));
+        CHECK(!registry.add({{301, "wing"}}, {{400, "chiller"}}));
+        CHECK(registry.typeId("wing") == persist::TUNKNOWN);
+        CHECK(!registry.add({{301, "Rack"}}, {}));
+        CHECK(!registry.add({}, {{401, "n_a"}}));
+        CHECK(!registry.add({{persist::asset_type::NB_ASSET_TYPES - 1, "wing"}}, {}));
+        CHECK(!registry.add({{0xFFFF, "wing"}}, {}));
+        CHECK(!registry.add({{301, ""}}, {}));
+        CHECK(registry.addedTypes() == 1);
+        CHECK(registry.addedSubtypes() == 1);
+
+        CHECK(registry.add({{301, "wing"}, {302, "floor"}}, {}));
+        CHECK(registry.addedTypes() == 3);
+        CHECK(registry.typeId("floor") == 302);
+        CHECK(registry.typeId("zone") == 300);
+        CHECK(registry.typeId("flo") == persist::TUNKNOWN);
+
+        // the ids in the gaps of the built-in lists are free, but unknown's
+        CHECK(registry.add({{14, "building"}}, {{30, "chiller", persist::PROP_POWER}}));
+        CHECK(registry.typeName(14) == "building");
+        CHECK(registry.typeId("building") == 14);
+        CHECK(registry.subtypeName(30) == "chiller");
+        CHECK(registry.subtypeProperties(30) == persist::PROP_POWER);
+        CHECK(!registry.add({{0, "nothing"}}, {}));
+        CHECK(!registry.add({}, {{0, "nothing"}}));
+        CHECK(!registry.add({}, {{persist::asset_subtype::N_A, "none"}}));
+    }
+
+    SECTION("loadDbDump")
+    {
+        std::string path = s_temporary_file(
+            "-- MySQL dump\n"
+            "INSERT INTO `t_bios_asset_element_type` VALUES (1,'group'),(2,'datacenter'),(14,'building'),\n"
+            " (300,'zone');\n"
+            "INSERT INTO `t_bios_asset_device_type` VALUES (1,'ups'),(30,'chiller'),(400,'heat-pump'),\n"
+            " (401,'o\\'clock'),(402,'it''s');\n"
+            "INSERT INTO `t_bios_asset_link_type` VALUES (1,'power chain');\n");
+        persist::AssetRegistry registry;
+        CHECK(registry.loadDbDump(path));
+        CHECK(registry.addedTypes() == 2);
+        CHECK(registry.typeId("zone") == 300);
+        CHECK(registry.typeName(14) == "building");
+        CHECK(registry.addedSubtypes() == 4);
+        CHECK(registry.subtypeName(30) == "chiller");
+        CHECK(registry.subtypeId("heat-pump") == 400);
+        CHECK(registry.subtypeName(401) == "o'clock");
+        CHECK(registry.subtypeName(402) == "it's");
+        unlink(path.c_str());
+
+        path = s_temporary_file("INSERT INTO `t_bios_asset_element_type` VALUES (300,'zone'),(301;\n");
+        CHECK(!registry.loadDbDump(path));
+        unlink(path.c_str());
+        CHECK(!registry.loadDbDump("/nonexistent/dump.sql"));
+    }
+
+    SECTION("loadJson")
+    {
+        std::string path = s_temporary_file(R"({"types": [{"id": 300, "name": "zone", "properties": ["container"]}],
+            "subtypes": [{"id": 400, "name": "heat-pump", "properties": ["power", "sensor"]},
+                {"id": 401, "name": "x"}]})");
+        persist::AssetRegistry registry;
+        CHECK(registry.loadJson(path));
+        CHECK(registry.typeProperties(registry.typeId("zone")) == persist::PROP_CONTAINER);
+        CHECK(registry.subtypeProperties(400) == (persist::PROP_POWER | persist::PROP_SENSOR));
+        CHECK(registry.subtypeProperties(401) == persist::PROP_NONE);
+        unlink(path.c_str());
+
+        path = s_temporary_file(R"({"types": [{"id": 302, "name": "floor", "properties": ["heavy"]}]})");
+        CHECK(!registry.loadJson(path));
+        CHECK(registry.typeId("floor") == persist::TUNKNOWN);
+        unlink(path.c_str());
+    }
+
+    SECTION("concurrent readers")
+    {
+        persist::AssetRegistry registry;
+        std::atomic<bool>      done {false};
+        std::atomic<size_t>    bad {0};
+        std::thread            reader([&] {
+            while (!done) {
+                // an entry, once seen, stays with its name
+                for (uint16_t id = 1000; id < 1100; id++) {
+                    std::string_view name = registry.typeName(id);
+                    if (name != fty::TYPE_UNKNOWN && registry.typeId(name) != id)
+                        bad++;
+                }
+            }
+        });
+        for (uint16_t id = 1000; id < 1100; id++)
+            CHECK(registry.add({{id, "type-" + std::to_string(id)}}, {}));
+        done = true;
+        reader.join();
+        CHECK(bad == 0);
+        CHECK(registry.addedTypes() == 100);
+    }
+
+    SECTION("persist lookups")
+    {
+        auto& registry = persist::AssetRegistry::instance();
+        REQUIRE(registry.add({{900, "zone", persist::PROP_CONTAINER}}, {{900, "heat-pump"}}));
+        CHECK(persist::type_to_typeid("Zone") == 900);
+        CHECK(persist::typeid_to_type(900) == "zone");
+        CHECK(persist::is_ok_element_type(900));
+        CHECK(!persist::is_ok_element_type(901));
+        CHECK(persist::is_container("zone"));
+        CHECK(!persist::is_container("Zone"));
+        CHECK(persist::subtype_to_subtypeid(std::string("heat-pump")) == 900);
+        CHECK(persist::subtypeid_to_subtype(900) == "heat-pump");
+        CHECK(persist::subtypeid_to_subtype(901) == fty::SUB_UNKNOWN);
+        // and in the gaps of the built-in ids
+        REQUIRE(registry.add({{14, "building"}}, {{30, "chiller"}}));
+        CHECK(persist::typeid_to_type(14) == "building");
+        CHECK(persist::is_ok_element_type(14));
+        CHECK(persist::subtypeid_to_subtype(30) == "chiller");
+        CHECK(persist::subtype_to_subtypeid("Chiller") == 30);
+        // the constexpr lookups only know the built-in ones
+        CHECK(persist::typeid_to_type_view(900) == fty::TYPE_UNKNOWN);
+        CHECK(persist::type_to_typeid("rack") == persist::RACK);
+    }
+}
+
+TEST_CASE("Base benchmark", "[.][benchmark]")
+{
+    std::vector<std::string> subtypes;
+    for (uint16_t id = 1; id < persist::asset_subtype::NB_ASSET_SUBTYPES; id++) {
+        std::string name = persist::subtypeid_to_subtype(id);
+        if (name != fty::SUB_UNKNOWN)
+            subtypes.push_back(name);
+    }
+
+    BENCHMARK("subtype_to_subtypeid, all subtypes")
+    {
+        unsigned sum = 0;
+        for (const auto& subtype : subtypes)
+            sum += persist::subtype_to_subtypeid(std::string_view(subtype));
+        return sum;
+    };
+
+    // ids of an inventory with stale entries, one in four is unknown
+    std::vector<uint16_t> ids;
+    for (uint16_t id = 0; id < 128; id++)
+        ids.push_back(id % 4 == 3 ? uint16_t(id + 1000) : uint16_t(id % persist::asset_subtype::NB_ASSET_SUBTYPES));
+
+    BENCHMARK("subtypeid_to_subtype, mixed ids")
+    {
+        size_t length = 0;
+        for (uint16_t id : ids)
+            length += persist::subtypeid_to_subtype(id).size();
+        return length;
+    };
+
+    BENCHMARK("subtypeid_to_subtype_view, mixed ids")
+    {
+        size_t length = 0;
+        for (uint16_t id : ids)
+            length += persist::subtypeid_to_subtype_view(id).size();
+        return length;
+    };
+
+    std::vector<std::string> types;
+    for (uint16_t id = 1; id < persist::asset_type::NB_ASSET_TYPES; id++) {
+        std::string name = persist::typeid_to_type(id);
+        if (name != fty::TYPE_UNKNOWN)
+            types.push_back(name);
+    }
+
+    BENCHMARK("type_to_typeid, all types")
+    {
+        unsigned sum = 0;
+        for (const auto& type : types)
+            sum += persist::type_to_typeid(std::string_view(type));
+        return sum;
+    };
+
+    // built-in lookups don't slow down once the registry has entries
+    std::vector<std::string> added;
+    for (uint16_t id = 1000; id < 1100; id++) {
+        added.push_back("added-type-" + std::to_string(id));
+        persist::AssetRegistry::instance().add({{id, added.back()}}, {});
+    }
+
+    BENCHMARK("type_to_typeid, all types, 100 added types")
+    {
+        unsigned sum = 0;
+        for (const auto& type : types)
+            sum += persist::type_to_typeid(std::string_view(type));
+        return sum;
+    };
+
+    BENCHMARK("type_to_typeid, 100 added types")
+    {
+        unsigned sum = 0;
+        for (const auto& type : added)
+            sum += persist::type_to_typeid(std::string_view(type));
+        return sum;
+    };
+
+    // synthetic inventory of 100k (type, subtype) pairs, a few are unknown
+    std::vector<std::pair<uint16_t, uint16_t>> elements;
+    for (uint32_t i = 0; i < 100000; i++)
+        elements.emplace_back(uint16_t(i * 7 % 23), uint16_t(i * 13 % 83));
+
+    BENCHMARK("is_container and is_power_device, 100k elements")
+    {
+        size_t count = 0;
+        for (const auto& [type_id, subtype_id] : elements)
+            count += persist::is_container(type_id) + persist::is_power_device(subtype_id);
+        return count;
+    };
+
+    // synthetic import of 100k rows
+    std::vector<std::string> cells;
+    for (int i = 0; i < 100000; i++) {
+        cells.push_back("Server room " + std::to_string(i) + (i % 10 ? "" : " r\xc3\xa9seau"));
+        cells.push_back(i % 2 ? "location" : "description");
+        cells.push_back(std::string(size_t(i % 64), 'v') + "value");
+    }
+    std::vector<std::string_view> names, keytags, values;
+    for (size_t i = 0; i < cells.size(); i += 3) {
+        names.push_back(cells[i]);
+        keytags.push_back(cells[i + 1]);
+        values.push_back(cells[i + 2]);
+    }
+    persist::AssetColumns columns;
+    columns.names   = names.data();
+    columns.keytags = keytags.data();
+    columns.values  = values.data();
+    columns.rows    = names.size();
+
+    BENCHMARK("is_ok_name/keytag/value, 100k rows")
+    {
+        size_t bad = 0;
+        for (size_t i = 0; i < cells.size(); i += 3)
+            bad += !persist::is_ok_name(cells[i].c_str()) + !persist::is_ok_keytag(cells[i + 1].c_str()) +
+                   !persist::is_ok_value(cells[i + 2].c_str());
+        return bad;
+    };
+
+    BENCHMARK("validate_columns, 100k rows, 1 thread")
+    {
+        return persist::validate_columns(columns, 1);
+    };
+
+    BENCHMARK("validate_columns, 100k rows")
+    {
+        return persist::validate_columns(columns);
+    };
+
+    std::vector<std::string> operations = {"create", "Delete", "UPDATE", "get", "retire", "inventory", "other"};
+
+    BENCHMARK("str2operation, all operations")
+    {
+        unsigned sum = 0;
+        for (const auto& operation : operations)
+            sum += persist::str2operation(operation);
+        return sum;
+    };
+
+    BENCHMARK("EnumCodec<AvgStep>::parse, all steps")
+    {
+        unsigned sum = 0;
+        for (const char* step : AVG_STEPS)
+            sum += unsigned(fty::EnumCodec<fty::AvgStep>::parse(step));
+        return sum;
+    };
+}
@@ -0,0 +1,1164 @@
+/*  =========================================================================
+    fty_common_filesystem - Filesystem helpers
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "fty_common_filesystem.h"
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <fcntl.h>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+// temporary directory, removed with its content
+class TemporaryDirectory
+{
+public:
+    TemporaryDirectory()
+    {
+        char path[] = "/tmp/fty-common-filesystem-XXXXXX";
+        REQUIRE(mkdtemp(path));
+        m_path = path;
+    }
+
+    ~TemporaryDirectory()
+    {
+        std::string command = "rm -rf '" + m_path + "'";
+        CHECK(system(command.c_str()) == 0);
+    }
+
+    const std::string& path() const
+    {
+        return m_path;
+    }
+
+    std::string file(const std::string& name) const
+    {
+        std::string path = m_path + "/" + name;
+        int         fd   = open(path.c_str(), O_CREAT | O_WRONLY, 0644);
+        REQUIRE(fd != -1);
+        close(fd);
+        return path;
+    }
+
+private:
+    std::string m_path;
+};
+
+static std::vector<std::string> s_sorted(std::vector<std::string> names)
+{
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+TEST_CASE("filesystem list_directory")
+{
+    TemporaryDirectory directory;
+    directory.file("rule.json");
+    directory.file(".hidden");
+    directory.file("..data");
+    REQUIRE(mkdir((directory.path() + "/rules.d").c_str(), 0755) == 0);
+    REQUIRE(symlink("rule.json", (directory.path() + "/link.json").c_str()) == 0);
+    REQUIRE(symlink("rules.d", (directory.path() + "/link.d").c_str()) == 0);
+    REQUIRE(symlink("missing", (directory.path() + "/dangling").c_str()) == 0);
+
+    std::vector<shared::DirEntry> entries;
+    REQUIRE(shared::list_directory(directory.path().c_str(), entries));
+    CHECK(entries.size() == 7);
+    auto type = [&](const std::string& name) {
+        auto it = std::find_if(entries.begin(), entries.end(), [&](const shared::DirEntry& entry) {
+            return entry.name == name;
+        });
+        REQUIRE(it != entries.end());
+        return it->type;
+    };
+    CHECK(type("rule.json") == shared::FileType::Regular);
+    CHECK(type(".hidden") == shared::FileType::Regular);
+    CHECK(type("..data") == shared::FileType::Regular);
+    CHECK(type("rules.d") == shared::FileType::Directory);
+    CHECK(type("link.json") == shared::FileType::Regular);
+    CHECK(type("link.d") == shared::FileType::Directory);
+    CHECK(type("dangling") == shared::FileType::Unknown);
+
+    entries.clear();
+    REQUIRE(shared::list_directory(directory.path().c_str(), entries, false));
+    CHECK(type("link.json") == shared::FileType::Symlink);
+    CHECK(type("dangling") == shared::FileType::Symlink);
+    CHECK(type("rules.d") == shared::FileType::Directory);
+
+    CHECK(!shared::list_directory((directory.path() + "/missing").c_str(), entries));
+    CHECK(!shared::list_directory((directory.path() + "/rule.json").c_str(), entries));
+
+    // the old functions give the same answers
+    std::vector<std::string> files = {"rule.json", ".hidden", "..data", "link.json"};
+    CHECK(s_sorted(shared::files_in_directory(directory.path().c_str())) == s_sorted(files));
+    std::vector<std::string> found;
+    CHECK(shared::is_file_in_directory(directory.path(), found));
+    CHECK(s_sorted(found) == s_sorted(files));
+    CHECK(!shared::is_file_in_directory(directory.path() + "/missing", found));
+    CHECK(shared::files_in_directory((directory.path() + "/missing").c_str()).empty());
+}
+
+TEST_CASE("filesystem DirRange")
+{
+    TemporaryDirectory directory;
+    directory.file("a.rule");
+    directory.file("b.rule");
+    directory.file("c.json");
+    directory.file(".d.rule");
+    REQUIRE(mkdir((directory.path() + "/e.rule").c_str(), 0755) == 0);
+    REQUIRE(symlink("c.json", (directory.path() + "/f.json").c_str()) == 0);
+
+    auto names = [](shared::DirRange&& range) {
+        std::vector<std::string> result;
+        for (const auto& entry : range)
+            result.emplace_back(entry.name);
+        std::sort(result.begin(), result.end());
+        return result;
+    };
+    const char* path = directory.path().c_str();
+
+    using Names = std::vector<std::string>;
+    CHECK(names(shared::DirRange(path)) == Names {".d.rule", "a.rule", "b.rule", "c.json", "e.rule", "f.json"});
+    CHECK(names(shared::DirRange(path).dots(true)).size() == 8);
+    CHECK(names(shared::DirRange(path).suffix(".rule")) == Names {".d.rule", "a.rule", "b.rule", "e.rule"});
+    CHECK(names(shared::DirRange(path).suffix(".rule").ofType(shared::FileType::Regular)) ==
+          Names {".d.rule", "a.rule", "b.rule"});
+    CHECK(names(shared::DirRange(path).suffix(".rule").suffix(".json").ofType(shared::FileType::Directory)) ==
+          Names {"e.rule"});
+    CHECK(names(shared::DirRange(path).glob("*.rule")) == Names {"a.rule", "b.rule", "e.rule"});
+    CHECK(names(shared::DirRange(path).glob("[ab].*").glob("?.json")) ==
+          Names {"a.rule", "b.rule", "c.json", "f.json"});
+    CHECK(names(shared::DirRange(path, false).ofType(shared::FileType::Symlink)) == Names {"f.json"});
+    CHECK(names(shared::DirRange(path).ofType(shared::FileType::Symlink)).empty());
+    CHECK(names(shared::DirRange(path).ofType(shared::FileType::Other)).empty());
+
+    // the range and its iterators
+    shared::DirRange range(path);
+    REQUIRE(range);
+    range.ofType(shared::FileType::Regular).glob("c.*");
+    auto it = range.begin();
+    REQUIRE(it != range.end());
+    CHECK(it->name == "c.json");
+    CHECK(it->type == shared::FileType::Regular);
+    struct stat st;
+    REQUIRE(stat((directory.path() + "/c.json").c_str(), &st) == 0);
+    CHECK(it->inode == st.st_ino);
+    CHECK((*it).name == "c.json");
+    ++it;
+    CHECK(it == range.end());
+
+    // first match, then stop
+    bool found = false;
+    for (const auto& entry : shared::DirRange(path).suffix(".json")) {
+        found = entry.name.size() == 6;
+        break;
+    }
+    CHECK(found);
+
+    shared::DirRange missing((directory.path() + "/missing").c_str());
+    CHECK(!missing);
+    CHECK(missing.begin() == missing.end());
+
+    shared::DirRange moved(std::move(range));
+    CHECK(moved);
+    CHECK(!range);
+
+    CHECK(s_sorted(shared::items_in_directory(path)).size() == 8);
+    std::vector<std::string> items;
+    CHECK(shared::is_item_in_directory(path, items));
+    CHECK(s_sorted(items) == Names {".d.rule", "a.rule", "b.rule", "c.json", "e.rule", "f.json"});
+}
+
+// paths given by walk(), sorted
+static std::vector<std::string> s_walk(
+    const std::string& path, const shared::WalkOptions& options, shared::WalkAction directory_action = {})
+{
+    std::mutex               mutex;
+    std::vector<std::string> paths;
+    shared::walk(
+        path.c_str(),
+        [&](const shared::WalkEntry& entry) {
+            std::lock_guard<std::mutex> lock(mutex);
+            paths.push_back(entry.path() + (entry.type == shared::FileType::Directory ? "/" : ""));
+            return entry.type == shared::FileType::Directory ? directory_action : shared::WalkAction::Continue;
+        },
+        options);
+    return s_sorted(paths);
+}
+
+TEST_CASE("filesystem walk")
+{
+    TemporaryDirectory directory;
+    for (const char* subdirectory : {"/a", "/a/b", "/a/b/c", "/d"})
+        REQUIRE(mkdir((directory.path() + subdirectory).c_str(), 0755) == 0);
+    for (const char* file : {"1", "a/2", "a/b/3", "a/b/c/4", "d/5"})
+        directory.file(file);
+    REQUIRE(symlink("..", (directory.path() + "/a/b/up").c_str()) == 0);
+    REQUIRE(symlink("../1", (directory.path() + "/d/one").c_str()) == 0);
+
+    using Paths = std::vector<std::string>;
+    for (unsigned threads : {1u, 4u}) {
+        shared::WalkOptions options;
+        options.threads = threads;
+        CHECK(s_walk(directory.path(), options) ==
+              Paths {"1", "a/", "a/2", "a/b/", "a/b/3", "a/b/c/", "a/b/c/4", "a/b/up", "d/", "d/5", "d/one"});
+
+        options.maxDepth = 1;
+        CHECK(s_walk(directory.path(), options) == Paths {"1", "a/", "a/2", "a/b/", "d/", "d/5", "d/one"});
+        options.maxDepth = 0;
+        CHECK(s_walk(directory.path(), options) == Paths {"1", "a/", "d/"});
+        options.maxDepth = UINT32_MAX;
+
+        options.symlinks = shared::SymlinkPolicy::Ignore;
+        CHECK(s_walk(directory.path(), options) ==
+              Paths {"1", "a/", "a/2", "a/b/", "a/b/3", "a/b/c/", "a/b/c/4", "d/", "d/5"});
+
+        // up is a/, already visited
+        options.symlinks = shared::SymlinkPolicy::Follow;
+        CHECK(s_walk(directory.path(), options) ==
+              Paths {"1", "a/", "a/2", "a/b/", "a/b/3", "a/b/c/", "a/b/c/4", "a/b/up/", "d/", "d/5", "d/one"});
+        options.symlinks = shared::SymlinkPolicy::Report;
+
+        CHECK(s_walk(directory.path(), options, shared::WalkAction::Skip) == Paths {"1", "a/", "d/"});
+    }
+
+    // types, depth and directory fd
+    bool ok = shared::walk(directory.path().c_str(), [&](const shared::WalkEntry& entry) {
+        if (entry.name == "up") {
+            CHECK(entry.type == shared::FileType::Symlink);
+            CHECK(entry.directory == "a/b");
+            CHECK(entry.depth == 2);
+            struct stat st;
+            CHECK(fstatat(entry.directoryFd, "3", &st, 0) == 0);
+        }
+        if (entry.name == "4")
+            CHECK(entry.type == shared::FileType::Regular);
+        return shared::WalkAction::Continue;
+    });
+    CHECK(ok);
+
+    // stop and cancel
+    size_t count = 0;
+    CHECK(!shared::walk(directory.path().c_str(), [&](const shared::WalkEntry&) {
+        return ++count == 3 ? shared::WalkAction::Stop : shared::WalkAction::Continue;
+    }));
+    CHECK(count == 3);
+    std::atomic<bool>   cancel {false};
+    shared::WalkOptions options;
+    options.cancel = &cancel;
+    count          = 0;
+    CHECK(!shared::walk(
+        directory.path().c_str(),
+        [&](const shared::WalkEntry&) {
+            cancel = ++count == 2;
+            return shared::WalkAction::Continue;
+        },
+        options));
+    CHECK(count == 2);
+
+    // the other threads stop visiting too, but for the calls already started
+    TemporaryDirectory big;
+    for (int i = 0; i < 8; i++) {
+        std::string name = "dir" + std::to_string(i);
+        REQUIRE(mkdir((big.path() + "/" + name).c_str(), 0755) == 0);
+        for (int j = 0; j < 200; j++)
+            big.file(name + "/" + std::to_string(j));
+    }
+    std::atomic<size_t> visits {0};
+    std::atomic<bool>   stopped {false};
+    std::atomic<size_t> late {0};
+    options         = shared::WalkOptions();
+    options.threads = 4;
+    CHECK(!shared::walk(
+        big.path().c_str(),
+        [&](const shared::WalkEntry&) {
+            late += stopped;
+            // let the threads interleave
+            usleep(100);
+            if (++visits != 100)
+                return shared::WalkAction::Continue;
+            stopped = true;
+            return shared::WalkAction::Stop;
+        },
+        options));
+    CHECK(late < 20);
+
+    CHECK(!shared::walk((directory.path() + "/missing").c_str(), [](const shared::WalkEntry&) {
+        return shared::WalkAction::Continue;
+    }));
+}
+
+// waits for the changes of the watcher until count are there; a new file may be reported as modified once closed,
+// which is skipped
+static std::vector<std::string> s_changes(shared::DirectoryWatcher& watcher, size_t count)
+{
+    static const char*       kinds[] = {"+", "-", "*"};
+    std::vector<std::string> changes;
+    auto                     take = [&] {
+        for (const auto& change : watcher.takeChanges()) {
+            bool closed = change.kind == shared::DirChange::Kind::Modified && !changes.empty() &&
+                          changes.back() == "+" + change.name;
+            if (!closed)
+                changes.push_back(kinds[int(change.kind)] + change.name);
+        }
+    };
+    for (int i = 0; i < 100 && changes.size() < count; i++) {
+        watcher.waitForChanges(std::chrono::milliseconds(100));
+        take();
+    }
+    // late events
+    usleep(50000);
+    take();
+    return changes;
+}
+
+static std::vector<std::string> s_names(const shared::DirectoryWatcher& watcher)
+{
+    std::vector<std::string> names;
+    auto                     snapshot = watcher.snapshot();
+    for (const auto& entry : *snapshot)
+        names.push_back(entry.name);
+    return names;
+}
+
+TEST_CASE("filesystem DirectoryWatcher")
+{
+    using Names = std::vector<std::string>;
+    for (bool polling : {false, true}) {
+        TemporaryDirectory directory;
+        directory.file("a.rule");
+        REQUIRE(mkdir((directory.path() + "/sub").c_str(), 0755) == 0);
+
+        shared::WatcherOptions options;
+        options.forcePolling = polling;
+        options.pollInterval = std::chrono::milliseconds(20);
+        shared::DirectoryWatcher watcher(directory.path(), options);
+        CHECK(watcher);
+        CHECK(watcher.usesInotify() == !polling);
+        auto first = watcher.snapshot();
+        REQUIRE(first->size() == 2);
+        CHECK((*first)[0].name == "a.rule");
+        CHECK((*first)[0].type == shared::FileType::Regular);
+        CHECK((*first)[1].type == shared::FileType::Directory);
+        CHECK(watcher.snapshot() == first);
+
+        // polling sees files by their modification time, which may have a coarse granularity
+        if (polling)
+            usleep(20000);
+        std::string path = directory.file("b.rule");
+        CHECK(s_changes(watcher, 1) == Names {"+b.rule"});
+        CHECK(s_names(watcher) == Names {"a.rule", "b.rule", "sub"});
+        CHECK(first->size() == 2);
+
+        FILE* file = fopen(path.c_str(), "w");
+        REQUIRE(file);
+        fputs("rule", file);
+        fclose(file);
+        CHECK(s_changes(watcher, 1) == Names {"*b.rule"});
+
+        REQUIRE(rename(path.c_str(), (directory.path() + "/c.rule").c_str()) == 0);
+        auto changes = s_changes(watcher, 2);
+        std::sort(changes.begin(), changes.end());
+        CHECK(changes == Names {"+c.rule", "-b.rule"});
+
+        REQUIRE(unlink((directory.path() + "/a.rule").c_str()) == 0);
+        CHECK(s_changes(watcher, 1) == Names {"-a.rule"});
+        CHECK(s_names(watcher) == Names {"c.rule", "sub"});
+        CHECK(watcher.takeChanges().empty());
+    }
+
+    // a directory which doesn't exist yet is polled
+    TemporaryDirectory     directory;
+    std::string            path = directory.path() + "/later";
+    std::mutex             mutex;
+    Names                  changes;
+    shared::WatcherOptions options;
+    options.pollInterval = std::chrono::milliseconds(20);
+    options.callback     = [&](const shared::DirChange& change) {
+        std::lock_guard<std::mutex> lock(mutex);
+        changes.push_back(change.name);
+    };
+    shared::DirectoryWatcher watcher(path, options);
+    CHECK(!watcher);
+    CHECK(!watcher.usesInotify());
+    CHECK(watcher.snapshot()->empty());
+    REQUIRE(mkdir(path.c_str(), 0755) == 0);
+    directory.file("later/x");
+    for (int i = 0; i < 100 && watcher.snapshot()->empty(); i++)
+        usleep(10000);
+    CHECK(s_names(watcher) == Names {"x"});
+    for (int i = 0; i < 100 && !watcher.usesInotify(); i++)
+        usleep(10000);
+    CHECK(watcher.usesInotify());
+
+    // moved away then created again, it is polled meanwhile and watched again
+    REQUIRE(rename(path.c_str(), (path + ".old").c_str()) == 0);
+    for (int i = 0; i < 100 && watcher.usesInotify(); i++)
+        usleep(10000);
+    CHECK(!watcher.usesInotify());
+    CHECK(watcher.snapshot()->empty());
+    directory.file("later.old/ignored");
+    REQUIRE(mkdir(path.c_str(), 0755) == 0);
+    for (int i = 0; i < 100 && !watcher.usesInotify(); i++)
+        usleep(10000);
+    CHECK(watcher.usesInotify());
+    REQUIRE(mkdir((path + "/y").c_str(), 0755) == 0);
+    for (int i = 0; i < 100 && watcher.snapshot()->empty(); i++)
+        usleep(10000);
+    CHECK(s_names(watcher) == Names {"y"});
+    std::lock_guard<std::mutex> lock(mutex);
+    CHECK(changes == Names {"x", "x", "y"});
+    CHECK(watcher.takeChanges().empty());
+}
+
+// waits for the inotify thread of cache to forget path
+static mode_t s_mode_after_change(shared::StatCache& cache, const std::string& path, mode_t old)
+{
+    mode_t mode = cache.mode(path.c_str());
+    for (int i = 0; i < 100 && mode == old; i++) {
+        usleep(10000);
+        mode = cache.mode(path.c_str());
+    }
+    return mode;
+}
+
+TEST_CASE("filesystem StatCache")
+{
+    TemporaryDirectory directory;
+    std::string        path = directory.file("a.rule");
+    std::string        sub  = directory.path() + "/sub";
+
+    SECTION("ttl")
+    {
+        shared::StatCache cache(std::chrono::milliseconds(50), false);
+        CHECK(!cache.usesInotify());
+        CHECK(S_ISREG(cache.mode(path.c_str())));
+        CHECK(S_ISREG(cache.mode(path.c_str())));
+        CHECK(cache.mode(sub.c_str()) == 0);
+        CHECK(cache.stats().hits == 1);
+        CHECK(cache.stats().misses == 2);
+
+        // stale until expiry or invalidation
+        REQUIRE(unlink(path.c_str()) == 0);
+        REQUIRE(mkdir(sub.c_str(), 0755) == 0);
+        CHECK(S_ISREG(cache.mode(path.c_str())));
+        CHECK(cache.mode(sub.c_str()) == 0);
+        cache.invalidate(sub);
+        CHECK(S_ISDIR(cache.mode(sub.c_str())));
+        usleep(60000);
+        CHECK(cache.mode(path.c_str()) == 0);
+        CHECK(cache.stats().hits == 3);
+        CHECK(cache.stats().invalidations == 0);
+
+        cache.clear();
+        CHECK(S_ISDIR(cache.mode(sub.c_str())));
+        CHECK(cache.stats().misses == 5);
+    }
+
+    SECTION("inotify")
+    {
+        shared::StatCache cache(std::chrono::hours(1));
+        REQUIRE(cache.usesInotify());
+        CHECK(S_ISREG(cache.mode(path.c_str())));
+        CHECK(cache.mode(sub.c_str()) == 0);
+
+        REQUIRE(unlink(path.c_str()) == 0);
+        CHECK(s_mode_after_change(cache, path, S_IFREG | 0644) == 0);
+        REQUIRE(mkdir(sub.c_str(), 0755) == 0);
+        CHECK(S_ISDIR(s_mode_after_change(cache, sub, 0)));
+        REQUIRE(chmod(sub.c_str(), 0700) == 0);
+        CHECK((s_mode_after_change(cache, sub, S_IFDIR | 0755) & 0777) == 0700);
+        CHECK(cache.stats().invalidations >= 3);
+
+        // entries of a removed directory are forgotten, and it is watched again once created again
+        std::string nested = directory.file("sub/b.rule");
+        CHECK(S_ISREG(cache.mode(nested.c_str())));
+        REQUIRE(unlink(nested.c_str()) == 0);
+        REQUIRE(rmdir(sub.c_str()) == 0);
+        CHECK(s_mode_after_change(cache, nested, S_IFREG | 0644) == 0);
+        REQUIRE(mkdir(sub.c_str(), 0755) == 0);
+        directory.file("sub/b.rule");
+        CHECK(S_ISREG(s_mode_after_change(cache, nested, 0)));
+
+        // relative paths are watched in the working directory
+        char cwd[PATH_MAX];
+        REQUIRE(getcwd(cwd, sizeof(cwd)));
+        REQUIRE(chdir(directory.path().c_str()) == 0);
+        CHECK(cache.mode("c.rule") == 0);
+        directory.file("c.rule");
+        CHECK(S_ISREG(s_mode_after_change(cache, "c.rule", 0)));
+        REQUIRE(chdir(cwd) == 0);
+    }
+
+    SECTION("bounded")
+    {
+        // at most one entry per shard
+        shared::StatCache        cache(std::chrono::hours(1), true, 16);
+        std::vector<std::string> paths;
+        for (int i = 0; i < 40; i++) {
+            REQUIRE(mkdir((directory.path() + "/d" + std::to_string(i)).c_str(), 0755) == 0);
+            paths.push_back(directory.file("d" + std::to_string(i) + "/x"));
+        }
+        for (const auto& p : paths)
+            CHECK(S_ISREG(cache.mode(p.c_str())));
+        CHECK(cache.size() <= 16);
+        CHECK(cache.stats().evictions == 40 - cache.size());
+
+        // a directory is watched as long as paths in it are cached
+        uint64_t watches = cache.stats().watches;
+        CHECK(watches == cache.size());
+        cache.invalidate(paths.back());
+        CHECK(cache.stats().watches == watches - 1);
+        cache.clear();
+        CHECK(cache.size() == 0);
+        CHECK(cache.stats().watches == 0);
+        CHECK(S_ISREG(cache.mode(paths.back().c_str())));
+        CHECK(cache.stats().watches == 1);
+    }
+
+    SECTION("set_stat_cache")
+    {
+        {
+            shared::StatCache cache;
+            shared::set_stat_cache(&cache);
+            CHECK(shared::is_file(path.c_str()));
+            CHECK(!shared::is_dir(sub.c_str()));
+            CHECK(shared::is_file(path.c_str()));
+            CHECK(cache.stats().hits == 1);
+
+            // mkdir_if_needed invalidates what it creates
+            CHECK(shared::mkdir_if_needed(sub.c_str()));
+            CHECK(shared::is_dir(sub.c_str()));
+            CHECK(cache.stats().misses == 3);
+        }
+        // a destroyed cache is not used anymore
+        REQUIRE(unlink(path.c_str()) == 0);
+        CHECK(!shared::is_file(path.c_str()));
+    }
+
+    SECTION("concurrent lookups")
+    {
+        shared::StatCache        cache(std::chrono::milliseconds(1));
+        std::vector<std::string> paths;
+        for (int i = 0; i < 20; i++)
+            paths.push_back(directory.file("rule-" + std::to_string(i)));
+        std::atomic<size_t>      wrong {0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++) {
+            threads.emplace_back([&] {
+                for (int round = 0; round < 500; round++)
+                    for (const auto& p : paths)
+                        wrong += !S_ISREG(cache.mode(p.c_str()));
+            });
+        }
+        for (int round = 0; round < 50; round++)
+            chmod(paths[size_t(round) % paths.size()].c_str(), round % 2 ? 0600 : 0644);
+        for (auto& thread : threads)
+            thread.join();
+        CHECK(wrong == 0);
+        CHECK(cache.stats().hits + cache.stats().misses == 4 * 500 * 20);
+    }
+}
+
+TEST_CASE("filesystem make_directories")
+{
+    using Names = std::vector<std::string>;
+    TemporaryDirectory directory;
+    std::string        root = directory.path();
+    Names              created;
+
+    CHECK(shared::make_directories((root + "/a/b/c").c_str(), created));
+    CHECK(created == Names {root + "/a", root + "/a/b", root + "/a/b/c"});
+    CHECK(shared::is_dir((root + "/a/b/c").c_str()));
+    created.clear();
+    CHECK(shared::make_directories((root + "/a/b/c").c_str(), created));
+    CHECK(shared::make_directories((root + "/a/b").c_str(), created));
+    CHECK(created.empty());
+    CHECK(shared::make_directories((root + "/a//b/d/e/").c_str(), created, 0700));
+    CHECK(created == Names {root + "/a//b/d", root + "/a//b/d/e"});
+    struct stat st;
+    REQUIRE(stat((root + "/a/b/d/e").c_str(), &st) == 0);
+    CHECK((st.st_mode & 0777) == 0700);
+
+    // a file on the way
+    std::string file = directory.file("file");
+    created.clear();
+    CHECK(!shared::make_directories(file.c_str(), created));
+    CHECK(errno == ENOTDIR);
+    CHECK(!shared::make_directories((file + "/x/y").c_str(), created));
+    CHECK(errno == ENOTDIR);
+    CHECK(!shared::make_directories("", created));
+    CHECK(created.empty());
+
+    // relative to the working directory
+    char cwd[PATH_MAX];
+    REQUIRE(getcwd(cwd, sizeof(cwd)));
+    REQUIRE(chdir(root.c_str()) == 0);
+    CHECK(shared::make_directories("r/s", created));
+    CHECK(created == Names {"r", "r/s"});
+    REQUIRE(chdir(cwd) == 0);
+
+    // mkdir_if_needed says whether the directory is there
+    CHECK(shared::mkdir_if_needed((root + "/m/n").c_str(), 0755));
+    CHECK(shared::mkdir_if_needed((root + "/m/n").c_str(), 0755));
+    CHECK(!shared::mkdir_if_needed((root + "/o/p").c_str(), 0755, false));
+    CHECK(shared::mkdir_if_needed((root + "/o").c_str(), 0755, false));
+    CHECK(!shared::mkdir_if_needed(file.c_str(), 0755, false));
+
+    // default mode, whatever the umask, and usable by an unprivileged owner
+    mode_t mask = umask(0);
+    CHECK(shared::mkdir_if_needed((root + "/d/e").c_str()));
+    umask(mask);
+    REQUIRE(stat((root + "/d").c_str(), &st) == 0);
+    CHECK((st.st_mode & 07777) == 0755);
+    REQUIRE(stat((root + "/d/e").c_str(), &st) == 0);
+    CHECK((st.st_mode & 07777) == 0755);
+    if (getuid() == 0) {
+        REQUIRE(chmod(root.c_str(), 0777) == 0);
+        pid_t pid = fork();
+        REQUIRE(pid != -1);
+        if (pid == 0)
+            _exit(setuid(65534) == 0 && shared::mkdir_if_needed((root + "/nobody/a/b").c_str()) ? 0 : 1);
+        int status;
+        REQUIRE(waitpid(pid, &status, 0) == pid);
+        CHECK(WIFEXITED(status));
+        CHECK(WEXITSTATUS(status) == 0);
+    }
+
+    // siblings from one descriptor, the bad names don't stop the others
+    created.clear();
+    CHECK(!shared::make_subdirectories((root + "/t/u").c_str(), {"x", "y/z", "", "x"}, created));
+    CHECK(errno == ENOENT);
+    CHECK(created == Names {root + "/t", root + "/t/u", root + "/t/u/x", root + "/t/u/y", root + "/t/u/y/z"});
+    created.clear();
+    CHECK(shared::make_subdirectories((root + "/t/u/").c_str(), {"x", "w"}, created));
+    CHECK(created == Names {root + "/t/u/w"});
+    CHECK(!shared::make_subdirectories(file.c_str(), {"x"}, created));
+
+    // concurrent agents: everything is created once, and all of them succeed
+    std::mutex               mutex;
+    Names                    all;
+    std::atomic<int>         failed {0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < 20; i++) {
+                Names mine;
+                failed += !shared::make_directories((root + "/race/" + std::to_string(i) + "/1/2/3").c_str(), mine);
+                std::lock_guard<std::mutex> lock(mutex);
+                all.insert(all.end(), mine.begin(), mine.end());
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    CHECK(failed == 0);
+    std::sort(all.begin(), all.end());
+    CHECK(std::adjacent_find(all.begin(), all.end()) == all.end());
+    CHECK(all.size() == 1 + 20 * 4);
+}
+
+static void s_write(const std::string& path, const std::string& content)
+{
+    FILE* file = fopen(path.c_str(), "w");
+    REQUIRE(file);
+    REQUIRE(fwrite(content.data(), 1, content.size(), file) == content.size());
+    fclose(file);
+}
+
+TEST_CASE("filesystem read_file")
+{
+    TemporaryDirectory directory;
+    std::string        path = directory.path() + "/license";
+    std::string        text;
+    for (int i = 0; i < 10000; i++)
+        text += "line " + std::to_string(i) + "\n";
+    s_write(path, text);
+    std::string empty = directory.file("empty");
+
+    std::string content = "previous";
+    CHECK(shared::read_file(path.c_str(), content));
+    CHECK(content == text);
+    CHECK(shared::read_file(empty.c_str(), content));
+    CHECK(content.empty());
+    // no size known
+    CHECK(shared::read_file("/proc/self/status", content));
+    CHECK(content.find("Name:") == 0);
+    CHECK(content.size() > 100);
+    CHECK(!shared::read_file((directory.path() + "/missing").c_str(), content));
+    CHECK(errno == ENOENT);
+    CHECK(!shared::read_file(directory.path().c_str(), content));
+    CHECK(errno == EISDIR);
+
+    shared::MappedFile mapped(path.c_str());
+    REQUIRE(mapped);
+    CHECK(mapped.view() == text);
+    CHECK(mapped.size() == text.size());
+    shared::MappedFile moved(std::move(mapped));
+    CHECK(!mapped);
+    CHECK(mapped.view().empty());
+    CHECK(moved.view() == text);
+    mapped = shared::MappedFile(empty.c_str(), shared::MappedFile::Advice::WillNeed);
+    CHECK(mapped);
+    CHECK(mapped.view().empty());
+    mapped = std::move(moved);
+    CHECK(mapped.view().substr(0, 7) == "line 0\n");
+
+    CHECK(!shared::MappedFile((directory.path() + "/missing").c_str()));
+    CHECK(errno == ENOENT);
+    CHECK(!shared::MappedFile(directory.path().c_str(), shared::MappedFile::Advice::Random));
+    CHECK(errno == EISDIR);
+}
+
+TEST_CASE("filesystem read_files")
+{
+    TemporaryDirectory       directory;
+    std::vector<std::string> paths;
+    // more than the io_uring ring holds at once
+    for (int i = 0; i < 600; i++) {
+        paths.push_back(directory.path() + "/rule-" + std::to_string(i) + ".json");
+        s_write(paths.back(), "{\"rule\": " + std::to_string(i) + "}");
+    }
+    paths.push_back(directory.path() + "/big");
+    s_write(paths.back(), std::string(1 << 20, 'x'));
+    paths.push_back(directory.file("empty"));
+    paths.push_back("/proc/self/status");
+    paths.push_back(directory.path() + "/missing");
+    paths.push_back(directory.path());
+
+    for (bool io_uring : {true, false}) {
+        shared::ReadFilesOptions options;
+        options.ioUring = io_uring;
+        auto results    = shared::read_files(paths, options);
+        REQUIRE(results.size() == paths.size());
+        for (size_t i = 0; i < 601; i++) {
+            std::string content;
+            REQUIRE(shared::read_file(paths[i].c_str(), content));
+            CHECK(results[i].error == 0);
+            CHECK(results[i].content == content);
+        }
+        CHECK(results[601].error == 0);
+        CHECK(results[601].content.empty());
+        CHECK(results[602].content.find("Name:") == 0);
+        CHECK(results[602].content.find("VmRSS:") != std::string::npos);
+        CHECK(results[603].error == ENOENT);
+        CHECK(results[604].error == EISDIR);
+        CHECK(results[604].content.empty());
+    }
+    CHECK(shared::read_files({}).empty());
+}
+
+TEST_CASE("filesystem path")
+{
+    namespace path = shared::path;
+
+    CHECK(path::basename("/etc/fty/rules/a.json") == "a.json");
+    CHECK(path::basename("a.json") == "a.json");
+    CHECK(path::basename("rules/") == "");
+    CHECK(path::basename("") == "");
+    CHECK(shared::basename("/etc/fty/rules/a.json") == "a.json");
+    CHECK(shared::basename("rules/") == "");
+
+    CHECK(path::dirname("/etc/fty/rules/a.json") == "/etc/fty/rules");
+    CHECK(path::dirname("/etc/fty//rules/") == "/etc/fty//rules");
+    CHECK(path::dirname("rules//a.json") == "rules");
+    CHECK(path::dirname("/a") == "/");
+    CHECK(path::dirname("//a") == "/");
+    CHECK(path::dirname("/") == "/");
+    CHECK(path::dirname("a.json") == "");
+
+    CHECK(path::extension("/etc/fty/rules/a.rule.json") == ".json");
+    CHECK(path::extension("a.") == ".");
+    CHECK(path::extension(".profile") == "");
+    CHECK(path::extension("rules.d/a") == "");
+    CHECK(path::extension("..") == "");
+    CHECK(path::extension("") == "");
+
+    std::string buffer;
+    CHECK(path::join(buffer, "/etc/fty", "a.json") == "/etc/fty/a.json");
+    CHECK(path::join(buffer, "/etc/fty/", "a.json") == "/etc/fty/a.json");
+    CHECK(path::join(buffer, "", "a.json") == "a.json");
+    CHECK(path::join(buffer, "/", "etc") == "/etc");
+    // the buffer is reused
+    const char* data = buffer.data();
+    CHECK(path::join(buffer, "/e", "a") == "/e/a");
+    CHECK(buffer.data() == data);
+
+    const std::pair<const char*, const char*> normal[] = {
+        {"", "."},
+        {".", "."},
+        {"./", "."},
+        {"/", "/"},
+        {"//", "/"},
+        {"a", "a"},
+        {"a//./b/../c/", "a/c"},
+        {"/etc/fty/../fty/./rules//a.json", "/etc/fty/rules/a.json"},
+        {"/../a", "/a"},
+        {"/..", "/"},
+        {"a/..", "."},
+        {"a/../..", ".."},
+        {"../a/../../b", "../../b"},
+        {"./../a", "../a"},
+        {"a/b/c/../../d", "a/d"},
+        {"...", "..."},
+    };
+    for (const auto& [path, expected] : normal) {
+        INFO(path);
+        CHECK(path::normalize(buffer, path) == expected);
+    }
+}
+
+TEST_CASE("filesystem benchmark", "[.][benchmark]")
+{
+    TemporaryDirectory directory;
+    for (int i = 0; i < 100000; i++)
+        directory.file("rule-" + std::to_string(i) + ".json");
+    const char* path = directory.path().c_str();
+
+    // what files_in_directory did: a path and a stat() per entry
+    BENCHMARK("items_in_directory + is_file, 100k entries")
+    {
+        std::vector<std::string> result;
+        std::string              prefix = directory.path() + "/";
+        for (const auto& item : shared::items_in_directory(path)) {
+            if (shared::is_file((prefix + item).c_str()))
+                result.push_back(item);
+        }
+        return result;
+    };
+
+    BENCHMARK("files_in_directory, 100k entries")
+    {
+        return shared::files_in_directory(path);
+    };
+
+    BENCHMARK("list_directory, 100k entries")
+    {
+        std::vector<shared::DirEntry> entries;
+        shared::list_directory(path, entries);
+        return entries;
+    };
+
+    shared::DirectoryWatcher watcher(directory.path());
+
+    BENCHMARK("DirectoryWatcher::snapshot, 100k entries")
+    {
+        return watcher.snapshot()->size();
+    };
+
+    BENCHMARK("DirRange, count of 100k entries")
+    {
+        size_t count = 0;
+        for (const auto& entry : shared::DirRange(path).suffix(".json")) {
+            (void)entry;
+            count++;
+        }
+        return count;
+    };
+
+    BENCHMARK("DirRange, first match")
+    {
+        for (const auto& entry : shared::DirRange(path).glob("rule-*.json"))
+            return entry.inode;
+        return ino_t(0);
+    };
+}
+
+TEST_CASE("filesystem walk benchmark", "[.][benchmark]")
+{
+    // 10 directories > 10 directories > 1000 files: 100110 entries
+    TemporaryDirectory directory;
+    for (int i = 0; i < 10; i++) {
+        std::string first = "dir-" + std::to_string(i);
+        REQUIRE(mkdir((directory.path() + "/" + first).c_str(), 0755) == 0);
+        for (int j = 0; j < 10; j++) {
+            std::string second = first + "/dir-" + std::to_string(j);
+            REQUIRE(mkdir((directory.path() + "/" + second).c_str(), 0755) == 0);
+            for (int k = 0; k < 1000; k++)
+                directory.file(second + "/rule-" + std::to_string(k) + ".json");
+        }
+    }
+
+    for (unsigned threads : {1u, std::max(4u, std::thread::hardware_concurrency())}) {
+        shared::WalkOptions options;
+        options.threads = threads;
+        std::atomic<size_t> entries {0};
+        auto                visit = [&](const shared::WalkEntry&) {
+            entries++;
+            return shared::WalkAction::Continue;
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        shared::walk(directory.path().c_str(), visit, options);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        REQUIRE(entries == 100110);
+        printf("walk, %u threads: %.0f entries/s\n", threads, double(entries) / elapsed.count());
+
+        BENCHMARK("walk, 100k entries, " + std::to_string(threads) + " threads")
+        {
+            return shared::walk(directory.path().c_str(), visit, options);
+        };
+    }
+}
+
+TEST_CASE("filesystem StatCache benchmark", "[.][benchmark]")
+{
+    TemporaryDirectory       directory;
+    std::vector<std::string> paths;
+    for (int i = 0; i < 1000; i++)
+        paths.push_back(directory.file("rule-" + std::to_string(i) + ".json"));
+    for (int i = 0; i < 1000; i++)
+        paths.push_back(directory.path() + "/missing-" + std::to_string(i) + ".json");
+
+    BENCHMARK("is_file, 2000 paths")
+    {
+        size_t count = 0;
+        for (const auto& path : paths)
+            count += shared::is_file(path.c_str());
+        return count;
+    };
+
+    shared::StatCache cache;
+    shared::set_stat_cache(&cache);
+
+    BENCHMARK("is_file with StatCache, 2000 paths")
+    {
+        size_t count = 0;
+        for (const auto& path : paths)
+            count += shared::is_file(path.c_str());
+        return count;
+    };
+
+    shared::set_stat_cache(nullptr);
+}
+
+TEST_CASE("filesystem make_directories benchmark", "[.][benchmark]")
+{
+    TemporaryDirectory       directory;
+    std::vector<std::string> names;
+    for (int i = 0; i < 1000; i++)
+        names.push_back("dir-" + std::to_string(i));
+    int run = 0;
+
+    BENCHMARK_ADVANCED("make_directories, 1000 siblings")(Catch::Benchmark::Chronometer meter)
+    {
+        std::string parent = directory.path() + "/run-" + std::to_string(run++) + "/";
+        meter.measure([&] {
+            std::vector<std::string> created;
+            for (const auto& name : names)
+                shared::make_directories((parent + name).c_str(), created);
+            return created.size();
+        });
+    };
+
+    BENCHMARK_ADVANCED("make_subdirectories, 1000 siblings")(Catch::Benchmark::Chronometer meter)
+    {
+        std::string parent = directory.path() + "/run-" + std::to_string(run++);
+        meter.measure([&] {
+            std::vector<std::string> created;
+            shared::make_subdirectories(parent.c_str(), names, created);
+            return created.size();
+        });
+    };
+
+    BENCHMARK("make_directories, existing 8 levels")
+    {
+        std::vector<std::string> created;
+        shared::make_directories((directory.path() + "/run-0/dir-1/a/b/c/d/e/f").c_str(), created);
+        return created.size();
+    };
+}
+
+TEST_CASE("filesystem read_file benchmark", "[.][benchmark]")
+{
+    TemporaryDirectory directory;
+    std::string        big = directory.path() + "/big.json";
+    s_write(big, std::string(16 << 20, 'x'));
+    std::vector<std::string> small;
+    for (int i = 0; i < 1000; i++) {
+        small.push_back(directory.path() + "/rule-" + std::to_string(i) + ".json");
+        s_write(small.back(), std::string(2000, 'x'));
+    }
+
+    // what the agents do
+    auto stream = [](const std::string& path) {
+        std::ifstream     file(path);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        return buffer.str();
+    };
+
+    BENCHMARK("ifstream, 16 MB")
+    {
+        return stream(big).size();
+    };
+
+    BENCHMARK("read_file, 16 MB")
+    {
+        std::string content;
+        shared::read_file(big.c_str(), content);
+        return content.size();
+    };
+
+    BENCHMARK("MappedFile, 16 MB")
+    {
+        shared::MappedFile file(big.c_str());
+        size_t             count = 0;
+        for (char c : file.view())
+            count += c == 'x';
+        return count;
+    };
+
+    BENCHMARK("ifstream, 1000 files of 2 kB")
+    {
+        size_t size = 0;
+        for (const auto& path : small)
+            size += stream(path).size();
+        return size;
+    };
+
+    BENCHMARK("read_file, 1000 files of 2 kB")
+    {
+        size_t      size = 0;
+        std::string content;
+        for (const auto& path : small) {
+            shared::read_file(path.c_str(), content);
+            size += content.size();
+        }
+        return size;
+    };
+}
+
+TEST_CASE("filesystem read_files benchmark", "[.][benchmark]")
+{
+    // what an agent loads at startup: 1000 rules of 2 to 10 kB
+    TemporaryDirectory directory;
+    for (int i = 0; i < 1000; i++)
+        s_write(directory.path() + "/rule-" + std::to_string(i) + ".json", std::string(2000 + 8 * i, 'x'));
+    std::vector<std::string> paths;
+    for (const auto& name : shared::files_in_directory(directory.path().c_str()))
+        paths.push_back(directory.path() + "/" + name);
+
+    // drops the files from the page cache, without root
+    auto evict = [&] {
+        for (const auto& path : paths) {
+            int fd = open(path.c_str(), O_RDONLY);
+            fdatasync(fd);
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+    };
+    auto sequential = [&] {
+        size_t      size = 0;
+        std::string content;
+        for (const auto& path : paths) {
+            shared::read_file(path.c_str(), content);
+            size += content.size();
+        }
+        return size;
+    };
+    shared::ReadFilesOptions threads;
+    threads.ioUring = false;
+
+    for (bool cold : {true, false}) {
+        std::string suffix = cold ? ", cold cache" : ", warm cache";
+        BENCHMARK_ADVANCED("read_file loop, 1000 files" + suffix)(Catch::Benchmark::Chronometer meter)
+        {
+            if (cold)
+                evict();
+            meter.measure(sequential);
+        };
+        BENCHMARK_ADVANCED("read_files thread pool, 1000 files" + suffix)(Catch::Benchmark::Chronometer meter)
+        {
+            if (cold)
+                evict();
+            meter.measure([&] {
+                return shared::read_files(paths, threads).size();
+            });
+        };
+        BENCHMARK_ADVANCED("read_files io_uring, 1000 files" + suffix)(Catch::Benchmark::Chronometer meter)
+        {
+            if (cold)
+                evict();
+            meter.measure([&] {
+                return shared::read_files(paths).size();
+            });
+        };
+    }
+}
+
+TEST_CASE("filesystem path benchmark", "[.][benchmark]")
+{
+    std::vector<std::string> names;
+    for (int i = 0; i < 10000; i++)
+        names.push_back("rule-" + std::to_string(i) + ".json");
+    const std::string directory = "/var/lib/fty/fty-alert-engine/templates";
+
+    BENCHMARK("concatenation, 10k paths")
+    {
+        size_t size = 0;
+        for (const auto& name : names)
+            size += (directory + shared::path_separator() + name).size();
+        return size;
+    };
+
+    BENCHMARK("path::join, 10k paths")
+    {
+        size_t      size = 0;
+        std::string buffer;
+        for (const auto& name : names)
+            size += shared::path::join(buffer, directory, name).size();
+        return size;
+    };
+
+    BENCHMARK("basename, 10k paths")
+    {
+        size_t size = 0;
+        for (const auto& name : names)
+            size += shared::basename(directory + "/" + name).size();
+        return size;
+    };
+
+    BENCHMARK("path::basename, 10k paths")
+    {
+        size_t      size = 0;
+        std::string buffer;
+        for (const auto& name : names)
+            size += shared::path::basename(shared::path::join(buffer, directory, name)).size();
+        return size;
+    };
+
+    const std::string messy = directory + "//./../templates/";
+    BENCHMARK("path::normalize, 10k paths")
+    {
+        size_t      size = 0;
+        std::string buffer;
+        std::string path;
+        for (const auto& name : names)
+            size += shared::path::normalize(buffer, shared::path::join(path, messy, name)).size();
+        return size;
+    };
+}
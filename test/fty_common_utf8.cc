@@ -26,11 +26,15 @@
 @end
 */
 
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
 #include "fty_common_utf8.h"
 #include "fty_common_json.h"
+#include "fty_common_macros.h"
 #include <catch2/catch.hpp>
 #include <czmq.h>
 #include <fty_log.h>
+#include <random>
+#include <unistd.h>
 
 #define SELFTEST_DIR_RO "src/selftest-ro"
 #define SELFTEST_DIR_RW "src/selftest-rw"
@@ -288,3 +292,481 @@ TEST_CASE("utf8")
         printf("OK\n");
     }
 }
+
+TEST_CASE("utf8 jsonify template cache")
+{
+    // same literal key rendered several times goes through the cached template
+    for (int i = 0; i < 3; i++) {
+        CHECK(UTF8::jsonify_translation_string("Value %d of %s is %.2f", i, "sensor", 1.5) ==
+              "{ \"key\": \"Value {{var1}} of {{var2}} is {{var3}}\", \"variables\": { \"var1\": \"" +
+                  std::to_string(i) + "\", \"var2\": \"sensor\", \"var3\": \"1.50\" } }");
+    }
+
+    // reused buffer with a different content must not hit the stale template
+    char key[32];
+    strcpy(key, "Runtime key %s");
+    CHECK(UTF8::jsonify_translation_string(key, "a") ==
+          "{ \"key\": \"Runtime key {{var1}}\", \"variables\": { \"var1\": \"a\" } }");
+    strcpy(key, "Other key %d");
+    CHECK(UTF8::jsonify_translation_string(key, 7) ==
+          "{ \"key\": \"Other key {{var1}}\", \"variables\": { \"var1\": \"7\" } }");
+
+    // conversions with flags, width and precision are rendered by printf
+    CHECK(UTF8::jsonify_translation_string("Load %5.1f%% on %*d outlets", 12.34, 3, 8) ==
+          "{ \"key\": \"Load {{var1}} on {{var2}} outlets\", \"variables\": { \"var1\": \" 12.3%\", \"var2\": "
+          "\"  8\" } }");
+    CHECK(UTF8::jsonify_translation_string("Missing %s", nullptr) ==
+          "{ \"key\": \"Missing {{var1}}\", \"variables\": { \"var1\": \"(null)\" } }");
+}
+
+TEST_CASE("utf8 jsonify typed")
+{
+    using UTF8::detail::FormatArg;
+
+    static_assert(UTF8::detail::parse_format("Text used as a key with %s and %d").count == 2);
+    static_assert(UTF8::detail::parse_format("Load %*.*f%% of %s").count == 4);
+    static_assert(UTF8::detail::parse_format("Already { \"key\": \"json\" }").valid);
+    static_assert(!UTF8::detail::parse_format("Positional %1$s").valid);
+    static_assert(UTF8::detail::accepts_format_arg<std::string>(FormatArg::String));
+    static_assert(!UTF8::detail::accepts_format_arg<int>(FormatArg::String));
+    static_assert(!UTF8::detail::accepts_format_arg<const char*>(FormatArg::Floating));
+
+    std::string      name = "foo";
+    std::string_view view = "bar baz";
+    int64_t          big  = 256;
+
+    CHECK(UTF8::jsonify(UTF8_FORMAT("Text used as a key with %s and %d"), name, 5) ==
+          UTF8::jsonify_translation_string("Text used as a key with %s and %d", "foo", 5));
+    CHECK(UTF8::jsonify(UTF8_FORMAT("Text used as a key with %'.2f and %lld"), 10.25, big) ==
+          UTF8::jsonify_translation_string("Text used as a key with %'.2f and %lld", 10.25, big));
+    CHECK(UTF8::jsonify(UTF8_FORMAT("Text used as a key")) == UTF8::jsonify_translation_string("Text used as a key"));
+    CHECK(UTF8::jsonify(UTF8_FORMAT("View %.3s and %s"), view, view) ==
+          UTF8::jsonify_translation_string("View %.3s and %s", "bar baz", "bar baz"));
+    CHECK(UTF8::jsonify(UTF8_FORMAT("Width %*d, %u%% and %e"), 4, 7, 50u, 0.5) ==
+          UTF8::jsonify_translation_string("Width %*d, %u%% and %e", 4, 7, 50u, 0.5));
+    CHECK(TRANSLATE_ME_CHECKED("Internal Server Error. %s", "{ \"key\": \"Timed out waiting for message.\" }") ==
+          TRANSLATE_ME("Internal Server Error. %s", "{ \"key\": \"Timed out waiting for message.\" }"));
+    CHECK(TRANSLATE_ME_CHECKED("Missing %s", nullptr) == TRANSLATE_ME("Missing %s", nullptr));
+}
+
+TEST_CASE("utf8 jsonify nested")
+{
+    std::string json = "{ \"key\": \"Leaf\" }";
+    for (int depth = 0; depth < 3; depth++)
+        json = UTF8::jsonify_translation_string("Level %d: %s", depth, json.c_str());
+    CHECK(json ==
+          "{ \"key\": \"Level {{var1}} {{var2}}\", \"variables\": { \"var1\": \"2:\", \"var2\":  { \"key\": \"Level "
+          "{{var1}} {{var2}}\", \"variables\": { \"var1\": \"1:\", \"var2\":  { \"key\": \"Level {{var1}} {{var2}}\", "
+          "\"variables\": { \"var1\": \"0:\", \"var2\":  { \"key\": \"Leaf\" }  } }  } }  } }");
+
+    // only variables are embedded, never the key
+    CHECK(UTF8::jsonify_translation_string("%s", "{ \"key\": \"Leaf\" }") ==
+          "{ \"key\": \"{{var1}}\", \"variables\": { \"var1\":  { \"key\": \"Leaf\" }  } }");
+    // not a single object
+    CHECK(UTF8::jsonify_translation_string("Got %s", "{a}{b}") ==
+          "{ \"key\": \"Got {{var1}}\", \"variables\": { \"var1\": \"{a}{b}\" } }");
+
+    std::string inner = UTF8::jsonify_translation_string("Timed out waiting for message.");
+    CHECK(UTF8::jsonify(UTF8_FORMAT("Internal Server Error. %s"), UTF8::RawJson{inner}) ==
+          UTF8::jsonify_translation_string("Internal Server Error. %s", inner.c_str()));
+}
+
+// write a .mo file the way msgfmt does (sorted originals, hash table)
+static std::string s_write_catalog(const std::vector<std::pair<std::string, std::string>>& messages, bool hashed)
+{
+    auto hash = [](const std::string& str) {
+        uint32_t hval = 0;
+        for (char c : str) {
+            hval = (hval << 4) + static_cast<unsigned char>(c);
+            uint32_t g = hval & 0xf0000000;
+            if (g != 0)
+                hval ^= (g >> 24) ^ g;
+        }
+        return hval;
+    };
+
+    uint32_t              count     = uint32_t(messages.size());
+    uint32_t              hash_size = hashed ? 7 : 0;
+    std::vector<uint32_t> hash_table(hash_size, 0);
+    for (uint32_t i = 0; i < count && hashed; i++) {
+        uint32_t h    = hash(messages[i].first);
+        uint32_t idx  = h % hash_size;
+        uint32_t incr = 1 + (h % (hash_size - 2));
+        while (hash_table[idx] != 0)
+            idx = (idx >= hash_size - incr) ? idx - (hash_size - incr) : idx + incr;
+        hash_table[idx] = i + 1;
+    }
+
+    std::vector<uint32_t> header = {0x950412de, 0, count, 28, 28 + 8 * count, hash_size, 28 + 16 * count};
+    std::string           strings;
+    uint32_t              offset = 28 + 16 * count + 4 * hash_size;
+    std::vector<uint32_t> originals, translations;
+    for (const auto& message : messages) {
+        originals.insert(originals.end(), {uint32_t(message.first.size()), offset + uint32_t(strings.size())});
+        strings.append(message.first).append(1, '\0');
+    }
+    for (const auto& message : messages) {
+        translations.insert(translations.end(), {uint32_t(message.second.size()), offset + uint32_t(strings.size())});
+        strings.append(message.second).append(1, '\0');
+    }
+
+    char path[] = "/tmp/fty-common-catalog-XXXXXX";
+    int  fd     = mkstemp(path);
+    REQUIRE(fd != -1);
+    for (const auto* table : {&header, &originals, &translations, &hash_table})
+        CHECK(write(fd, table->data(), table->size() * 4) == ssize_t(table->size() * 4));
+    CHECK(write(fd, strings.data(), strings.size()) == ssize_t(strings.size()));
+    close(fd);
+    return path;
+}
+
+TEST_CASE("utf8 message catalog")
+{
+    // sorted by msgid, as msgfmt does
+    std::vector<std::pair<std::string, std::string>> messages = {
+        {"", "Content-Type: text/plain; charset=UTF-8\n"},
+        {"Device {{var1}} is offline", "L'équipement {{var1}} est hors ligne"},
+        {"Load {{var1}} on {{var2}}", "Charge {{var1}} sur {{var2}}"},
+        {"Timed out waiting for message.", "Délai d'attente du message dépassé."},
+    };
+
+    for (bool hashed : {true, false}) {
+        std::string          path = s_write_catalog(messages, hashed);
+        UTF8::MessageCatalog catalog;
+        REQUIRE(catalog.open(path));
+        unlink(path.c_str());
+
+        CHECK(catalog.size() == messages.size());
+        for (const auto& message : messages)
+            CHECK(catalog.lookup(message.first) == message.second);
+        CHECK(catalog.lookup("Device").empty());
+        CHECK(catalog.lookup("Unknown message").empty());
+
+        std::string_view vars[] = {"ups-1", "rack-2"};
+        char             out[64];
+        CHECK(catalog.render("Device {{var1}} is offline", vars, 2, out, sizeof(out)) == 34);
+        CHECK(std::string(out) == "L'équipement ups-1 est hors ligne");
+        CHECK(catalog.render("Load {{var1}} on {{var2}}", vars, 2, out, sizeof(out)) == 23);
+        CHECK(std::string(out) == "Charge ups-1 sur rack-2");
+        // untranslated key, missing variable
+        CHECK(catalog.render("Not translated {{var1}} {{var3}}", vars, 2, out, sizeof(out)) == 29);
+        CHECK(std::string(out) == "Not translated ups-1 {{var3}}");
+        // truncated output
+        CHECK(catalog.render("Load {{var1}} on {{var2}}", vars, 2, out, 10) == 23);
+        CHECK(std::string(out) == "Charge up");
+    }
+
+    UTF8::MessageCatalog invalid;
+    CHECK(!invalid.open("/nonexistent/catalog.mo"));
+    CHECK(!invalid.isOpen());
+    CHECK(invalid.lookup("Device {{var1}} is offline").empty());
+}
+
+TEST_CASE("utf8 escape contexts")
+{
+    using UTF8::EscapeContext;
+
+    // shell escaping matches the historical bash_escape, including long runs handled by blocks
+    const std::string params[] = {"", "no-special_chars.0123", "rm -rf $HOME; echo `id`",
+        "0123456789abcdefghijklmnopqrstuvwxyz0123456789 (tail)", "Čeština: žluťoučký kůň"};
+    for (std::string param : params) {
+        std::string expected;
+        for (char c : param) {
+            if (std::string(" \t!\"#$&'()*,;<=>?[\\]^`{|}~").find(c) != std::string::npos)
+                expected += '\\';
+            expected += c;
+        }
+        CHECK(UTF8::bash_escape(param) == expected);
+        CHECK(UTF8::escape_for(EscapeContext::Shell, param) == expected);
+    }
+
+    CHECK(UTF8::escape_for(EscapeContext::Json, "say \"hi\"\\\n\t\x01 Řeš") ==
+          "say \\\"hi\\\"\\\\\\n\\t\\u0001 Řeš");
+    CHECK(UTF8::escape_for(EscapeContext::Json, std::string_view("a\0b", 3)) == "a\\u0000b");
+    CHECK(UTF8::escape_for(EscapeContext::Json, std::string(100, 'x') + "\x1f") == std::string(100, 'x') + "\\u001f");
+
+    CHECK(UTF8::escape_for(EscapeContext::Csv, "plain field") == "plain field");
+    CHECK(UTF8::escape_for(EscapeContext::Csv, "a,b") == "\"a,b\"");
+    CHECK(UTF8::escape_for(EscapeContext::Csv, "say \"hi\"") == "\"say \"\"hi\"\"\"");
+    CHECK(UTF8::escape_for(EscapeContext::Csv, std::string(40, 'x') + "\nline") ==
+          "\"" + std::string(40, 'x') + "\nline\"");
+    CHECK(UTF8::escape_for(EscapeContext::Csv, "") == "");
+
+    CHECK(UTF8::escape_for(EscapeContext::Xml, "<a href=\"x\">Tom & Jerry's</a>") ==
+          "&lt;a href=&quot;x&quot;&gt;Tom &amp; Jerry&#39;s&lt;/a&gt;");
+
+    CHECK(UTF8::escape_for(EscapeContext::SqlIdentifier, "t_asset_element") == "`t_asset_element`");
+    CHECK(UTF8::escape_for(EscapeContext::SqlIdentifier, "we`ird") == "`we``ird`");
+    CHECK(UTF8::escape_for(EscapeContext::SqlIdentifier, "") == "``");
+
+    // snprintf-like output
+    char out[8];
+    CHECK(UTF8::escape_to(EscapeContext::Xml, "a<b", nullptr, 0) == 6);
+    CHECK(UTF8::escape_to(EscapeContext::Xml, "a<b", out, sizeof(out)) == 6);
+    CHECK(std::string(out) == "a&lt;b");
+    CHECK(UTF8::escape_to(EscapeContext::Xml, "a<b<c", out, sizeof(out)) == 11);
+    CHECK(std::string(out) == "a&lt;b&");
+    CHECK(UTF8::escape_to(EscapeContext::SqlIdentifier, "abc", out, 3) == 5);
+    CHECK(std::string(out) == "`a");
+
+    char* escaped = utf8_bash_escape("a b");
+    CHECK(std::string(escaped) == "a\\ b");
+    free(escaped);
+}
+
+TEST_CASE("utf8 length-aware C API")
+{
+    // no NUL terminator needed, output truncated like snprintf
+    const char input[] = "say \"žluťoučký\"; rm -rf";
+    char       out[128];
+    size_t     needed = 0;
+    CHECK(utf8_escape_n(input, 9, out, sizeof(out), &needed) == 0);
+    CHECK(std::string(out) == "say \\\"\\u017elu");
+    CHECK(needed == 14);
+    CHECK(utf8_escape_n(input, 9, out, 5, &needed) == -1);
+    CHECK(std::string(out) == "say ");
+    CHECK(needed == 14);
+    CHECK(utf8_escape_n(input, 9, nullptr, 0, &needed) == -1);
+    CHECK(needed == 14);
+    // cut in the middle of a UTF-8 sequence
+    CHECK(utf8_escape_n(input, 6, out, sizeof(out), nullptr) == 0);
+    CHECK(std::string(out) == "(invalid_utf8)");
+    // invalid lead byte at the end of a buffer without NUL
+    const char invalid[] = {'a', 'b', char(0xff)};
+    CHECK(utf8_escape_n(invalid, sizeof(invalid), out, sizeof(out), nullptr) == 0);
+    CHECK(std::string(out) == "(invalid_utf8)");
+    CHECK(utf8_escape_n(nullptr, 0, out, sizeof(out), nullptr) == 0);
+    CHECK(std::string(out) == "(null_ptr)");
+
+    CHECK(utf8_bash_escape_n("rm -rf; ls", 7, out, sizeof(out), &needed) == 0);
+    CHECK(std::string(out) == "rm\\ -rf\\;");
+    CHECK(needed == 9);
+
+    CHECK(utf8_jsonify_translation_string_n(out, sizeof(out), &needed, "Device %s is offline", "ups-1") == 0);
+    CHECK(std::string(out) == UTF8::jsonify_translation_string("Device %s is offline", "ups-1"));
+    CHECK(needed == strlen(out));
+    CHECK(utf8_jsonify_translation_string_n(out, 8, &needed, "Device %s is offline", "ups-1") == -1);
+    CHECK(strlen(out) == 7);
+
+    zframe_t* frame = utf8_escape_frame(input, 3);
+    REQUIRE(frame);
+    CHECK(std::string(reinterpret_cast<char*>(zframe_data(frame)), zframe_size(frame)) == "say");
+    zframe_destroy(&frame);
+
+    frame = utf8_bash_escape_frame("a b", 3);
+    REQUIRE(frame);
+    CHECK(std::string(reinterpret_cast<char*>(zframe_data(frame)), zframe_size(frame)) == "a\\ b");
+    zframe_destroy(&frame);
+
+    frame = utf8_escape_frame(invalid, sizeof(invalid));
+    REQUIRE(frame);
+    CHECK(std::string(reinterpret_cast<char*>(zframe_data(frame)), zframe_size(frame)) == "(invalid_utf8)");
+    zframe_destroy(&frame);
+
+    zmsg_t* msg = zmsg_new();
+    CHECK(utf8_escape_zmsg(msg, "a\"b", 3) == 0);
+    CHECK(utf8_bash_escape_zmsg(msg, "a b", 3) == 0);
+    CHECK(utf8_jsonify_translation_zmsg(msg, "Device %s is offline", "ups-1") == 0);
+    CHECK(zmsg_size(msg) == 3);
+    frame = zmsg_first(msg);
+    CHECK(std::string(reinterpret_cast<char*>(zframe_data(frame)), zframe_size(frame)) == "a\\\"b");
+    zmsg_destroy(&msg);
+    CHECK(utf8_escape_zmsg(nullptr, "a", 1) == -1);
+}
+
+TEST_CASE("utf8 unescape")
+{
+    std::string out;
+    CHECK(UTF8::unescape("plain text", out));
+    CHECK(out == "plain text");
+    CHECK(UTF8::unescape("", out));
+    CHECK(out.empty());
+    CHECK(UTF8::unescape("say \\\"hi\\\"\\/\\\\ \\b\\f\\n\\r\\t", out));
+    CHECK(out == "say \"hi\"/\\ \b\f\n\r\t");
+    CHECK(UTF8::unescape("\\u017elu\\u0165ou\\u010Dk\\u00fd k\\u016f\\u0148 \\u0041\\u0000!", out));
+    CHECK(out == std::string("žluťoučký kůň A\0!", 23));
+    // surrogate pair
+    CHECK(UTF8::unescape("\\ud83d\\ude00 \\uD834\\uDD1E", out));
+    CHECK(out == "😀 𝄞");
+
+    // invalid input
+    for (const char* invalid : {"\\", "abc\\", "\\x41", "\\u12", "\\u12g4", "\\ud83d", "\\ud83d\\u0041", "\\ude00",
+             "\\ud83dx\\ude00"}) {
+        CHECK(!UTF8::unescape(invalid, out));
+        CHECK(out.empty());
+        char buffer[16];
+        CHECK(UTF8::unescape_to(invalid, buffer) == std::string::npos);
+    }
+
+    std::string in_place = "Device \\\"ups\\u002d1\\\" \\u010Cerven\\u00e1";
+    CHECK(UTF8::unescape_in_place(in_place));
+    CHECK(in_place == "Device \"ups-1\" Červená");
+
+    // round trip through escape, which handles BMP characters except \b \f \n \r \t (escaped twice)
+    std::mt19937                            random(42);
+    std::uniform_int_distribution<uint32_t> ascii(1, 0x7f), bmp(0x80, 0xfffd), kind(0, 3);
+    for (int i = 0; i < 2000; i++) {
+        std::u32string codepoints;
+        std::string    original;
+        size_t         length = random() % 40;
+        for (size_t j = 0; j < length; j++) {
+            uint32_t codepoint = kind(random) == 0 ? bmp(random) : ascii(random);
+            if ((codepoint >= 0xd800 && codepoint <= 0xdfff) || codepoint == '\b' || codepoint == '\f' ||
+                codepoint == '\n' || codepoint == '\r' || codepoint == '\t')
+                continue;
+            char buffer[4];
+            if (codepoint < 0x80) {
+                original += char(codepoint);
+            } else if (codepoint < 0x800) {
+                buffer[0] = char(0xc0 | (codepoint >> 6));
+                buffer[1] = char(0x80 | (codepoint & 0x3f));
+                original.append(buffer, 2);
+            } else {
+                buffer[0] = char(0xe0 | (codepoint >> 12));
+                buffer[1] = char(0x80 | ((codepoint >> 6) & 0x3f));
+                buffer[2] = char(0x80 | (codepoint & 0x3f));
+                original.append(buffer, 3);
+            }
+        }
+        std::string escaped = UTF8::escape(original);
+        REQUIRE(UTF8::unescape(escaped, out));
+        CHECK(out == original);
+        CHECK(UTF8::unescape_in_place(escaped));
+        CHECK(escaped == original);
+    }
+}
+
+TEST_CASE("utf8 nfc")
+{
+    using UTF8::NfcQuickCheck;
+
+    // composed, decomposed, and decomposed in non-canonical order
+    const std::string composed_str   = "Salle serveurs \u00e9tage 2 - \u0158ada \u1ea0\u0309";
+    const std::string decomposed_str = "Salle serveurs e\u0301tage 2 - R\u030cada A\u0323\u0309";
+    const std::string unordered_str  = "Salle serveurs e\u0301tage 2 - R\u030cada A\u0309\u0323";
+
+    CHECK(UTF8::is_nfc_quick("") == NfcQuickCheck::Yes);
+    CHECK(UTF8::is_nfc_quick("ups-1 in rack B") == NfcQuickCheck::Yes);
+    CHECK(UTF8::is_nfc_quick("Z\xc3\xa1lo\xc5\xben\xc3\xad zdroj") == NfcQuickCheck::Yes);
+    CHECK(UTF8::is_nfc_quick(composed_str.substr(0, composed_str.size() - 2)) == NfcQuickCheck::Yes);
+    // U+0309 may compose with a preceding letter
+    CHECK(UTF8::is_nfc_quick(composed_str) == NfcQuickCheck::Maybe);
+    CHECK(UTF8::is_nfc_quick(decomposed_str) == NfcQuickCheck::Maybe);
+    CHECK(UTF8::is_nfc_quick(unordered_str) == NfcQuickCheck::No);
+    // U+212B ANGSTROM SIGN is never in NFC
+    CHECK(UTF8::is_nfc_quick("\xe2\x84\xab") == NfcQuickCheck::No);
+    // invalid UTF-8
+    CHECK(UTF8::is_nfc_quick("\xc3") == NfcQuickCheck::No);
+    CHECK(UTF8::is_nfc_quick("\xed\xa0\x80") == NfcQuickCheck::No);
+
+    CHECK(UTF8::is_nfc(composed_str));
+    CHECK(!UTF8::is_nfc(decomposed_str));
+    // U+0301 can compose, but not with a preceding U+0020
+    CHECK(UTF8::is_nfc(" \xcc\x81"));
+
+    std::string out;
+    for (const std::string& str : {composed_str, decomposed_str, unordered_str}) {
+        REQUIRE(UTF8::to_nfc(str, out));
+        CHECK(out == composed_str);
+    }
+    CHECK(UTF8::to_nfc("\xe2\x84\xab", out));
+    CHECK(out == "\xc3\x85");
+    // Hangul syllables from conjoining jamo
+    CHECK(UTF8::to_nfc("\xe1\x84\x92\xe1\x85\xa1\xe1\x86\xab", out));
+    CHECK(out == "\xed\x95\x9c");
+    CHECK(!UTF8::to_nfc("abc\xff", out));
+}
+
+TEST_CASE("utf8 jsonify benchmark", "[.][benchmark]")
+{
+    BENCHMARK("alert message")
+    {
+        return UTF8::jsonify_translation_string(
+            "Average %s in %s is %.2f %s, which is above the high warning threshold of %d", "temperature",
+            "rack-42", 35.2, "C", 30);
+    };
+
+    BENCHMARK("10k alert messages")
+    {
+        size_t size = 0;
+        for (int i = 0; i < 10000; i++) {
+            size += UTF8::jsonify_translation_string(
+                "Average %s in %s is %.2f %s, which is above the high warning threshold of %d", "temperature",
+                "rack-42", 35.2, "C", i)
+                        .size();
+        }
+        return size;
+    };
+
+    BENCHMARK("alert message typed")
+    {
+        return UTF8::jsonify(
+            UTF8_FORMAT("Average %s in %s is %.2f %s, which is above the high warning threshold of %d"),
+            "temperature", "rack-42", 35.2, "C", 30);
+    };
+
+    for (int levels : {4, 16}) {
+        BENCHMARK("nested alert description, " + std::to_string(levels) + " levels")
+        {
+            std::string json = UTF8::jsonify_translation_string("Device %s is offline", "ups-1");
+            for (int i = 0; i < levels; i++)
+                json = UTF8::jsonify_translation_string("Alert %d raised by rule %s: %s", i, "rule", json.c_str());
+            return json;
+        };
+    }
+
+    BENCHMARK("alert message, C API into a caller buffer")
+    {
+        char   out[256];
+        size_t needed;
+        utf8_jsonify_translation_string_n(out, sizeof(out), &needed,
+            "Average %s in %s is %.2f %s, which is above the high warning threshold of %d", "temperature", "rack-42",
+            35.2, "C", 30);
+        return needed;
+    };
+
+    BENCHMARK("alert message, C API allocating")
+    {
+        char* json = utf8_jsonify_translation_string(
+            "Average %s in %s is %.2f %s, which is above the high warning threshold of %d", "temperature",
+            "rack-42", 35.2, "C", 30);
+        size_t length = strlen(json);
+        free(json);
+        return length;
+    };
+
+    std::string text;
+    while (text.size() < 64 * 1024)
+        text += "Device ups-1 (rack \"A\") reached 35.2 C, see <https://example.com/?a=1&b=2>\n";
+    std::string escaped = UTF8::escape(text + "Average temperature in Serveurs équipés is too high");
+    BENCHMARK("unescape 64 KiB")
+    {
+        std::string out;
+        UTF8::unescape(escaped, out);
+        return out;
+    };
+
+    std::vector<std::string> names;
+    for (int i = 0; i < 1000; i++)
+        names.push_back("Serveurs \xc3\xa9tage " + std::to_string(i) + (i % 10 == 0 ? " e\xcc\x81" : ""));
+    BENCHMARK("nfc of 1000 asset names")
+    {
+        std::string out;
+        size_t      normalized = 0;
+        for (const auto& name : names) {
+            if (UTF8::is_nfc_quick(name) != UTF8::NfcQuickCheck::Yes) {
+                UTF8::to_nfc(name, out);
+                normalized++;
+            }
+        }
+        return normalized;
+    };
+
+    for (auto context : {UTF8::EscapeContext::Shell, UTF8::EscapeContext::Json, UTF8::EscapeContext::Csv,
+             UTF8::EscapeContext::Xml, UTF8::EscapeContext::SqlIdentifier}) {
+        BENCHMARK("escape 64 KiB, context " + std::to_string(static_cast<int>(context)))
+        {
+            return UTF8::escape_for(context, text);
+        };
+    }
+}